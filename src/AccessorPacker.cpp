@@ -1,168 +1,322 @@
-#include "externals.h"
+#include "coreExternals.h"
 
 #include "AccessorPacker.h"
+#include "Profiler.h"
 
+#include "SparseAccessor.h"
 #include "accessors.h"
 
 using GLTF::Constants::WebGL;
 
-GLTF::BufferView *AccessorPacker::packAccessorsForTargetByteStride(
-    const std::vector<GLTF::Accessor *> &accessors, WebGL target) {
-    std::map<GLTF::Accessor *, int> byteOffsets;
-    int byteLength = 0;
-    for (GLTF::Accessor *accessor : accessors) {
-        const auto componentByteLength = accessor->getComponentByteLength();
+namespace {
+const byte zeros[16] = {};
+
+// The layout key of the sparse buffer view, that no dense view can have.
+const int sparseByteStride = 0;
+const WebGL sparseTarget = static_cast<WebGL>(-1);
+
+// Every buffer view starts at a multiple of 4 bytes, so the accessors
+// in it are aligned to their component size.
+const size_t viewAlignment = 4;
+
+size_t alignedByteOffset(const size_t byteOffset) {
+    return (byteOffset + viewAlignment - 1) & ~(viewAlignment - 1);
+}
+} // namespace
+
+size_t AccessorPacker::elementByteStride(GLTF::Accessor *accessor,
+                                         const WebGL target) {
+    const size_t elementByteLength = accessor->getNumberOfComponents() *
+                                     accessor->getComponentByteLength();
+
+    // Each vertex attribute element must start at a multiple of 4 bytes
+    return target == WebGL::ARRAY_BUFFER ? (elementByteLength + 3) & ~3
+                                         : elementByteLength;
+}
+
+void AccessorPacker::layoutAccessors(ViewLayout &layout) {
+    size_t byteLength = 0;
+    for (GLTF::Accessor *accessor : layout.accessors) {
+        const size_t componentByteLength = accessor->getComponentByteLength();
         const auto padding = byteLength % componentByteLength;
         if (padding != 0) {
             byteLength += (componentByteLength - padding);
         }
-        byteOffsets[accessor] = byteLength;
-        byteLength += componentByteLength * accessor->getNumberOfComponents() *
-                      accessor->count;
+        layout.accessorByteOffsets.push_back(byteLength);
+        byteLength +=
+            elementByteStride(accessor, layout.target) * accessor->count;
     }
+    layout.byteLength = byteLength;
+}
 
-    auto bufferData = new byte[byteLength];
-    m_data.emplace_back(bufferData);
+AccessorPacker::Segment
+AccessorPacker::accessorSegment(GLTF::Accessor *accessor,
+                                const size_t byteOffset,
+                                const size_t targetByteStride) {
+    const auto sourceView = accessor->bufferView;
 
-    const auto bufferView =
-        new GLTF::BufferView(bufferData, byteLength, target);
-    m_views.emplace_back(bufferView);
+    Segment segment;
+    segment.byteOffset = byteOffset;
+    segment.source = sourceView->buffer->data + sourceView->byteOffset +
+                     accessor->byteOffset;
+    segment.elementByteLength = accessor->getNumberOfComponents() *
+                                accessor->getComponentByteLength();
+    segment.sourceByteStride = accessor->getByteStride();
+    segment.targetByteStride = targetByteStride;
+    segment.count = accessor->count;
+    return segment;
+}
 
-    for (GLTF::Accessor *accessor : accessors) {
-        const auto byteOffset = byteOffsets[accessor];
-        GLTF::Accessor packedAccessor(accessor->type, accessor->componentType,
-                                      byteOffset, accessor->count, bufferView);
+void AccessorPacker::copySegment(const Segment &segment, byte *target) {
+    const size_t elementByteLength = segment.elementByteLength;
+    const size_t targetByteStride = segment.targetByteStride;
 
-        const size_t numberOfComponents = accessor->getNumberOfComponents();
+    if (segment.sourceByteStride == elementByteLength &&
+        targetByteStride == elementByteLength) {
+        std::memcpy(target, segment.source, segment.byteLength());
+    } else {
+        // Interleaved source data, or padded target elements
+        for (size_t i = 0; i < segment.count; ++i) {
+            std::memcpy(target + i * targetByteStride,
+                        segment.source + i * segment.sourceByteStride,
+                        elementByteLength);
+            std::memset(target + i * targetByteStride + elementByteLength, 0,
+                        targetByteStride - elementByteLength);
+        }
+    }
+}
 
-        const auto components =
-            static_cast<float *>(alloca(sizeof(float) * numberOfComponents));
+void AccessorPacker::writeSegment(std::ostream &out, const Segment &segment) {
+    const size_t elementByteLength = segment.elementByteLength;
+    const size_t paddingByteLength =
+        segment.targetByteStride - elementByteLength;
 
-        for (auto i = 0; i < accessor->count; i++) {
-            accessor->getComponentAtIndex(i, components);
-            packedAccessor.writeComponentAtIndex(i, components);
+    if (segment.sourceByteStride == elementByteLength &&
+        paddingByteLength == 0) {
+        out.write(reinterpret_cast<const char *>(segment.source),
+                  segment.byteLength());
+    } else {
+        // Interleaved source data, or padded target elements
+        for (size_t i = 0; i < segment.count; ++i) {
+            out.write(reinterpret_cast<const char *>(
+                          segment.source + i * segment.sourceByteStride),
+                      elementByteLength);
+            out.write(reinterpret_cast<const char *>(zeros),
+                      paddingByteLength);
         }
-
-        accessor->byteOffset = packedAccessor.byteOffset;
-        accessor->bufferView = packedAccessor.bufferView;
     }
-    return bufferView;
 }
 
+AccessorPacker::AccessorPacker(const bool isStreaming)
+    : m_isStreaming(isStreaming) {}
+
 GLTF::Buffer *
 AccessorPacker::packAccessors(const std::vector<GLTF::Accessor *> &accessors,
                               const std::string &bufferName,
                               size_t additionalBufferSize) {
-    std::map<WebGL, std::map<int, std::vector<GLTF::Accessor *>>>
-        accessorGroups;
-    accessorGroups[WebGL::ARRAY_BUFFER] =
-        std::map<int, std::vector<GLTF::Accessor *>>();
-    accessorGroups[WebGL::ELEMENT_ARRAY_BUFFER] =
-        std::map<int, std::vector<GLTF::Accessor *>>();
-    accessorGroups[WebGL(-1)] = std::map<int, std::vector<GLTF::Accessor *>>();
-
-    auto byteLength = 0;
+    PROFILE_STAGE("asset.pack");
+
+    // The buffer views are sorted from largest byteStride to smallest,
+    // and per byteStride by target.
+    std::map<int, std::map<WebGL, ViewLayout>, std::greater<>> layouts;
+
+    std::set<GLTF::Accessor *> packedAccessors;
+    std::vector<SparseAccessor *> sparseAccessors;
+
     for (GLTF::Accessor *accessor : accessors) {
+        // The indices and values of all sparse accessors share one buffer
+        // view, without a target and byte stride.
+        if (auto sparseAccessor = dynamic_cast<SparseAccessor *>(accessor)) {
+            if (packedAccessors.insert(accessor).second) {
+                auto &layout = layouts[sparseByteStride][sparseTarget];
+                layout.target = sparseTarget;
+                layout.byteStride = sparseByteStride;
+                layout.accessors.push_back(sparseAccessor->indices());
+                layout.accessors.push_back(sparseAccessor->values());
+                sparseAccessors.push_back(sparseAccessor);
+            }
+            continue;
+        }
+
         // In glTF 2.0, bufferView is not required in accessor.
         if (accessor->bufferView == nullptr) {
             continue;
         }
 
-        WebGL target = accessor->bufferView->target;
-        auto targetGroup = accessorGroups[target];
-        auto byteStride = accessor->getByteStride();
-        auto findByteStrideGroup = targetGroup.find(byteStride);
+        // Accessors can be shared
+        if (!packedAccessors.insert(accessor).second) {
+            continue;
+        }
 
-        std::vector<GLTF::Accessor *> byteStrideGroup =
-            findByteStrideGroup == targetGroup.end()
-                ? std::vector<GLTF::Accessor *>()
-                : findByteStrideGroup->second;
+        const WebGL target = accessor->bufferView->target;
+        const int byteStride = target == WebGL::ARRAY_BUFFER
+                                   ? int(elementByteStride(accessor, target))
+                                   : accessor->getByteStride();
+
+        auto &layout = layouts[byteStride][target];
+        layout.target = target;
+        layout.byteStride = byteStride;
+        layout.accessors.push_back(accessor);
+    }
 
-        byteStrideGroup.push_back(accessor);
-        targetGroup[byteStride] = byteStrideGroup;
-        accessorGroups[target] = targetGroup;
-        byteLength += accessor->bufferView->byteLength;
+    // First pass: compute the offset of every buffer view and accessor.
+    size_t byteLength = 0;
+    for (auto &&strideLayouts : layouts) {
+        for (auto &&pair : strideLayouts.second) {
+            auto &layout = pair.second;
+            layoutAccessors(layout);
+            layout.byteOffset = alignedByteOffset(byteLength);
+            byteLength = layout.byteOffset + layout.byteLength;
+        }
     }
 
-#if 0
-    // Go through primitives and look for primitives that use Draco extension.
-        // If extension is not enabled, the vector will be empty.
-    std::vector<GLTF::BufferView*> compressedBufferViews = asset->getAllCompressedBufferView();
-    // Reserve data for compressed data.
-    for (GLTF::BufferView* compressedBufferView : compressedBufferViews) {
-        byteLength += compressedBufferView->byteLength;
+    byteLength += additionalBufferSize;
+
+    if (byteLength == 0)
+        return nullptr;
+
+    // Second pass: copy the data of each accessor to its final offset,
+    // or when streaming, remember where to write it.
+    byte *bufferData = nullptr;
+    if (!m_isStreaming) {
+        bufferData = new byte[byteLength];
+        m_data.emplace_back(bufferData);
     }
-#endif
 
-    std::vector<int> byteStrides;
-    std::map<int, std::vector<GLTF::BufferView *>> bufferViews;
-    for (auto targetGroup : accessorGroups) {
-        for (auto byteStrideGroup : targetGroup.second) {
-            const WebGL target = targetGroup.first;
-            int byteStride = byteStrideGroup.first;
+    const auto buffer = new GLTF::Buffer(bufferData, int(byteLength));
+    m_buffers.emplace_back(buffer);
+    buffer->name = bufferName;
+
+    auto &segments = m_segments[buffer];
+
+    size_t viewByteEnd = 0;
+
+    for (auto &&strideLayouts : layouts) {
+        for (auto &&pair : strideLayouts.second) {
+            const auto &layout = pair.second;
+            const WebGL target = layout.target;
+            const int byteStride = layout.byteStride;
 
-            GLTF::BufferView *bufferView = packAccessorsForTargetByteStride(
-                byteStrideGroup.second, target);
+            // Clear the padding before the view. When streaming,
+            // writeBuffer fills the gaps between segments with zeros.
+            if (!m_isStreaming) {
+                std::memset(bufferData + viewByteEnd, 0,
+                            layout.byteOffset - viewByteEnd);
+            }
+
+            viewByteEnd = layout.byteOffset + layout.byteLength;
+
+            const auto bufferView = new GLTF::BufferView(
+                int(layout.byteOffset), int(layout.byteLength), buffer);
+            m_views.emplace_back(bufferView);
+            bufferView->target = target;
 
             if (!bufferName.empty()) {
-                bufferView->name = bufferName + "/" +
-                                   glAccessorTargetPurpose(target) + "-" +
-                                   std::to_string(byteStride);
+                bufferView->name =
+                    bufferName + "/" +
+                    (byteStride == sparseByteStride
+                         ? std::string("sparse")
+                         : glAccessorTargetPurpose(target) + std::string("-") +
+                               std::to_string(byteStride));
             }
 
             if (target == WebGL::ARRAY_BUFFER) {
                 bufferView->byteStride = byteStride;
             }
-            auto findBufferViews = bufferViews.find(byteStride);
-            std::vector<GLTF::BufferView *> bufferViewGroup;
-            if (findBufferViews == bufferViews.end()) {
-                byteStrides.push_back(byteStride);
-                bufferViewGroup = std::vector<GLTF::BufferView *>();
-            } else {
-                bufferViewGroup = findBufferViews->second;
+
+            size_t byteEnd = 0;
+
+            for (size_t index = 0; index < layout.accessors.size(); ++index) {
+                GLTF::Accessor *accessor = layout.accessors[index];
+                const auto byteOffset = layout.accessorByteOffsets[index];
+
+                const auto segment =
+                    accessorSegment(accessor, layout.byteOffset + byteOffset,
+                                    elementByteStride(accessor, target));
+
+                if (m_isStreaming) {
+                    segments.push_back(segment);
+                } else {
+                    // Clear the alignment padding
+                    const auto viewData = bufferData + layout.byteOffset;
+                    std::memset(viewData + byteEnd, 0, byteOffset - byteEnd);
+                    copySegment(segment, bufferData + segment.byteOffset);
+                }
+
+                byteEnd = byteOffset + segment.byteLength();
+
+                accessor->byteOffset = int(byteOffset);
+                accessor->bufferView = bufferView;
             }
-            bufferViewGroup.push_back(bufferView);
-            bufferViews[byteStride] = bufferViewGroup;
         }
     }
-    std::sort(byteStrides.begin(), byteStrides.end(), std::greater<>());
 
-    byteLength += additionalBufferSize;
+    // The asset only writes the buffer views that accessors refer to.
+    for (auto sparseAccessor : sparseAccessors) {
+        sparseAccessor->bufferView = sparseAccessor->indices()->bufferView;
+    }
+
+    return buffer;
+}
 
-    GLTF::Buffer *buffer = nullptr;
+void AccessorPacker::addData(GLTF::Buffer *buffer, const size_t byteOffset,
+                             const byte *data, const size_t byteLength) {
+    assert(byteOffset + byteLength <= size_t(buffer->byteLength));
 
-    if (byteLength > 0) {
-        // Pack these into a buffer sorted from largest byteStride to smallest
-        auto bufferData = new byte[byteLength];
-        m_data.emplace_back(bufferData);
+    if (m_isStreaming) {
+        auto &segments = m_segments.at(buffer);
+        const Segment segment{byteOffset, data,      byteLength,
+                              byteLength, byteLength, 1};
+        const auto position = std::upper_bound(
+            segments.begin(), segments.end(), segment,
+            [](const Segment &a, const Segment &b) {
+                return a.byteOffset < b.byteOffset;
+            });
+        segments.insert(position, segment);
+    } else {
+        std::memcpy(buffer->data + byteOffset, data, byteLength);
+    }
+}
 
-        buffer = new GLTF::Buffer(bufferData, byteLength);
-        m_buffers.emplace_back(buffer);
-        buffer->name = bufferName;
-
-        int byteOffset = 0;
-        for (int byteStride : byteStrides) {
-            for (GLTF::BufferView *bufferView : bufferViews[byteStride]) {
-                std::memcpy(&bufferData[byteOffset], bufferView->buffer->data,
-                            bufferView->byteLength);
-                bufferView->byteOffset = byteOffset;
-                bufferView->buffer = buffer;
-                byteOffset += bufferView->byteLength;
-            }
-        }
+void AccessorPacker::writeBuffer(std::ostream &out,
+                                 const GLTF::Buffer *buffer) const {
+    const size_t byteLength = buffer->byteLength;
+
+    if (!m_isStreaming) {
+        out.write(reinterpret_cast<const char *>(buffer->data), byteLength);
+        return;
+    }
 
-#if 0
-        // Append compressed data to buffer.
-        for (GLTF::BufferView* compressedBufferView : compressedBufferViews) {
-            std::memcpy(bufferData + byteOffset, compressedBufferView->buffer->data, compressedBufferView->byteLength);
-            compressedBufferView->byteOffset = byteOffset;
-            compressedBufferView->buffer = buffer;
-            byteOffset += compressedBufferView->byteLength;
+    const auto writeZeros = [&out](size_t count) {
+        for (; count > sizeof(zeros); count -= sizeof(zeros)) {
+            out.write(reinterpret_cast<const char *>(zeros), sizeof(zeros));
         }
-#endif
+        out.write(reinterpret_cast<const char *>(zeros), count);
+    };
+
+    size_t byteEnd = 0;
+
+    for (auto &&segment : m_segments.at(buffer)) {
+        assert(segment.byteOffset >= byteEnd);
+        writeZeros(segment.byteOffset - byteEnd);
+        writeSegment(out, segment);
+        byteEnd = segment.byteOffset + segment.byteLength();
     }
 
-    return buffer;
+    assert(byteEnd <= byteLength);
+    writeZeros(byteLength - byteEnd);
+}
+
+std::unique_ptr<byte[]> AccessorPacker::releaseData(const GLTF::Buffer *buffer) {
+    const auto it = std::find_if(m_data.begin(), m_data.end(),
+                                 [buffer](const std::unique_ptr<byte[]> &data) {
+                                     return data && data.get() == buffer->data;
+                                 });
+
+    if (it == m_data.end())
+        return nullptr;
+
+    return std::move(*it);
 }
 
 std::vector<GLTF::Buffer *> AccessorPacker::getPackedBuffers() const {
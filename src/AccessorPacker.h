@@ -2,20 +2,88 @@
 
 #include "BasicTypes.h"
 
+/**
+ * Packs the data of accessors into a single buffer, with one buffer view
+ * per target and byte stride. Each view starts at a multiple of 4 bytes,
+ * and vertex attributes are padded to a multiple of 4 bytes, as required
+ * by glTF. The layout of the whole buffer is computed
+ * first, then the data of each accessor is copied once, straight to its
+ * final offset. The indices and values of sparse accessors are packed in
+ * one extra buffer view.
+ *
+ * When streaming, the packed buffers are never allocated: only their layout
+ * is computed, and writeBuffer copies the data of each accessor straight
+ * from its source storage to the output stream.
+ */
 class AccessorPacker {
   public:
+    explicit AccessorPacker(bool isStreaming = false);
+
+    bool isStreaming() const { return m_isStreaming; }
+
     GLTF::Buffer *packAccessors(const std::vector<GLTF::Accessor *> &accessors,
                                 const std::string &bufferName,
                                 size_t additionalBufferSize = 0);
 
+    /** Copies data into the additional space of a packed buffer, or when
+     * streaming, remembers to write it there. The data must stay alive
+     * until the buffer is written. */
+    void addData(GLTF::Buffer *buffer, size_t byteOffset, const byte *data,
+                 size_t byteLength);
+
+    /** Writes the content of a packed buffer, zero padded to its length */
+    void writeBuffer(std::ostream &out, const GLTF::Buffer *buffer) const;
+
+    /** Hands over the data of a buffer that this packer allocated, so it
+     * can outlive the packer. nullptr when streaming, or for other buffers.
+     * The data pointer of the buffer stays valid as long as the caller
+     * keeps the data. */
+    std::unique_ptr<byte[]> releaseData(const GLTF::Buffer *buffer);
+
     std::vector<GLTF::Buffer *> getPackedBuffers() const;
 
   private:
+    const bool m_isStreaming;
+
     std::vector<std::unique_ptr<byte[]>> m_data;
     std::vector<std::unique_ptr<GLTF::Buffer>> m_buffers;
     std::vector<std::unique_ptr<GLTF::BufferView>> m_views;
 
-    GLTF::BufferView *packAccessorsForTargetByteStride(
-        const std::vector<GLTF::Accessor *> &accessors,
-        GLTF::Constants::WebGL target);
+    /** The accessors of one buffer view, with their offsets in that view */
+    struct ViewLayout {
+        GLTF::Constants::WebGL target;
+        int byteStride;
+        std::vector<GLTF::Accessor *> accessors;
+        std::vector<size_t> accessorByteOffsets;
+        size_t byteOffset = 0;
+        size_t byteLength = 0;
+    };
+
+    /** Elements to copy from their source storage to a packed buffer */
+    struct Segment {
+        size_t byteOffset;
+        const byte *source;
+        size_t elementByteLength;
+        size_t sourceByteStride;
+        size_t targetByteStride;
+        size_t count;
+
+        size_t byteLength() const { return targetByteStride * count; }
+    };
+
+    /** The segments of each streamed buffer, in byte offset order */
+    std::map<const GLTF::Buffer *, std::vector<Segment>> m_segments;
+
+    static void layoutAccessors(ViewLayout &layout);
+
+    static size_t elementByteStride(GLTF::Accessor *accessor,
+                                    GLTF::Constants::WebGL target);
+
+    static Segment accessorSegment(GLTF::Accessor *accessor,
+                                   size_t byteOffset,
+                                   size_t targetByteStride);
+
+    static void copySegment(const Segment &segment, byte *target);
+
+    static void writeSegment(std::ostream &out, const Segment &segment);
 };
@@ -15,6 +15,10 @@ const auto cleanOutputFolder = "cof";
 
 const auto sceneName = "sn";
 const auto binary = "glb";
+const auto streamGlb = "sgb";
+const auto asyncOutput = "aso";
+const auto asyncOutputMemory = "aom";
+const auto profile = "prf";
 const auto dumpMaya = "dmy";
 const auto dumpGLTF = "dgl";
 const auto externalTextures = "ext";
@@ -28,6 +32,10 @@ const auto colorizeMaterials = "cm";
 const auto skipStandardMaterials = "ssm";
 const auto skipMaterialTextures = "smt";
 const auto force32bitIndices = "i32";
+const auto splitLargePrimitives = "slp";
+const auto weldByIndices = "wbi";
+const auto optimizeVertexCache = "ovc";
+const auto optimizeOverdraw = "ood";
 const auto disableNameAssignment = "dnn";
 const auto scaleFactor = "sf";
 const auto mikkelsenTangentSpace = "mts";
@@ -60,6 +68,16 @@ const auto selectedNodesOnly = "sno";
 const auto visibleNodesOnly = "vno";
 
 const auto excludeUnusedTexcoord = "eut";
+const auto blendShapeTolerance = "bst";
+const auto sparseTargets = "spt";
+const auto quantizeMeshes = "qm";
+const auto positionQuantizationError = "pqe";
+const auto normalQuantizationError = "nqe";
+const auto texCoordQuantizationError = "tqe";
+const auto colorQuantizationError = "cqe";
+const auto compactSkins = "csk";
+const auto jointWeightQuantizationError = "wqe";
+const auto maxJointInfluences = "mji";
 
 const auto keepShapeNodes = "ksn";
 
@@ -72,8 +90,15 @@ const auto forceAnimationChannels = "fac";
 const auto forceAnimationSampling = "fas";
 
 const auto detectStepAnimations = "dsa";
+const auto reduceKeyframes = "rkf";
+const auto reduceKeyframesAngle = "rka";
 
 const auto hashBufferURIs = "hbu";
+const auto fastBufferHash = "fbh";
+
+const auto threadCount = "tc";
+const auto meshCache = "mch";
+const auto meshCacheSha256 = "mcs";
 
 const auto dumpAccessorComponents = "dac";
 
@@ -137,6 +162,10 @@ SyntaxFactory::SyntaxFactory() {
     registerFlag(ss, flag::sceneName, "sceneName", kString);
     registerFlag(ss, flag::scaleFactor, "scaleFactor", kDouble);
     registerFlag(ss, flag::binary, "binary", kNoArg);
+    registerFlag(ss, flag::streamGlb, "streamGlb", kNoArg);
+    registerFlag(ss, flag::asyncOutput, "asyncOutput", kNoArg);
+    registerFlag(ss, flag::asyncOutputMemory, "asyncOutputMemory", kLong);
+    registerFlag(ss, flag::profile, "profile", kString);
     registerFlag(ss, flag::separateAccessorBuffers, "separateAccessorBuffers", kNoArg);
     registerFlag(ss, flag::splitMeshAnimation, "splitMeshAnimation", kNoArg);
     registerFlag(ss, flag::splitByReference, "splitByReference", kNoArg);
@@ -149,6 +178,10 @@ SyntaxFactory::SyntaxFactory() {
     registerFlag(ss, flag::skipStandardMaterials, "skipStandardMaterials", kNoArg);
     registerFlag(ss, flag::skipMaterialTextures, "skipMaterialTextures", kNoArg);
     registerFlag(ss, flag::force32bitIndices, "force32bitIndices", kNoArg);
+    registerFlag(ss, flag::splitLargePrimitives, "splitLargePrimitives", kNoArg);
+    registerFlag(ss, flag::weldByIndices, "weldByIndices", kNoArg);
+    registerFlag(ss, flag::optimizeVertexCache, "optimizeVertexCache", kNoArg);
+    registerFlag(ss, flag::optimizeOverdraw, "optimizeOverdraw", kDouble);
     registerFlag(ss, flag::disableNameAssignment, "disableNameAssignment", kNoArg);
     registerFlag(ss, flag::mikkelsenTangentSpace, "mikkelsenTangentSpace", kNoArg);
     registerFlag(ss, flag::mikkelsenTangentAngularThreshold, "mikkelsenTangentAngularThreshold", kDouble);
@@ -158,6 +191,8 @@ SyntaxFactory::SyntaxFactory() {
     registerFlag(ss, flag::globalOpacityFactor, "globalOpacityFactor", kDouble);
     registerFlag(ss, flag::copyright, "copyright", kString);
     registerFlag(ss, flag::detectStepAnimations, "detectStepAnimations", kLong);
+    registerFlag(ss, flag::reduceKeyframes, "reduceKeyframes", kDouble);
+    registerFlag(ss, flag::reduceKeyframesAngle, "reduceKeyframesAngle", kDouble);
 
     registerFlag(ss, flag::animationClipFrameRate, "animationClipFrameRate", true, kDouble);
     registerFlag(ss, flag::animationClipName, "animationClipName", true, kString);
@@ -179,6 +214,16 @@ SyntaxFactory::SyntaxFactory() {
     registerFlag(ss, flag::visibleNodesOnly, "visibleNodesOnly", kNoArg);
 
     registerFlag(ss, flag::excludeUnusedTexcoord, "excludeUnusedTexcoord", kNoArg);
+    registerFlag(ss, flag::blendShapeTolerance, "blendShapeTolerance", kDouble);
+    registerFlag(ss, flag::sparseTargets, "sparseTargets", kDouble);
+    registerFlag(ss, flag::quantizeMeshes, "quantizeMeshes", kNoArg);
+    registerFlag(ss, flag::positionQuantizationError, "positionQuantizationError", kDouble);
+    registerFlag(ss, flag::normalQuantizationError, "normalQuantizationError", kDouble);
+    registerFlag(ss, flag::texCoordQuantizationError, "texCoordQuantizationError", kDouble);
+    registerFlag(ss, flag::colorQuantizationError, "colorQuantizationError", kDouble);
+    registerFlag(ss, flag::compactSkins, "compactSkins", kNoArg);
+    registerFlag(ss, flag::jointWeightQuantizationError, "jointWeightQuantizationError", kDouble);
+    registerFlag(ss, flag::maxJointInfluences, "maxJointInfluences", kLong);
 
     registerFlag(ss, flag::ignoreSegmentScaleCompensation, "ignoreSegmentScaleCompensation", kNoArg);
 
@@ -189,8 +234,13 @@ SyntaxFactory::SyntaxFactory() {
     registerFlag(ss, flag::forceAnimationSampling, "forceAnimationSampling", kNoArg);
 
     registerFlag(ss, flag::hashBufferURIs, "hashBufferUri", kNoArg);
+    registerFlag(ss, flag::fastBufferHash, "fastBufferHash", kNoArg);
     registerFlag(ss, flag::niceBufferURIs, "niceBufferNames", kNoArg);
 
+    registerFlag(ss, flag::threadCount, "threadCount", kLong);
+    registerFlag(ss, flag::meshCache, "meshCache", kString);
+    registerFlag(ss, flag::meshCacheSha256, "meshCacheSha256", kNoArg);
+
     registerFlag(ss, flag::convertUnsupportedImages, "convertUnsupportedImages", kNoArg);
     registerFlag(ss, flag::reportSkewedInverseBindMatrices, "reportSkewedInverseBindMatrices", kNoArg);
     registerFlag(ss, flag::clearOutputWindow, "clearOutputWindow", kNoArg);
@@ -454,11 +504,22 @@ Arguments::Arguments(const MArgList &args, const MSyntax &syntax) {
     cleanOutputFolder = adb.isFlagSet(flag::cleanOutputFolder);
 
     glb = adb.isFlagSet(flag::binary);
+    streamGlb = adb.isFlagSet(flag::streamGlb);
+
+    // Batch scripts might quit Maya right after the export, so always wait for the files there.
+    asyncOutput = adb.isFlagSet(flag::asyncOutput) && MGlobal::mayaState() == MGlobal::kInteractive;
+    adb.optional(flag::asyncOutputMemory, asyncOutputMemory);
 
     const fs::path outputFolderPath(outputFolder.asChar());
     m_mayaOutputStream = adb.getOutputStream(flag::dumpMaya, "Maya debug", outputFolderPath, m_mayaOutputFileStream);
     m_gltfOutputStream = adb.getOutputStream(flag::dumpGLTF, "glTF debug", outputFolderPath, m_gltfOutputFileStream);
 
+    MString profilePath;
+    if (adb.optional(flag::profile, profilePath)) {
+        const fs::path argumentPath(profilePath.asChar());
+        profileFile = (argumentPath.is_relative() ? outputFolderPath / argumentPath : argumentPath).string();
+    }
+
     dumpMaya = m_mayaOutputStream.get();
     dumpGLTF = m_gltfOutputStream.get();
     dumpAccessorComponents = adb.isFlagSet(flag::dumpAccessorComponents);
@@ -473,23 +534,39 @@ Arguments::Arguments(const MArgList &args, const MSyntax &syntax) {
     skipMaterialTextures = adb.isFlagSet(flag::skipMaterialTextures);
 
     force32bitIndices = adb.isFlagSet(flag::force32bitIndices);
+    splitLargePrimitives = adb.isFlagSet(flag::splitLargePrimitives);
+    weldByIndices = adb.isFlagSet(flag::weldByIndices);
+    adb.optional(flag::optimizeOverdraw, overdrawThreshold);
+    optimizeVertexCache = adb.isFlagSet(flag::optimizeVertexCache) || overdrawThreshold > 0;
     disableNameAssignment = adb.isFlagSet(flag::disableNameAssignment);
     keepObjectNamespace = adb.isFlagSet(flag::keepObjectNamespace);
     skipSkinClusters = adb.isFlagSet(flag::skipSkinClusters);
     skipBlendShapes = adb.isFlagSet(flag::skipBlendShapes);
     redrawViewport = adb.isFlagSet(flag::redrawViewport);
     excludeUnusedTexcoord = adb.isFlagSet(flag::excludeUnusedTexcoord);
+    adb.optional(flag::blendShapeTolerance, blendShapeTolerance);
+    adb.optional(flag::sparseTargets, sparseTargetDensity);
+    quantizeMeshes = adb.isFlagSet(flag::quantizeMeshes);
+    adb.optional(flag::positionQuantizationError, positionQuantizationError);
+    adb.optional(flag::normalQuantizationError, normalQuantizationError);
+    adb.optional(flag::texCoordQuantizationError, texCoordQuantizationError);
+    adb.optional(flag::colorQuantizationError, colorQuantizationError);
+    compactSkins = adb.isFlagSet(flag::compactSkins);
+    adb.optional(flag::jointWeightQuantizationError, jointWeightQuantizationError);
+    adb.optional(flag::maxJointInfluences, maxJointInfluences);
     ignoreSegmentScaleCompensation = adb.isFlagSet(flag::ignoreSegmentScaleCompensation);
     keepShapeNodes = adb.isFlagSet(flag::keepShapeNodes);
     bakeScalingFactor = adb.isFlagSet(flag::bakeScalingFactor);
     forceRootNode = adb.isFlagSet(flag::forceRootNode);
     forceAnimationChannels = adb.isFlagSet(flag::forceAnimationChannels);
     forceAnimationSampling = adb.isFlagSet(flag::forceAnimationSampling);
-    hashBufferURIs = adb.isFlagSet(flag::hashBufferURIs);
+    fastBufferHash = adb.isFlagSet(flag::fastBufferHash);
+    hashBufferURIs = adb.isFlagSet(flag::hashBufferURIs) || fastBufferHash;
     niceBufferURIs = adb.isFlagSet(flag::niceBufferURIs);
     convertUnsupportedImages = adb.isFlagSet(flag::convertUnsupportedImages);
     reportSkewedInverseBindMatrices = adb.isFlagSet(flag::reportSkewedInverseBindMatrices);
     clearOutputWindow = adb.isFlagSet(flag::clearOutputWindow);
+    sha256MeshCacheKeys = adb.isFlagSet(flag::meshCacheSha256);
 
     adb.optional(flag::globalOpacityFactor, opacityFactor);
 
@@ -520,6 +597,16 @@ Arguments::Arguments(const MArgList &args, const MSyntax &syntax) {
     debugNormalVectors = adb.isFlagSet(flag::debugNormalVectors);
 
     adb.optional(flag::detectStepAnimations, detectStepAnimations);
+    adb.optional(flag::reduceKeyframes, keyframeReductionTolerance);
+    adb.optional(flag::reduceKeyframesAngle, keyframeReductionAngle);
+    adb.optional(flag::threadCount, threadCount);
+
+    MString meshCachePath;
+    if (adb.optional(flag::meshCache, meshCachePath)) {
+        const fs::path argumentPath(meshCachePath.asChar());
+        meshCacheFolder = (argumentPath.is_relative() ? outputFolderPath / argumentPath : argumentPath).string();
+    }
+
     adb.optional(flag::debugVectorLength, debugVectorLength);
     adb.optional(flag::copyright, copyright);
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "CoreArguments.h"
 #include "IndentableStream.h"
 #include "sceneTypes.h"
 
@@ -53,7 +54,7 @@ struct MDagPathComparer {
 
 typedef std::set<MDagPath, MDagPathComparer> Selection;
 
-class Arguments {
+class Arguments : public CoreArguments {
   public:
     Arguments(const MArgList &args, const MSyntax &syntax);
     ~Arguments();
@@ -70,6 +71,18 @@ class Arguments {
     /** Before exporting, delete the output folder, recursively? */
     bool cleanOutputFolder = false;
 
+    /** Return as soon as the asset is built, and write the output files on
+     * a background thread? Only in an interactive Maya session */
+    bool asyncOutput = false;
+
+    /** The megabytes of file content that may wait to be written. Building
+     * the asset blocks when more is queued */
+    int asyncOutputMemory = 1024;
+
+    /** Where to write a Chrome trace of the export stages, empty when not
+     * profiling */
+    std::string profileFile;
+
     /* The extension to use for glTF files. Some viewers require lower-case
      * gltf, others might need the official glTF */
     MString gltfFileExtension = "gltf";
@@ -80,6 +93,10 @@ class Arguments {
     /** Outputs a single binary GLB file */
     bool glb = false;
 
+    /** Write the GLB binary chunk straight from the accessor and image data,
+     * instead of packing it into one big buffer in memory first */
+    bool streamGlb = false;
+
     /** Split the animation and mesh into two combined buffers? */
     bool splitMeshAnimation = false;
 
@@ -120,9 +137,6 @@ class Arguments {
     /** Clear the output window before exporting start */
     bool clearOutputWindow = false;
 
-    /** Always use 32-bit indices, even when 16-bit would be sufficient */
-    bool force32bitIndices = false;
-
     /** If non-null, dump the Maya intermediate objects to the stream */
     IndentableStream *dumpMaya;
 
@@ -136,9 +150,6 @@ class Arguments {
     /** When exporting as GLB, don't embed textures in the GLB file? */
     bool externalTextures = false;
 
-    /** By default the Maya node names are assigned to the GLTF node names */
-    bool disableNameAssignment = false;
-
     /** By default we remove the Maya object namespace from GLTF node names  */
     bool keepObjectNamespace = false;
 
@@ -151,30 +162,12 @@ class Arguments {
     /** The length of the debugging vectors */
     float debugVectorLength = 0.1f;
 
-    /** When non-0, instead of using Maya's tangents, use tangents as computed
-     * in Morten Mikkelsen's thesis
-     * http://image.diku.dk/projects/media/morten.mikkelsen.08.pdf*/
-    float mikkelsenTangentAngularThreshold = 0;
-
     /** The scale factor to apply to the vertex positions */
     float globalScaleFactor = 1;
 
     /** The opacity factor to apply to the material */
     float opacityFactor = 1;
 
-    /** The semantics (aka glTF attributes) that should be exported for the
-     * mains. Defaults to all semantics contained in the mesh */
-    MeshSemanticSet meshPrimitiveAttributes;
-
-    /** The semantics (aka glTF attributes) that should be exported for blend
-     * shapes. Defaults to NORMAL and TANGENT */
-    MeshSemanticSet blendPrimitiveAttributes;
-
-    /** Exclude TEXCOORD semantics (aka glTF attributes) when the mesh primitive
-     * doesn't have textures? By default TEXCOORD attributes are always included
-     */
-    bool excludeUnusedTexcoord = false;
-
     /** Ignore all skin clusters */
     bool skipSkinClusters = false;
 
@@ -200,19 +193,6 @@ class Arguments {
      * which case an extra root node is not always needed? */
     bool forceRootNode = false;
 
-    /** Force the creation of an animation channel for each node, even if the node doesn't contain any animation? */
-    bool forceAnimationChannels = false;
-
-    /** Force the sampling of an animation channel for each node, even if the node doesn't contain any animation? */
-    bool forceAnimationSampling = false;
-
-    /** Sample more frames to detect step functions in the animation? By default LINEAR interpolation is always used */
-    int detectStepAnimations = 0;
-
-    /** Use a hash of the buffer for its URI? Useful when exporting the same
-     * mesh buffer per animation scene */
-    bool hashBufferURIs = false;
-
     /**
      * The time where the 'initial values' of all nodes are to be found (aka
      * neutral base pose) By default the current time is used, unless animation
@@ -238,18 +218,6 @@ class Arguments {
      * too. */
     bool visibleNodesOnly = false;
 
-    /** Consider a translation animation path as constant if all values are below this threshold */
-    double constantTranslationThreshold = 1e-9;
-
-    /** Consider a rotation animation path as constant if all values are below this threshold */
-    double constantRotationThreshold = 1e-9;
-
-    /** Consider a scaling animation path as constant if all values are below this threshold */
-    double constantScalingThreshold = 1e-9;
-
-    /** Consider a blend shape weight animation path as constant if all values are below this threshold */
-    double constantWeightsThreshold = 1e-9;
-
     std::vector<AnimClipArg> animationClips;
 
     /** Copyright text of the exported file */
@@ -258,13 +226,9 @@ class Arguments {
     std::string assignName(GLTF::Object &glObj, const MDagPath &dagPath, const MString &suffix) const;
     std::string assignName(GLTF::Object &glObj, const MFnDependencyNode &node, const MString &suffix) const;
 
-    std::string makeName(const std::string &name) const { return disableNameAssignment ? "" : name; }
-
     float getBakeScaleFactor() const { return bakeScalingFactor ? globalScaleFactor : 1; }
     float getRootScaleFactor() const { return bakeScalingFactor ? 1 : globalScaleFactor; }
 
-    int getStepDetectSampleCount() const { return detectStepAnimations > 0 ? detectStepAnimations : 1; }
-
   private:
     DISALLOW_COPY_MOVE_ASSIGN(Arguments);
 
@@ -0,0 +1,190 @@
+#include "coreExternals.h"
+
+#include "AsyncFileWriter.h"
+#include "Profiler.h"
+
+AsyncFileWriter::AsyncFileWriter(const size_t maxPendingByteLength)
+    : m_maxPendingByteLength(maxPendingByteLength) {
+    m_thread = std::thread([this]() { work(); });
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+
+    m_queueChanged.notify_all();
+    m_thread.join();
+}
+
+void AsyncFileWriter::setMaxPendingByteLength(const size_t maxPendingByteLength) {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_maxPendingByteLength = maxPendingByteLength;
+    }
+
+    m_queueChanged.notify_all();
+}
+
+void AsyncFileWriter::write(std::string path, const std::ios_base::openmode mode, const size_t byteLength,
+                            ContentWriter writeContent) {
+    Job job;
+    job.path = std::move(path);
+    job.mode = mode;
+    job.byteLength = byteLength;
+    job.writeContent = std::move(writeContent);
+    enqueue(std::move(job));
+}
+
+void AsyncFileWriter::write(std::string path, std::vector<byte> bytes) {
+    const auto byteLength = bytes.size();
+
+    // std::function must be copyable, so share the bytes instead of moving these.
+    auto content = std::make_shared<std::vector<byte>>(std::move(bytes));
+
+    write(std::move(path), std::ios::out | std::ios::binary, byteLength, [content](std::ostream &out) {
+        out.write(reinterpret_cast<const char *>(content->data()), content->size());
+    });
+}
+
+std::future<void> AsyncFileWriter::endBatch(BatchReporter reporter) {
+    Job job;
+    job.batchPromise = std::make_unique<std::promise<void>>();
+    job.batchReporter = std::move(reporter);
+
+    auto future = job.batchPromise->get_future();
+    enqueue(std::move(job));
+    return future;
+}
+
+void AsyncFileWriter::cancelBatch() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // The queued files of the batch follow the end of the previous batch
+        while (!m_jobs.empty() && !m_jobs.back().batchPromise && !m_jobs.back().cancelsBatch) {
+            m_pendingByteLength -= m_jobs.back().byteLength;
+            m_jobs.pop_back();
+        }
+    }
+
+    // Release the space of the dropped files
+    m_queueChanged.notify_all();
+
+    Job job;
+    job.cancelsBatch = true;
+    enqueue(std::move(job));
+}
+
+void AsyncFileWriter::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queueChanged.wait(lock, [this]() { return m_jobs.empty() && !m_isWriting; });
+}
+
+void AsyncFileWriter::enqueue(Job job) {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // Bound the memory held by the queue, but never block on an empty queue.
+        m_queueChanged.wait(lock, [this, &job]() {
+            return m_pendingByteLength == 0 || m_pendingByteLength + job.byteLength <= m_maxPendingByteLength;
+        });
+
+        m_pendingByteLength += job.byteLength;
+        m_jobs.emplace_back(std::move(job));
+    }
+
+    m_queueChanged.notify_all();
+}
+
+void AsyncFileWriter::work() {
+    for (;;) {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueChanged.wait(lock, [this]() { return m_isStopping || !m_jobs.empty(); });
+
+            // Finish the queued files before stopping
+            if (m_jobs.empty())
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_isWriting = true;
+        }
+
+        run(job);
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_pendingByteLength -= job.byteLength;
+            m_isWriting = false;
+        }
+
+        // Release the content before waking up the waiting threads
+        job = Job();
+        m_queueChanged.notify_all();
+    }
+}
+
+void AsyncFileWriter::run(Job &job) {
+    if (job.batchPromise) {
+        if (m_batchError) {
+            job.batchPromise->set_exception(m_batchError);
+        } else {
+            job.batchPromise->set_value();
+        }
+
+        if (job.batchReporter) {
+            try {
+                job.batchReporter(m_batchErrorMessage);
+            } catch (...) {
+                // Reporting must not stop the writer
+            }
+        }
+
+        m_batchError = nullptr;
+        m_batchErrorMessage.clear();
+        m_batchPaths.clear();
+        return;
+    }
+
+    if (job.cancelsBatch) {
+        for (auto &path : m_batchPaths) {
+            std::remove(path.c_str());
+        }
+
+        m_batchError = nullptr;
+        m_batchErrorMessage.clear();
+        m_batchPaths.clear();
+        return;
+    }
+
+    // Skip the remaining files of a failed batch
+    if (m_batchError)
+        return;
+
+    try {
+        PROFILE_SCOPE("file.write");
+
+        std::ofstream file(job.path, job.mode);
+        if (!file.is_open())
+            throw std::runtime_error("Couldn't write to '" + job.path + "'");
+
+        m_batchPaths.push_back(job.path);
+
+        job.writeContent(file);
+        file.close();
+
+        if (!file)
+            throw std::runtime_error("Failed to write '" + job.path + "'");
+    } catch (const std::exception &ex) {
+        m_batchError = std::current_exception();
+        m_batchErrorMessage = ex.what();
+    } catch (...) {
+        m_batchError = std::current_exception();
+        m_batchErrorMessage = "Failed to write '" + job.path + "'";
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "BasicTypes.h"
+#include "macros.h"
+
+/**
+ * Writes files on a background thread, in the order these were queued, so
+ * the caller can continue while the content is flushed to disk. Each queued
+ * file owns its content. The files of one export form a batch: the first
+ * failure of a batch skips its remaining files, and is reported through the
+ * future of that batch. A failed export cancels its batch instead, which
+ * drops its queued files and deletes the ones already written.
+ */
+class AsyncFileWriter {
+  public:
+    typedef std::function<void(std::ostream &out)> ContentWriter;
+
+    /** Called on the writer thread when a batch is written, with the error
+     * message of its failure, or an empty message on success */
+    typedef std::function<void(const std::string &error)> BatchReporter;
+
+    /** Queuing a file blocks while more than maxPendingByteLength bytes of
+     * earlier files are waiting to be written */
+    explicit AsyncFileWriter(size_t maxPendingByteLength);
+
+    /** Waits for the queued files to be written, and joins the thread */
+    ~AsyncFileWriter();
+
+    void setMaxPendingByteLength(size_t maxPendingByteLength);
+
+    /** Queues a file of byteLength bytes. writeContent runs on the writer
+     * thread, so it must only use data that it owns */
+    void write(std::string path, std::ios_base::openmode mode,
+               size_t byteLength, ContentWriter writeContent);
+
+    /** Queues a binary file with the given bytes */
+    void write(std::string path, std::vector<byte> bytes);
+
+    /** Ends the batch of files queued since the previous batch. The future
+     * rethrows the first failure of the batch. */
+    std::future<void> endBatch(BatchReporter reporter = nullptr);
+
+    /** Drops the files queued since the previous batch, and deletes the
+     * ones of these that were already written */
+    void cancelBatch();
+
+    /** Waits until all queued files are written */
+    void wait();
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(AsyncFileWriter);
+
+    struct Job {
+        std::string path;
+        std::ios_base::openmode mode = std::ios::out;
+        size_t byteLength = 0;
+        ContentWriter writeContent;
+
+        // Only set for the job that ends a batch
+        std::unique_ptr<std::promise<void>> batchPromise;
+        BatchReporter batchReporter;
+
+        // Set for the job that ends a cancelled batch
+        bool cancelsBatch = false;
+    };
+
+    std::thread m_thread;
+    std::deque<Job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    size_t m_maxPendingByteLength;
+    size_t m_pendingByteLength = 0;
+    bool m_isWriting = false;
+    bool m_isStopping = false;
+
+    // The first failure of the current batch, only used by the thread
+    std::exception_ptr m_batchError;
+    std::string m_batchErrorMessage;
+
+    // The files written by the current batch, only used by the thread
+    std::vector<std::string> m_batchPaths;
+
+    void enqueue(Job job);
+    void work();
+    void run(Job &job);
+};
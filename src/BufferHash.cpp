@@ -0,0 +1,184 @@
+#include "coreExternals.h"
+
+#include "BufferHash.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "picosha2.h"
+
+namespace {
+// Changing this changes the hash of all buffers larger than one chunk
+const size_t chunkByteLength = size_t(4) << 20;
+
+// picosha2 copies its input before hashing it, so feed it in small pieces
+const size_t sha256PieceByteLength = size_t(64) << 10;
+
+const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t prime3 = 0x165667B19E3779F9ULL;
+const uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+// The seed of the high half of the fast hash
+const uint64_t highSeed = 0x6D2B79F5A24BAED4ULL;
+
+inline uint64_t rotl(const uint64_t value, const int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const byte *data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const byte *data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint64_t mixLane(uint64_t accumulator, const uint64_t lane) {
+    accumulator += lane * prime2;
+    accumulator = rotl(accumulator, 31);
+    return accumulator * prime1;
+}
+
+inline uint64_t mergeRound(uint64_t hash, const uint64_t accumulator) {
+    hash ^= mixLane(0, accumulator);
+    return hash * prime1 + prime4;
+}
+
+/** XXH64 of little-endian data */
+uint64_t xxh64(const byte *data, const size_t byteLength, const uint64_t seed) {
+    const auto end = data + byteLength;
+    uint64_t hash;
+
+    if (byteLength >= 32) {
+        // 4 independent lanes, so the multiplications can overlap.
+        uint64_t lanes[4] = {seed + prime1 + prime2, seed + prime2, seed, seed - prime1};
+
+        for (const auto limit = end - 32; data <= limit; data += 32) {
+            lanes[0] = mixLane(lanes[0], read64(data));
+            lanes[1] = mixLane(lanes[1], read64(data + 8));
+            lanes[2] = mixLane(lanes[2], read64(data + 16));
+            lanes[3] = mixLane(lanes[3], read64(data + 24));
+        }
+
+        hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+        for (auto lane : lanes) {
+            hash = mergeRound(hash, lane);
+        }
+    } else {
+        hash = seed + prime5;
+    }
+
+    hash += byteLength;
+
+    for (; data + 8 <= end; data += 8) {
+        hash ^= mixLane(0, read64(data));
+        hash = rotl(hash, 27) * prime1 + prime4;
+    }
+
+    if (data + 4 <= end) {
+        hash ^= read32(data) * prime1;
+        hash = rotl(hash, 23) * prime2 + prime3;
+        data += 4;
+    }
+
+    for (; data < end; ++data) {
+        hash ^= *data * prime5;
+        hash = rotl(hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+} // namespace
+
+BufferHash::BufferHash(ThreadPool &pool, const byte *data, const size_t byteLength, const Function function)
+    : m_function(function) {
+    const auto chunkCount = std::max<size_t>(1, (byteLength + chunkByteLength - 1) / chunkByteLength);
+    m_chunkDigests.resize(chunkCount);
+    m_pendingChunks.reserve(chunkCount);
+
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+        const auto byteOffset = chunkIndex * chunkByteLength;
+        const auto chunkLength = std::min(chunkByteLength, byteLength - byteOffset);
+        auto &chunkDigest = m_chunkDigests[chunkIndex];
+
+        m_pendingChunks.emplace_back(pool.submit([&chunkDigest, function, data, byteOffset, chunkLength]() {
+            PROFILE_SCOPE("asset.hashChunk");
+            chunkDigest = digest(function, data + byteOffset, chunkLength);
+        }));
+    }
+}
+
+BufferHash::~BufferHash() {
+    for (auto &pending : m_pendingChunks) {
+        if (pending.valid()) {
+            pending.wait();
+        }
+    }
+}
+
+std::string BufferHash::hex() {
+    for (auto &pending : m_pendingChunks) {
+        if (pending.valid()) {
+            pending.get();
+        }
+    }
+
+    return combinedHex(m_function, m_chunkDigests);
+}
+
+std::string BufferHash::hex(const byte *data, const size_t byteLength, const Function function) {
+    std::vector<Digest> chunkDigests;
+    for (size_t byteOffset = 0; byteOffset < byteLength || chunkDigests.empty(); byteOffset += chunkByteLength) {
+        const auto chunkLength = std::min(chunkByteLength, byteLength - byteOffset);
+        chunkDigests.emplace_back(digest(function, data + byteOffset, chunkLength));
+    }
+
+    return combinedHex(function, chunkDigests);
+}
+
+std::string BufferHash::combinedHex(const Function function, const std::vector<Digest> &chunkDigests) {
+    if (chunkDigests.size() == 1)
+        return picosha2::bytes_to_hex_string(chunkDigests.front());
+
+    Digest digests;
+    for (auto &chunkDigest : chunkDigests) {
+        digests.insert(digests.end(), chunkDigest.begin(), chunkDigest.end());
+    }
+
+    return picosha2::bytes_to_hex_string(digest(function, digests.data(), digests.size()));
+}
+
+BufferHash::Digest BufferHash::digest(const Function function, const byte *data, const size_t byteLength) {
+    if (function == FAST128) {
+        const uint64_t halves[2] = {xxh64(data, byteLength, highSeed), xxh64(data, byteLength, 0)};
+
+        // Big-endian, so the hex digits read as the two 64-bit hashes
+        Digest result;
+        for (auto half : halves) {
+            for (auto shift = 56; shift >= 0; shift -= 8) {
+                result.push_back(byte(half >> shift));
+            }
+        }
+        return result;
+    }
+
+    picosha2::hash256_one_by_one hasher;
+    for (size_t offset = 0; offset < byteLength; offset += sha256PieceByteLength) {
+        const auto pieceEnd = data + std::min(byteLength, offset + sha256PieceByteLength);
+        hasher.process(data + offset, pieceEnd);
+    }
+    hasher.finish();
+
+    Digest result(picosha2::k_digest_size);
+    hasher.get_hash_bytes(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "BasicTypes.h"
+#include "macros.h"
+
+class ThreadPool;
+
+/**
+ * The content hash of a buffer, used for its URI. The buffer is hashed in
+ * fixed-size chunks on a thread pool, while the caller continues. A buffer
+ * of a single chunk gets the plain hash of its bytes, a larger one the hash
+ * of the concatenated hashes of its chunks. Since the chunk size is fixed,
+ * the hash doesn't depend on the number of threads.
+ */
+class BufferHash {
+  public:
+    enum Function {
+        /** SHA-256, 64 hex digits */
+        SHA256,
+
+        /** A non-cryptographic 128-bit hash, based on XXH64, 32 hex digits.
+         * Many times faster, but only detects accidental changes */
+        FAST128
+    };
+
+    /** Queues the hashing of the chunks. The data must stay alive and
+     * unchanged until hex() returns */
+    BufferHash(ThreadPool &pool, const byte *data, size_t byteLength,
+               Function function);
+
+    /** Waits for the queued chunks */
+    ~BufferHash();
+
+    /** Waits for the chunks, and combines their hashes */
+    std::string hex();
+
+    /** The same hash, computed serially on the calling thread */
+    static std::string hex(const byte *data, size_t byteLength,
+                           Function function);
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(BufferHash);
+
+    typedef std::vector<byte> Digest;
+
+    const Function m_function;
+    std::vector<Digest> m_chunkDigests;
+    std::vector<std::future<void>> m_pendingChunks;
+
+    static Digest digest(Function function, const byte *data,
+                         size_t byteLength);
+
+    static std::string combinedHex(Function function,
+                                   const std::vector<Digest> &chunkDigests);
+};
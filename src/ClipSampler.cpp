@@ -0,0 +1,94 @@
+#include "externals.h"
+
+#include "ClipSampler.h"
+#include "ExportableClip.h"
+#include "Profiler.h"
+#include "Transform.h"
+#include "progress.h"
+#include "timeControl.h"
+
+namespace {
+/** One (super) sample of one clip */
+struct ClipSample {
+    // The sample time, in half Maya ticks, so that equal times of different
+    // clips compare equal, regardless of floating point round-off.
+    int64_t key;
+    MTime time;
+    ExportableClip *clip;
+    int relativeFrameIndex;
+    int superSampleIndex;
+};
+
+int64_t timeKey(const MTime &time) {
+    const double halfTicksPerSecond = 2.0 * 141120000;
+    return std::llround(time.as(MTime::kSeconds) * halfTicksPerSecond);
+}
+} // namespace
+
+void sampleClips(const Arguments &args, const std::vector<ExportableClip *> &clips) {
+    PROFILE_STAGE("clips.sample");
+
+    std::vector<ClipSample> samples;
+
+    size_t sampleCount = 0;
+    for (auto clip : clips) {
+        sampleCount += size_t(clip->clipArg.frameCount()) * clip->sampleCountPerFrame();
+    }
+
+    samples.reserve(sampleCount);
+
+    for (auto clip : clips) {
+        const auto frameCount = clip->clipArg.frameCount();
+        const auto superSampleCount = clip->sampleCountPerFrame();
+
+        for (int relativeFrameIndex = 0; relativeFrameIndex < frameCount; ++relativeFrameIndex) {
+            for (int superSampleIndex = 0; superSampleIndex < superSampleCount; ++superSampleIndex) {
+                const auto time = clip->sampleTime(relativeFrameIndex, superSampleIndex);
+                samples.push_back({timeKey(time), time, clip, relativeFrameIndex, superSampleIndex});
+            }
+        }
+    }
+
+    // Stable, so each clip still receives its samples in order
+    std::stable_sort(samples.begin(), samples.end(), [](const ClipSample &a, const ClipSample &b) { return a.key < b.key; });
+
+    size_t timeCount = 0;
+
+    // The transforms are shared by all clips sampling the same time
+    NodeTransformCache transformCache;
+
+    for (auto begin = samples.begin(); begin != samples.end();) {
+        const auto end = std::find_if(begin, samples.end(), [begin](const ClipSample &s) { return s.key != begin->key; });
+
+        const bool isFrame = std::any_of(begin, end, [](const ClipSample &s) { return s.superSampleIndex == 0; });
+
+        {
+            PROFILE_SCOPE("clips.setTime");
+            setCurrentTime(begin->time, args.redrawViewport && isFrame);
+        }
+
+        ++timeCount;
+
+        transformCache.clear();
+
+        for (auto sample = begin; sample != end; ++sample) {
+            sample->clip->sampleAt(sample->time, sample->relativeFrameIndex, sample->superSampleIndex, transformCache);
+        }
+
+        for (auto sample = begin; sample != end; ++sample) {
+            const auto relativeFrameIndex = sample->relativeFrameIndex;
+
+            if (sample->superSampleIndex == 0 && relativeFrameIndex % checkProgressFrameInterval == checkProgressFrameInterval - 1) {
+                const auto &clipArg = sample->clip->clipArg;
+                uiAdvanceProgress("exporting clip '" + clipArg.name + formatted("' %d%%", relativeFrameIndex * 100 / clipArg.frameCount()));
+            }
+        }
+
+        begin = end;
+    }
+
+    if (clips.size() > 1) {
+        cout << prefix << "Sampled " << clips.size() << " clips at " << timeCount << " distinct times, instead of " << samples.size()
+             << endl;
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+class ExportableClip;
+class Arguments;
+
+/**
+ * Samples all animation clips in a single pass over the timeline. The
+ * sample times of all clips, including the step detection super-samples,
+ * are merged, so every distinct time is evaluated by Maya only once, and
+ * the sampled values are handed to all clips that need them.
+ */
+void sampleClips(const Arguments &args, const std::vector<ExportableClip *> &clips);
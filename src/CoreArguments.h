@@ -0,0 +1,161 @@
+#pragma once
+
+#include "sceneTypes.h"
+
+/**
+ * The export options that are used by the Maya-free core stages (welding,
+ * primitive and animation building, buffer packing). The Maya plugin fills
+ * these from the MEL command arguments, tools can fill them directly.
+ */
+struct CoreArguments {
+    CoreArguments() = default;
+    virtual ~CoreArguments() = default;
+
+    /** Always use 32-bit indices, even when 16-bit would be sufficient */
+    bool force32bitIndices = false;
+
+    /** Split primitives with more vertices than 16-bit indices can address
+     * into several primitives, instead of using 32-bit indices */
+    bool splitLargePrimitives = false;
+
+    /** By default the Maya node names are assigned to the GLTF node names */
+    bool disableNameAssignment = false;
+
+    /** When non-0, instead of using Maya's tangents, use tangents as computed
+     * in Morten Mikkelsen's thesis
+     * http://image.diku.dk/projects/media/morten.mikkelsen.08.pdf*/
+    float mikkelsenTangentAngularThreshold = 0;
+
+    /** The semantics (aka glTF attributes) that should be exported for the
+     * mains. Defaults to all semantics contained in the mesh */
+    MeshSemanticSet meshPrimitiveAttributes;
+
+    /** The semantics (aka glTF attributes) that should be exported for blend
+     * shapes. Defaults to NORMAL and TANGENT */
+    MeshSemanticSet blendPrimitiveAttributes;
+
+    /** Only weld face-vertices that share the same element indices, without
+     * comparing the component values of all shapes. Faster, but vertices
+     * with equal values and different indices are not merged. By default
+     * these are merged */
+    bool weldByIndices = false;
+
+    /** Reorder the triangles of each primitive for the post-transform vertex
+     * cache, and the vertices in the order they are fetched */
+    bool optimizeVertexCache = false;
+
+    /** When non-0, also reorder clusters of triangles to reduce overdraw,
+     * allowing this ratio of the cache miss ratio after and before */
+    double overdrawThreshold = 0;
+
+    /** Blend-shape elements that differ at most this much from the main shape
+     * are not stored, and export as zero deltas */
+    double blendShapeTolerance = 0;
+
+    /** When non-0, store the blend-shape attributes as sparse accessors when
+     * at most this fraction of their vertices differs from the main shape,
+     * and that is smaller than a dense accessor */
+    double sparseTargetDensity = 0;
+
+    /** Store the vertex attributes as KHR_mesh_quantization integers, when
+     * these stay within the quantization error bounds below */
+    bool quantizeMeshes = false;
+
+    /** The maximum quantization error of positions, in scene units. Meshes
+     * that need more precision keep FLOAT positions */
+    double positionQuantizationError = 0.01;
+
+    /** The maximum quantization error of normal and tangent components */
+    double normalQuantizationError = 0.005;
+
+    /** The maximum quantization error of texture coordinate components */
+    double texCoordQuantizationError = 1e-4;
+
+    /** The maximum quantization error of color components */
+    double colorQuantizationError = 0.002;
+
+    /** Leave the joints that weigh no vertex out of the skins, and store the
+     * JOINTS as bytes when at most 256 joints remain, and the WEIGHTS as
+     * normalized integers */
+    bool compactSkins = false;
+
+    /** The maximum quantization error of the compact skin weights */
+    double jointWeightQuantizationError = 0.004;
+
+    /** When non-0, keep at most this many of the heaviest joint weights per
+     * vertex, and renormalise these */
+    int maxJointInfluences = 0;
+
+    /** Exclude TEXCOORD semantics (aka glTF attributes) when the mesh primitive
+     * doesn't have textures? By default TEXCOORD attributes are always included
+     */
+    bool excludeUnusedTexcoord = false;
+
+    /** Force the creation of an animation channel for each node, even if the node doesn't contain any animation? */
+    bool forceAnimationChannels = false;
+
+    /** Force the sampling of an animation channel for each node, even if the node doesn't contain any animation? */
+    bool forceAnimationSampling = false;
+
+    /** Sample more frames to detect step functions in the animation? By default LINEAR interpolation is always used */
+    int detectStepAnimations = 0;
+
+    /** When non-0, drop the sampled keys of translation, scale and weight
+     * channels that interpolating the remaining keys reproduces within this
+     * tolerance, per component */
+    double keyframeReductionTolerance = 0;
+
+    /** When non-0, drop the sampled keys of rotation channels that
+     * interpolating the remaining keys reproduces within this angle, in
+     * degrees */
+    double keyframeReductionAngle = 0;
+
+    /** Use a hash of the buffer for its URI? Useful when exporting the same
+     * mesh buffer per animation scene */
+    bool hashBufferURIs = false;
+
+    /** Hash the buffer URIs with a non-cryptographic 128-bit hash instead
+     * of SHA-256? Implies hashBufferURIs */
+    bool fastBufferHash = false;
+
+    /** The number of threads used to process meshes after their Maya data is
+     * extracted. 0 uses one thread per hardware thread, 1 exports serially */
+    int threadCount = 0;
+
+    /** When not empty, the folder of the mesh cache, holding the welded
+     * vertex buffers of each mesh, keyed by a hash of its geometry. Unchanged
+     * meshes are loaded from it instead of being welded again */
+    std::string meshCacheFolder;
+
+    /** Key the mesh cache with SHA-256 instead of the much faster
+     * non-cryptographic 128-bit hash? */
+    bool sha256MeshCacheKeys = false;
+
+    /** Consider a translation animation path as constant if all values are below this threshold */
+    double constantTranslationThreshold = 1e-9;
+
+    /** Consider a rotation animation path as constant if all values are below this threshold */
+    double constantRotationThreshold = 1e-9;
+
+    /** Consider a scaling animation path as constant if all values are below this threshold */
+    double constantScalingThreshold = 1e-9;
+
+    /** Consider a blend shape weight animation path as constant if all values are below this threshold */
+    double constantWeightsThreshold = 1e-9;
+
+    std::string makeName(const std::string &name) const { return disableNameAssignment ? "" : name; }
+
+    /** The keyframe reduction tolerance of an animation path; radians for
+     * rotations. 0 when the keys should not be reduced */
+    double getKeyframeTolerance(const GLTF::Animation::Path path) const {
+        const double radiansPerDegree = 3.14159265358979323846 / 180;
+        if (forceAnimationSampling)
+            return 0;
+        return path == GLTF::Animation::Path::ROTATION ? keyframeReductionAngle * radiansPerDegree : keyframeReductionTolerance;
+    }
+
+    int getStepDetectSampleCount() const { return detectStepAnimations > 0 ? detectStepAnimations : 1; }
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(CoreArguments);
+};
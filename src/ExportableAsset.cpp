@@ -2,16 +2,33 @@
 
 #include "AccessorPacker.h"
 #include "Arguments.h"
+#include "BufferHash.h"
+#include "ClipSampler.h"
 #include "ExportableAsset.h"
+#include "GlbWriter.h"
+#include "Profiler.h"
+#include "SparseAccessor.h"
 #include "filesystem.h"
 #include "milo.h"
-#include "picosha2.h"
 #include "progress.h"
 #include "timeControl.h"
 #include "version.h"
 
 using GLTF::Constants::WebGL;
 
+namespace {
+/** The data of a buffer for the writer: taken over from the packer, or copied
+ * when the buffer belongs to an accessor of the asset */
+std::shared_ptr<const byte> takeBufferData(AccessorPacker &packer, const GLTF::Buffer *buffer) {
+    if (auto data = packer.releaseData(buffer))
+        return std::shared_ptr<const byte>(data.release(), std::default_delete<byte[]>());
+
+    std::shared_ptr<byte> copy(new byte[buffer->byteLength], std::default_delete<byte[]>());
+    std::memcpy(copy.get(), buffer->data, buffer->byteLength);
+    return copy;
+}
+} // namespace
+
 struct MStringComparer {
     bool operator()(const MString &a, const MString &b) const { return strcmp(a.asChar(), b.asChar()) < 0; }
 };
@@ -40,6 +57,10 @@ ExportableAsset::ExportableAsset(const Arguments &args) : m_resources{args}, m_s
         remove_all(outputFolder);
     }
 
+    if (!args.meshCacheFolder.empty()) {
+        create_directories(fs::path(args.meshCacheFolder));
+    }
+
     const auto currentFrameTime = MAnimControl::currentTime();
 
     setCurrentTime(args.initialValuesTime, args.redrawViewport);
@@ -64,6 +85,16 @@ ExportableAsset::ExportableAsset(const Arguments &args) : m_resources{args}, m_s
         m_scene.getNode(dagPath);
     }
 
+    // The meshes are welded and converted on worker threads while the next
+    // mesh is extracted from Maya; wait for all of them.
+    m_scene.finishMeshes();
+
+    if (m_scene.hasQuantizedMeshes()) {
+        // Integer positions are not valid glTF without the extension
+        m_glAsset.extensionsUsed.insert("KHR_mesh_quantization");
+        m_glAsset.extensionsRequired.insert("KHR_mesh_quantization");
+    }
+
     if (!args.keepShapeNodes) {
         m_scene.mergeRedundantShapeNodes();
     }
@@ -73,9 +104,19 @@ ExportableAsset::ExportableAsset(const Arguments &args) : m_resources{args}, m_s
     const auto clipCount = args.animationClips.size();
 
     if (clipCount) {
+        std::vector<std::unique_ptr<ExportableClip>> clips;
+        std::vector<ExportableClip *> clipPtrs;
+
         for (auto &clipArg : args.animationClips) {
             uiAdvanceProgress("exporting clip " + clipArg.name);
-            auto clip = std::make_unique<ExportableClip>(args, clipArg, m_scene);
+            clips.emplace_back(std::make_unique<ExportableClip>(args, clipArg, m_scene));
+            clipPtrs.emplace_back(clips.back().get());
+        }
+
+        sampleClips(args, clipPtrs);
+
+        for (auto &clip : clips) {
+            clip->finish(m_resources.threadPool());
             if (!clip->glAnimation.channels.empty()) {
                 m_glAsset.animations.push_back(&clip->glAnimation);
                 m_clips.emplace_back(std::move(clip));
@@ -147,7 +188,9 @@ const std::string &ExportableAsset::prettyJsonString() const {
     return m_prettyJsonString;
 }
 
-void ExportableAsset::save() {
+std::future<void> ExportableAsset::save(AsyncFileWriter &writer, AsyncFileWriter::BatchReporter reporter) {
+    PROFILE_STAGE("asset.save");
+
     const auto &args = m_resources.arguments();
 
     const auto sceneName = std::string(args.sceneName.asChar());
@@ -185,7 +228,8 @@ void ExportableAsset::save() {
     options.name = args.sceneName.asChar();
     options.binary = args.glb;
 
-    AccessorPacker bufferPacker;
+    // When streaming a GLB, the packed buffer is never materialized in memory
+    AccessorPacker bufferPacker(args.glb && args.streamGlb);
 
     PackedBufferMap packedBufferMap;
 
@@ -225,6 +269,15 @@ void ExportableAsset::save() {
         auto index = 0;
         for (auto accessor : allAccessors) {
             const auto name = accessor->name.empty() ? "buffer" + std::to_string(index) : accessor->name;
+            if (!accessor->bufferView) {
+                // A sparse accessor, give its indices and values a buffer of their own.
+                const auto buffer = bufferPacker.packAccessors({accessor}, name);
+                if (buffer) {
+                    packedBufferMap[buffer] = name;
+                }
+                ++index;
+                continue;
+            }
             accessor->bufferView->name = name;
             accessor->bufferView->buffer->name = name;
             packedBufferMap[accessor->bufferView->buffer] = name;
@@ -254,7 +307,7 @@ void ExportableAsset::save() {
                 for (GLTF::Image *image : images) {
                     const auto bufferView = new GLTF::BufferView(byteOffset, image->byteLength, buffer);
                     image->bufferView = bufferView;
-                    std::memcpy(buffer->data + byteOffset, image->data, image->byteLength);
+                    bufferPacker.addData(buffer, byteOffset, image->data, image->byteLength);
                     byteOffset += image->byteLength;
                 }
             }
@@ -281,13 +334,36 @@ void ExportableAsset::save() {
         }
     }
 
-    if (args.hashBufferURIs) {
+    // A streamed buffer has no data to hash, and is embedded in the GLB anyway
+    const auto hashBufferURIs = args.hashBufferURIs && !bufferPacker.isStreaming();
+
+    // Hash all buffers on the thread pool, while the images are queued.
+    std::vector<std::unique_ptr<BufferHash>> bufferHashes;
+    if (hashBufferURIs) {
+        const auto hashFunction = args.fastBufferHash ? BufferHash::FAST128 : BufferHash::SHA256;
+        for (const auto &pair : packedBufferMap) {
+            const auto buffer = pair.first;
+            bufferHashes.emplace_back(std::make_unique<BufferHash>(m_resources.threadPool(), buffer->data,
+                                                                   buffer->byteLength, hashFunction));
+        }
+    }
+
+    if (!options.embeddedTextures) {
+        for (GLTF::Image *image : m_glAsset.getAllImages()) {
+            fs::path uri = outputFolder / image->uri;
+            writer.write(uri.generic_string(), std::vector<byte>(image->data, image->data + image->byteLength));
+        }
+    }
+
+    if (hashBufferURIs) {
+        PROFILE_SCOPE("asset.hash");
+
         // Generate hash buffer URIs
+        auto bufferHash = bufferHashes.begin();
         for (const auto &pair : packedBufferMap) {
             auto buffer = pair.first;
 
-            std::string hash_hex_str;
-            picosha2::hash256_hex_string(buffer->data, buffer->data + buffer->byteLength, hash_hex_str);
+            const auto hash_hex_str = (*bufferHash++)->hex();
 
             std::string filename = pair.second;
             makeValidFilename(filename);
@@ -300,39 +376,35 @@ void ExportableAsset::save() {
     }
 
     // Generate glTF JSON file
-    rapidjson::StringBuffer jsonStringBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(jsonStringBuffer);
-    jsonWriter.StartObject();
+    {
+        PROFILE_SCOPE("asset.json");
 
-    m_glAsset.writeJSON(&jsonWriter, &options);
-    jsonWriter.EndObject();
+        rapidjson::StringBuffer jsonStringBuffer;
+        rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(jsonStringBuffer);
+        jsonWriter.StartObject();
 
-    m_rawJsonString = jsonStringBuffer.GetString();
+        m_glAsset.writeJSON(&jsonWriter, &options);
+        jsonWriter.EndObject();
+
+        m_rawJsonString = jsonStringBuffer.GetString();
+    }
 
     const auto outputFilename = args.sceneName + "." + (args.glb ? args.glbFileExtension : args.gltfFileExtension);
     const auto outputPath = outputFolder / outputFilename.asChar();
 
     cout << prefix << "Writing glTF file to '" << outputPath << "'" << endl;
 
-    if (!options.embeddedTextures) {
-        for (GLTF::Image *image : m_glAsset.getAllImages()) {
-            fs::path uri = outputFolder / image->uri;
-            std::ofstream file;
-            create(file, uri.generic_string(), ios::out | ios::binary);
-            file.write(reinterpret_cast<char *>(image->data), image->byteLength);
-            file.close();
-        }
-    }
-
     if (!options.embeddedBuffers) {
         for (const auto &pair : packedBufferMap) {
             const auto buffer = pair.first;
             if (buffer->data && buffer->byteLength) {
                 fs::path uri = outputFolder / buffer->uri;
-                std::ofstream file;
-                create(file, uri.generic_string(), ios::out | ios::binary);
-                file.write(reinterpret_cast<char *>(buffer->data), buffer->byteLength);
-                file.close();
+                const auto data = takeBufferData(bufferPacker, buffer);
+                const size_t byteLength = buffer->byteLength;
+                writer.write(uri.generic_string(), ios::out | ios::binary, byteLength,
+                             [data, byteLength](std::ostream &out) {
+                                 out.write(reinterpret_cast<const char *>(data.get()), byteLength);
+                             });
             }
         }
     }
@@ -340,69 +412,36 @@ void ExportableAsset::save() {
     if (!options.embeddedShaders) {
         for (GLTF::Shader *shader : m_glAsset.getAllShaders()) {
             fs::path uri = outputFolder / shader->uri;
-            std::ofstream file;
-            create(file, uri.generic_string(), ios::out | ios::binary);
-            file.write(shader->source.c_str(), shader->source.length());
-            file.close();
+            writer.write(uri.generic_string(), std::vector<byte>(shader->source.begin(), shader->source.end()));
         }
     }
 
     // Write glTF file.
-    {
-        const auto &jsonString = m_rawJsonString;
-
-        std::ofstream file;
-        create(file, outputPath.string(), ios::out | (args.glb ? ios::binary : std::ios_base::openmode(0)));
-
-        if (args.glb) {
-            assert(packedBufferMap.size() <= 1);
-            const auto maybeBuffer = packedBufferMap.empty() ? nullptr : packedBufferMap.begin()->first;
-            const auto bufferLength = maybeBuffer ? maybeBuffer->byteLength : 0;
-
-            file.write("glTF", 4); // magic header
-
-            const auto writeHeader = new uint32_t[2];
-            writeHeader[0] = 2; // version
-
-            const int jsonLength = static_cast<int>(jsonString.length());
-            const int jsonPadding = (4 - (jsonLength & 3)) & 3;
-            const int binPadding = (4 - (bufferLength & 3)) & 3;
-
-            const int headerLength = 12;
-            const int chunkHeaderLength = 8;
+    if (args.glb) {
+        assert(packedBufferMap.size() <= 1);
+        const auto maybeBuffer = packedBufferMap.empty() ? nullptr : packedBufferMap.begin()->first;
+        const size_t bufferLength = maybeBuffer ? maybeBuffer->byteLength : 0;
 
-            const int dataChunkSize = bufferLength ? (chunkHeaderLength + bufferLength + binPadding) : 0;
-
-            writeHeader[1] = headerLength + (chunkHeaderLength + jsonLength + jsonPadding) + dataChunkSize; // length
-
-            file.write(reinterpret_cast<char *>(writeHeader),
-                       sizeof(uint32_t) * 2); // GLB header
-
-            writeHeader[0] = jsonLength + jsonPadding; // chunkLength
-            writeHeader[1] = 0x4E4F534A;               // chunkType JSON
-            file.write(reinterpret_cast<char *>(writeHeader), sizeof(uint32_t) * 2);
-
-            file.write(jsonString.c_str(), jsonLength);
-            for (int i = 0; i < jsonPadding; i++) {
-                file.write(" ", 1);
-            }
-
-            if (bufferLength) {
-                writeHeader[0] = bufferLength + binPadding; // chunkLength
-                writeHeader[1] = 0x004E4942;                // chunkType BIN
-                file.write(reinterpret_cast<char *>(writeHeader), sizeof(uint32_t) * 2);
-
-                file.write(reinterpret_cast<char *>(maybeBuffer->data), bufferLength);
-                for (int i = 0; i < binPadding; i++) {
-                    file.write("\0", 1);
-                }
-            }
+        if (bufferPacker.isStreaming()) {
+            // The binary chunk is streamed from the accessors of this asset, so it can't be written later.
+            PROFILE_SCOPE("file.write");
 
+            std::ofstream file;
+            create(file, outputPath.string(), ios::out | ios::binary);
+            writeGLB(file, m_rawJsonString, bufferLength,
+                     [&](std::ostream &out) { bufferPacker.writeBuffer(out, maybeBuffer); });
+            file.close();
         } else {
-            file << prettyJsonString() << endl;
+            const auto data = maybeBuffer ? takeBufferData(bufferPacker, maybeBuffer) : nullptr;
+            writer.write(outputPath.string(), ios::out | ios::binary, m_rawJsonString.size() + bufferLength,
+                         [json = m_rawJsonString, data, bufferLength](std::ostream &out) {
+                             writeGLB(out, json, data.get(), bufferLength);
+                         });
         }
-
-        file.close();
+    } else {
+        const auto &jsonString = prettyJsonString();
+        writer.write(outputPath.string(), ios::out, jsonString.size(),
+                     [jsonString](std::ostream &out) { out << jsonString << endl; });
     }
 
     if (args.dumpGLTF) {
@@ -411,6 +450,8 @@ void ExportableAsset::save() {
         out << prettyJsonString();
         out << endl;
     }
+
+    return writer.endBatch(std::move(reporter));
 }
 
 void ExportableAsset::packMeshAccessors(AccessorsPerDagPath &accessorsPerDagPath, AccessorPacker &packer,
@@ -494,18 +535,13 @@ void ExportableAsset::create(std::ofstream &file, const std::string &path, const
 }
 
 template <typename T>
-void ExportableAsset::dumpAccessorComponentValues(const GLTF::Accessor *accessor, int fileIndex, bool isInteger) const {
+void ExportableAsset::dumpAccessorComponentValues(const GLTF::Accessor *accessor, std::string filename, bool isInteger) const {
     // NOTE: Because formatting with std::ostream is so slow,
     // we use the milo.h implementation for fast floating point printing.
     const auto &args = m_resources.arguments();
     const auto outputFolder = fs::path(args.outputFolder.asChar());
 
     std::ofstream ofs;
-    std::string filename = accessor->name;
-    if (filename.empty()) {
-        filename = std::string(args.sceneName.asChar()) + "_" + std::to_string(fileIndex);
-    }
-
     makeValidFilename(filename);
 
     ofs.open((outputFolder / (filename + ".txt")).c_str(), std::ofstream::out | std::ofstream::binary);
@@ -548,25 +584,42 @@ void ExportableAsset::dumpAccessorComponentValues(const GLTF::Accessor *accessor
 void ExportableAsset::dumpAccessorComponents(const std::vector<GLTF::Accessor *> &accessors) const {
     int fileIndex = 0;
 
+    const auto &args = m_resources.arguments();
+
     for (auto &&accessor : accessors) {
-        switch (accessor->componentType) {
-        case WebGL::FLOAT:
-            dumpAccessorComponentValues<float>(accessor, fileIndex, false);
-            break;
-        case WebGL::UNSIGNED_INT:
-            dumpAccessorComponentValues<uint32_t>(accessor, fileIndex, true);
-            break;
-        case WebGL::UNSIGNED_SHORT:
-            dumpAccessorComponentValues<uint16_t>(accessor, fileIndex, true);
-            break;
-        default:
-            // TODO: Add support for other accessor component types.
-            MayaException::printError("Unsupported accessor component " +
-                                          std::to_string(static_cast<int>(accessor->componentType)),
-                                      MStatus::kNotImplemented);
-            break;
+        auto filename = accessor->name;
+        if (filename.empty()) {
+            filename = std::string(args.sceneName.asChar()) + "_" + std::to_string(fileIndex);
+        }
+
+        if (auto sparseAccessor = dynamic_cast<const SparseAccessor *>(accessor)) {
+            // Only the non-zero elements are stored, with their indices
+            dumpAccessorComponents(sparseAccessor->indices(), filename + "_indices");
+            dumpAccessorComponents(sparseAccessor->values(), filename + "_values");
+        } else if (accessor->bufferView) {
+            dumpAccessorComponents(accessor, filename);
         }
 
         ++fileIndex;
     }
 }
+
+void ExportableAsset::dumpAccessorComponents(const GLTF::Accessor *accessor, const std::string &filename) const {
+    switch (accessor->componentType) {
+    case WebGL::FLOAT:
+        dumpAccessorComponentValues<float>(accessor, filename, false);
+        break;
+    case WebGL::UNSIGNED_INT:
+        dumpAccessorComponentValues<uint32_t>(accessor, filename, true);
+        break;
+    case WebGL::UNSIGNED_SHORT:
+        dumpAccessorComponentValues<uint16_t>(accessor, filename, true);
+        break;
+    default:
+        // TODO: Add support for other accessor component types.
+        MayaException::printError("Unsupported accessor component " +
+                                      std::to_string(static_cast<int>(accessor->componentType)),
+                                  MStatus::kNotImplemented);
+        break;
+    }
+}
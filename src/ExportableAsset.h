@@ -1,4 +1,5 @@
 #pragma once
+#include "AsyncFileWriter.h"
 #include "ExportableClip.h"
 #include "ExportableResources.h"
 #include "ExportableScene.h"
@@ -15,7 +16,10 @@ class ExportableAsset {
 
     const std::string &prettyJsonString() const;
 
-    void save();
+    /** Queues the output files on the writer. The returned future rethrows
+     * the first failure to write these; the reporter is also told */
+    std::future<void> save(AsyncFileWriter &writer,
+                           AsyncFileWriter::BatchReporter reporter = nullptr);
 
   private:
     DISALLOW_COPY_MOVE_ASSIGN(ExportableAsset);
@@ -46,6 +50,9 @@ class ExportableAsset {
     void dumpAccessorComponents(
         const std::vector<GLTF::Accessor *> &accessors) const;
 
+    void dumpAccessorComponents(const GLTF::Accessor *accessor,
+                                const std::string &filename) const;
+
     void packMeshAccessors(AccessorsPerDagPath &accessors,
                            class AccessorPacker &packer,
                            PackedBufferMap &packedBufferMap,
@@ -56,5 +63,6 @@ class ExportableAsset {
 
     template <typename T>
     void dumpAccessorComponentValues(const GLTF::Accessor *accessor,
-                                     int fileIndex, bool isInteger) const;
+                                     std::string filename,
+                                     bool isInteger) const;
 };
@@ -2,15 +2,14 @@
 
 #include "ExportableClip.h"
 #include "ExportableNode.h"
-#include "progress.h"
-#include "timeControl.h"
+#include "Profiler.h"
+#include "Transform.h"
 
 ExportableClip::ExportableClip(const Arguments &args, const AnimClipArg &clipArg, const ExportableScene &scene)
-    : m_frames(args.makeName(clipArg.name + "/anim/frames"), clipArg.frameCount(), clipArg.framesPerSecond) {
+    : clipArg(clipArg), m_stepDetectSampleCount(args.getStepDetectSampleCount()),
+      m_frames(args.makeName(clipArg.name + "/anim/frames"), clipArg.frameCount(), clipArg.framesPerSecond) {
     glAnimation.name = clipArg.name;
 
-    const auto stepDetectSampleCount = args.getStepDetectSampleCount();
-    const auto frameCount = m_frames.count;
     const auto scaleFactor = args.getBakeScaleFactor();
 
     auto &items = scene.table();
@@ -19,38 +18,66 @@ ExportableClip::ExportableClip(const Arguments &args, const AnimClipArg &clipArg
 
     for (auto &pair : items) {
         auto &node = pair.second;
-        auto nodeAnimation = node->createAnimation(args, m_frames, scaleFactor);
+        auto nodeAnimation = node->createAnimation(args, m_frames, m_samples, scaleFactor);
         if (nodeAnimation) {
             m_nodeAnimations.emplace_back(std::move(nodeAnimation));
         }
     }
 
-    const auto superSampleFrameRate = stepDetectSampleCount * clipArg.framesPerSecond;
+    m_samples.allocate();
+
+    const size_t sampleCount = clipArg.frameCount() * m_stepDetectSampleCount;
+    m_sampleTimes.reserve(sampleCount);
+    m_sampleSuperSampleIndices.reserve(sampleCount);
+    m_sampledMatrices.reserve(sampleCount * m_nodeAnimations.size());
+}
+
+MTime ExportableClip::sampleTime(const int relativeFrameIndex, const int superSampleIndex) const {
+    const auto superSampleFrameRate = m_stepDetectSampleCount * clipArg.framesPerSecond;
 
     // To make sure Maya never rounds to just before a frame, we add half the smallest time step. Need to detect step interpolation
     const double mayaTimeEpsilon = 0.5 / 141120000;
 
-    for (size_t relativeFrameIndex = 0; relativeFrameIndex < frameCount; ++relativeFrameIndex) {
-        for (size_t superSampleIndex = 0; superSampleIndex < stepDetectSampleCount; ++superSampleIndex) {
-            const double relativeFrameTime = (relativeFrameIndex * stepDetectSampleCount + superSampleIndex) / superSampleFrameRate + mayaTimeEpsilon;
-            const MTime absoluteFrameTime = clipArg.startTime + MTime(relativeFrameTime, MTime::kSeconds);
-            setCurrentTime(absoluteFrameTime, args.redrawViewport && superSampleIndex == 0);
-            // const auto absoluteFrameTimeDebug = MAnimControl::currentTime().as(MTime::k24FPS);
-
-            NodeTransformCache transformCache;
-            for (auto &nodeAnimation : m_nodeAnimations) {
-                nodeAnimation->sampleAt(absoluteFrameTime, relativeFrameIndex, superSampleIndex, transformCache);
-            }
-        }
+    const double relativeFrameTime = (relativeFrameIndex * m_stepDetectSampleCount + superSampleIndex) / superSampleFrameRate + mayaTimeEpsilon;
+    return clipArg.startTime + MTime(relativeFrameTime, MTime::kSeconds);
+}
 
-        if (relativeFrameIndex % checkProgressFrameInterval == checkProgressFrameInterval - 1) {
-            uiAdvanceProgress("exporting clip '" + clipArg.name + formatted("' %d%%", relativeFrameIndex * 100 / frameCount));
-        }
-    }
+void ExportableClip::sampleAt(const MTime &absoluteTime, const int relativeFrameIndex, const int superSampleIndex,
+                              NodeTransformCache &transformCache) {
+    PROFILE_SCOPE("clip.sample");
+
+    m_sampleTimes.emplace_back(absoluteTime);
+    m_sampleSuperSampleIndices.emplace_back(superSampleIndex);
 
     for (auto &nodeAnimation : m_nodeAnimations) {
+        nodeAnimation->sampleAt(absoluteTime, relativeFrameIndex, superSampleIndex, transformCache, m_sampledMatrices);
+    }
+}
+
+void ExportableClip::finish(ThreadPool &pool) {
+    PROFILE_STAGE("clip.finish");
+
+    const auto nodeCount = m_nodeAnimations.size();
+    assert(m_sampledMatrices.size() == m_sampleTimes.size() * nodeCount);
+
+    std::vector<DecomposedTRS> decomposed(m_sampledMatrices.size());
+    {
+        PROFILE_SCOPE("clip.decompose");
+        decomposeTransforms(pool, span(m_sampledMatrices), gsl::make_span(decomposed));
+    }
+
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        auto &nodeAnimation = m_nodeAnimations[nodeIndex];
+
+        for (size_t sampleIndex = 0; sampleIndex < m_sampleTimes.size(); ++sampleIndex) {
+            nodeAnimation->appendDecomposed(m_sampleTimes[sampleIndex], m_sampleSuperSampleIndices[sampleIndex],
+                                            decomposed[sampleIndex * nodeCount + nodeIndex]);
+        }
+
         nodeAnimation->exportTo(glAnimation);
     }
+
+    m_sampledMatrices = std::vector<AffineMatrix>();
 }
 
 ExportableClip::~ExportableClip() = default;
@@ -9,11 +9,38 @@ class ExportableClip {
     ExportableClip(const Arguments &args, const AnimClipArg &clipArg, const ExportableScene &scene);
     virtual ~ExportableClip();
 
+    const AnimClipArg &clipArg;
+
     GLTF::Animation glAnimation;
 
+    /** The number of samples taken per frame, to detect step functions */
+    int sampleCountPerFrame() const { return m_stepDetectSampleCount; }
+
+    /** The absolute Maya time of a (super) sample of this clip */
+    MTime sampleTime(int relativeFrameIndex, int superSampleIndex) const;
+
+    /** Samples all animated nodes at the current Maya time */
+    void sampleAt(const MTime &absoluteTime, int relativeFrameIndex, int superSampleIndex, NodeTransformCache &transformCache);
+
+    /** Decomposes the sampled matrices on the pool, and creates the glTF
+     * channels, after all frames are sampled */
+    void finish(ThreadPool &pool);
+
   private:
+    const int m_stepDetectSampleCount;
     ExportableFrames m_frames;
+
+    // The samples of all props of the node animations
+    SampleStore m_samples;
+
     std::vector<std::unique_ptr<NodeAnimation>> m_nodeAnimations;
 
+    // The time and super sample index of each sample
+    std::vector<MTime> m_sampleTimes;
+    std::vector<int> m_sampleSuperSampleIndices;
+
+    // Per sample, the local matrix of each node animation
+    std::vector<AffineMatrix> m_sampledMatrices;
+
     DISALLOW_COPY_MOVE_ASSIGN(ExportableClip);
 };
@@ -1,4 +1,4 @@
-#include "externals.h"
+#include "coreExternals.h"
 
 #include "ExportableFrames.h"
 #include "accessors.h"
@@ -6,7 +6,7 @@
 ExportableFrames::ExportableFrames(std::string accessorName,
                                    const int frameCount,
                                    const double framesPerSecond)
-    : count(frameCount), m_accessorName(std::move(accessorName)) {
+    : count(frameCount), framesPerSecond(framesPerSecond), m_accessorName(std::move(accessorName)) {
     m_glTimes.reserve(frameCount);
 
     for (auto relativeFrameIndex = 0; relativeFrameIndex < frameCount; ++relativeFrameIndex) {
@@ -31,3 +31,12 @@ GLTF::Accessor *ExportableFrames::glInput0() const {
     return m_glInput0.get();
 }
 
+GLTF::Accessor *ExportableFrames::glInputs(const std::vector<float> &keyTimes) const {
+    auto &glInputs = m_glKeyInputs[keyTimes];
+
+    if (!glInputs) {
+        glInputs = contiguousChannelAccessor(m_accessorName, keyTimes, 1);
+    }
+
+    return glInputs.get();
+}
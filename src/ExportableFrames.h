@@ -8,19 +8,27 @@ class ExportableFrames {
     ~ExportableFrames() = default;
 
     const int count;
+    const double framesPerSecond;
+
+    /** For each frame, the clip-relative time in seconds */
+    const std::vector<float> &times() const { return m_glTimes; }
 
     GLTF::Accessor *glInputs() const;
 
     GLTF::Accessor *glInput0() const;
 
+    /** The given key times, for channels that don't have a key per frame.
+     * Shared by all channels with the same key times */
+    GLTF::Accessor *glInputs(const std::vector<float> &keyTimes) const;
+
   private:
     const std::string m_accessorName;
 
-    // For each animation frame, the clip-relative time in seconds.
     std::vector<float> m_glTimes;
 
     mutable std::unique_ptr<GLTF::Accessor> m_glInputs;
     mutable std::unique_ptr<GLTF::Accessor> m_glInput0;
+    mutable std::map<std::vector<float>, std::unique_ptr<GLTF::Accessor>> m_glKeyInputs;
 
     DISALLOW_COPY_MOVE_ASSIGN(ExportableFrames);
 };
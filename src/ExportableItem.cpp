@@ -6,6 +6,6 @@
 ExportableItem::~ExportableItem() = default;
 
 std::unique_ptr<NodeAnimation>
-ExportableItem::createAnimation(const Arguments &, const ExportableFrames &, double ) {
+ExportableItem::createAnimation(const Arguments &, const ExportableFrames &, SampleStore &, double ) {
     return nullptr;
 }
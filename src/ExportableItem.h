@@ -3,6 +3,7 @@
 #include "macros.h"
 
 class ExportableFrames;
+class SampleStore;
 class NodeAnimation;
 class Arguments;
 
@@ -11,7 +12,7 @@ class ExportableItem {
     virtual ~ExportableItem() = 0;
 
     virtual std::unique_ptr<NodeAnimation> createAnimation(const Arguments &args, const ExportableFrames &frameTimes,
-                                                           double scaleFactor);
+                                                           SampleStore &samples, double scaleFactor);
 
   protected:
     ExportableItem() = default;
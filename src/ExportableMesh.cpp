@@ -9,32 +9,37 @@
 #include "ExportableScene.h"
 #include "GLTFTargetNames.h"
 #include "MayaException.h"
+#include "Profiler.h"
 #include "Mesh.h"
 #include "MeshSkeleton.h"
+#include "Transform.h"
 #include "accessors.h"
 
 ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, const MDagPath &shapeDagPath)
     : ExportableObject(shapeDagPath.node()) {
+    PROFILE_STAGE("mesh.extract");
+
     MStatus status;
 
     auto &resources = scene.resources();
     auto &args = resources.arguments();
 
-    const auto mayaMesh = std::make_unique<Mesh>(scene, shapeDagPath, node);
+    m_mayaMesh = std::make_unique<Mesh>(scene, shapeDagPath, node);
+    auto &mayaMesh = m_mayaMesh;
 
     if (args.dumpMaya) {
         mayaMesh->dump(*args.dumpMaya, shapeDagPath.fullPathName().asChar());
     }
 
     if (!mayaMesh->isEmpty()) {
-        auto shapeName = args.assignName(glMesh, shapeDagPath, "");
+        m_shapeName = args.assignName(glMesh, shapeDagPath, "");
+        const auto &shapeName = m_shapeName;
 
         auto &mainShape = mayaMesh->shape();
 
-        // Generate primitives
-        MeshRenderables renderables(mayaMesh->allShapes(), args);
+        m_geometry = mayaMesh->geometry();
         const auto &shadingMap = mainShape.indices().shadingPerInstance();
-        const auto &shading = shadingMap.at(renderables.instanceNumber);
+        const auto &shading = shadingMap.at(m_geometry.instanceNumber);
         const auto shaderCount = static_cast<int>(shading.shaderGroups.length());
 
         /* TODO: Implement overrides
@@ -55,60 +60,7 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
         overrideShading); THROW_ON_FAILURE(status);
          */
 
-        const auto &vertexBufferEntries = renderables.table();
-        const size_t vertexBufferCount = vertexBufferEntries.size();
         {
-            size_t vertexBufferIndex = 0;
-            for (auto &&pair : vertexBufferEntries) {
-                const auto &vertexSignature = pair.first;
-                const auto &vertexBuffer = pair.second;
-
-                const int shaderIndex = vertexSignature.shaderIndex;
-                auto &shaderGroup = shaderIndex >= 0 && shaderIndex < shaderCount ? shading.shaderGroups[shaderIndex]
-                                                                                  : MObject::kNullObj;
-
-                ExportableMaterial *material = nullptr;
-
-                // Assign material to primitive
-                if (args.colorizeMaterials) {
-                    const float h = vertexBufferIndex * 1.0f / vertexBufferCount;
-                    const float s = shaderCount == 0 ? 0.5f : 1;
-                    const float v = shaderIndex < 0 ? 0.5f : 1;
-                    material = resources.getDebugMaterial({h, s, v});
-                } else {
-                    material = resources.getMaterial(shaderGroup);
-                    if (!material && resources.arguments().defaultMaterial)
-                        material = resources.getDefaultMaterial();
-                }
-
-                if (material) {
-                    const auto primitiveName = shapeName + "#" + std::to_string(vertexBufferIndex);
-
-                    auto exportablePrimitive =
-                        std::make_unique<ExportablePrimitive>(primitiveName, vertexBuffer, resources, material);
-                    glMesh.primitives.push_back(&exportablePrimitive->glPrimitive);
-
-                    m_primitives.emplace_back(std::move(exportablePrimitive));
-
-                    if (args.debugTangentVectors) {
-                        auto debugPrimitive = std::make_unique<ExportablePrimitive>(
-                            primitiveName, vertexBuffer, resources, Semantic::Kind::TANGENT, ShapeIndex::main(),
-                            args.debugVectorLength, Color({1, 0, 0, 1}));
-                        glMesh.primitives.push_back(&debugPrimitive->glPrimitive);
-                        m_primitives.emplace_back(move(debugPrimitive));
-                    }
-
-                    if (args.debugNormalVectors) {
-                        auto debugPrimitive = std::make_unique<ExportablePrimitive>(
-                            primitiveName, vertexBuffer, resources, Semantic::Kind::NORMAL, ShapeIndex::main(),
-                            args.debugVectorLength, Color({1, 1, 0, 1}));
-                        glMesh.primitives.push_back(&debugPrimitive->glPrimitive);
-                        m_primitives.emplace_back(move(debugPrimitive));
-                    }
-                }
-
-                ++vertexBufferIndex;
-            }
             for (auto &&shape : mayaMesh->allShapes()) {
                 if (shape->shapeIndex.isBlendShapeIndex()) {
                     m_weightPlugs.emplace_back(shape->weightPlug);
@@ -128,6 +80,12 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
             }
         }
 
+        if (args.quantizeMeshes && !args.debugTangentVectors && !args.debugNormalVectors) {
+            const auto &mainPositions = m_geometry.mainVertices->at(Semantic::POSITION).at(0);
+            m_positionQuantization = PositionQuantization::fromPositions(
+                reinterpret_span<Position>(mainPositions.floats()), args.positionQuantizationError);
+        }
+
         // Generate skin
         auto &skeleton = mainShape.skeleton();
         if (!skeleton.isEmpty()) {
@@ -135,12 +93,20 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
 
             auto &joints = skeleton.joints();
 
+            if (args.compactSkins) {
+                m_jointPalette = JointPalette::fromVertices(joints.size(), *m_geometry.mainVertices);
+            }
+
             // std::map<int, std::vector<ExportableNode *>> distanceToRootMap;
 
-            m_inverseBindMatrices.reserve(joints.size());
+            const auto skinJointCount = m_jointPalette.isEmpty() ? joints.size() : m_jointPalette.skinJoints.size();
+
+            m_inverseBindMatrices.reserve(skinJointCount);
 
             // Get joints, and build inverse bind matrices.
-            for (auto &joint : joints) {
+            for (size_t skinJointIndex = 0; skinJointIndex < skinJointCount; ++skinJointIndex) {
+                auto &joint =
+                    joints.at(m_jointPalette.isEmpty() ? skinJointIndex : m_jointPalette.skinJoints[skinJointIndex]);
                 auto *jointNode = joint.node;
                 glSkin.joints.emplace_back(const_cast<GLTF::Node *>(&jointNode->glPrimaryNode()));
 
@@ -150,6 +116,17 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
                 double ibm[4][4];
                 THROW_ON_FAILURE(joint.inverseBindMatrix.get(ibm));
 
+                if (m_positionQuantization.isEnabled()) {
+                    // Dequantize the positions before binding: (offset + scale * p) * IBM
+                    const auto &q = m_positionQuantization;
+                    for (int j = 0; j < 4; ++j) {
+                        ibm[3][j] += q.offset[0] * ibm[0][j] + q.offset[1] * ibm[1][j] + q.offset[2] * ibm[2][j];
+                        ibm[0][j] *= q.scale;
+                        ibm[1][j] *= q.scale;
+                        ibm[2][j] *= q.scale;
+                    }
+                }
+
                 Float4x4 inverseBindMatrix;
 
                 for (int i = 0; i < 4; ++i) {
@@ -183,10 +160,144 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
             // '\'') << " as skeleton root for mesh " << quoted(shapeName, '\'')
             // << endl; glSkin.skeleton = &rootJointNode->glPrimaryNode();
         }
+
+        // Generate primitives, last, since the pending task must not outlive a failed constructor.
+        // Maya materials can only be converted on the main thread.
+        auto getShaderMaterial = [&](const ShaderIndex shaderIndex) {
+            auto &shaderGroup =
+                shaderIndex >= 0 && shaderIndex < shaderCount ? shading.shaderGroups[shaderIndex] : MObject::kNullObj;
+
+            ExportableMaterial *material = resources.getMaterial(shaderGroup);
+            if (!material && resources.arguments().defaultMaterial)
+                material = resources.getDefaultMaterial();
+
+            return material;
+        };
+
+        if (args.colorizeMaterials) {
+            // The debug colors depend on the welded vertex buffers, so build these on the main thread.
+            buildPrimitives(args, resources.meshCache(), [&](const ShaderIndex shaderIndex,
+                                                             const size_t vertexBufferIndex,
+                                                             const size_t vertexBufferCount) {
+                const float h = vertexBufferIndex * 1.0f / vertexBufferCount;
+                const float s = shaderCount == 0 ? 0.5f : 1;
+                const float v = shaderIndex < 0 ? 0.5f : 1;
+                return resources.getDebugMaterial({h, s, v});
+            });
+        } else {
+            std::map<ShaderIndex, ExportableMaterial *> shaderMaterials;
+            for (auto shaderIndex : *m_geometry.primitiveToShaderIndexMap) {
+                if (shaderMaterials.find(shaderIndex) == shaderMaterials.end()) {
+                    shaderMaterials[shaderIndex] = getShaderMaterial(shaderIndex);
+                }
+            }
+
+            const auto *meshCache = resources.meshCache();
+            m_pendingPrimitives = resources.threadPool().submit([this, &args, meshCache, shaderMaterials]() {
+                buildPrimitives(args, meshCache, [&](const ShaderIndex shaderIndex, size_t, size_t) {
+                    return shaderMaterials.at(shaderIndex);
+                });
+            });
+        }
     }
 }
 
-ExportableMesh::~ExportableMesh() = default;
+ExportableMesh::~ExportableMesh() {
+    // The pending task references this mesh.
+    if (m_pendingPrimitives.valid()) {
+        m_pendingPrimitives.wait();
+    }
+}
+
+void ExportableMesh::buildPrimitives(const CoreArguments &args, const MeshCache *meshCache,
+                                     const MaterialResolver &getMaterial) {
+    PROFILE_STAGE("mesh.buildPrimitives");
+
+    std::unique_ptr<MeshRenderables> cachedRenderables;
+    std::string cacheKey;
+
+    if (meshCache) {
+        cacheKey = MeshCache::key(m_geometry, args);
+        cachedRenderables = meshCache->load(cacheKey);
+        m_isCached = cachedRenderables != nullptr;
+    }
+
+    if (!cachedRenderables) {
+        cachedRenderables = std::make_unique<MeshRenderables>(m_geometry, args);
+
+        if (meshCache) {
+            meshCache->store(cacheKey, *cachedRenderables);
+        }
+    }
+
+    const auto &renderables = *cachedRenderables;
+    m_weldStatistics = renderables.weldStatistics();
+    m_vertexCacheOptimization = renderables.vertexCacheOptimization();
+
+    const auto &vertexBufferEntries = renderables.table();
+    const size_t vertexBufferCount = vertexBufferEntries.size();
+
+    size_t vertexBufferIndex = 0;
+    for (auto &&pair : vertexBufferEntries) {
+        const auto &vertexSignature = pair.first;
+        const auto &vertexBufferParts = pair.second;
+
+        // Assign material to primitive
+        ExportableMaterial *material = getMaterial(vertexSignature.shaderIndex, vertexBufferIndex, vertexBufferCount);
+
+        for (size_t partIndex = 0; material && partIndex < vertexBufferParts.size(); ++partIndex) {
+            const auto &vertexBuffer = vertexBufferParts[partIndex];
+
+            auto primitiveName = m_shapeName + "#" + std::to_string(vertexBufferIndex);
+            if (vertexBufferParts.size() > 1) {
+                primitiveName += "/part#" + std::to_string(partIndex);
+            }
+
+            m_primitives.emplace_back(std::make_unique<ExportablePrimitive>(
+                primitiveName, vertexBuffer, args, material->glMaterial(), material->hasTextures(),
+                m_positionQuantization, m_jointPalette.isEmpty() ? nullptr : &m_jointPalette));
+
+            if (args.debugTangentVectors) {
+                m_primitives.emplace_back(std::make_unique<ExportablePrimitive>(
+                    primitiveName, vertexBuffer, args, Semantic::Kind::TANGENT, ShapeIndex::main(),
+                    args.debugVectorLength, Color({1, 0, 0, 1})));
+            }
+
+            if (args.debugNormalVectors) {
+                m_primitives.emplace_back(std::make_unique<ExportablePrimitive>(
+                    primitiveName, vertexBuffer, args, Semantic::Kind::NORMAL, ShapeIndex::main(),
+                    args.debugVectorLength, Color({1, 1, 0, 1})));
+            }
+        }
+
+        ++vertexBufferIndex;
+    }
+}
+
+void ExportableMesh::finish() {
+    if (!m_mayaMesh)
+        return;
+
+    if (m_pendingPrimitives.valid()) {
+        // Rethrows any exception of the worker thread.
+        m_pendingPrimitives.get();
+    }
+
+    if (!m_mayaMesh->isEmpty()) {
+        cout << prefix << m_geometry.name << " " << m_weldStatistics << (m_isCached ? " (from mesh cache)" : "")
+             << endl;
+
+        if (m_vertexCacheOptimization.before.triangleCount > 0) {
+            cout << prefix << m_geometry.name << " vertex cache " << m_vertexCacheOptimization << endl;
+        }
+    }
+
+    for (auto &&primitive : m_primitives) {
+        glMesh.primitives.push_back(&primitive->glPrimitive);
+    }
+
+    m_mayaMesh.reset();
+}
 
 void ExportableMesh::getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const {
     for (auto &&primitive : m_primitives) {
@@ -198,27 +309,48 @@ void ExportableMesh::getAllAccessors(std::vector<GLTF::Accessor *> &accessors) c
     }
 }
 
-std::vector<float> ExportableMesh::currentWeights() const {
-    std::vector<float> weights;
-    weights.reserve(m_weightPlugs.size());
+void ExportableMesh::getCurrentWeights(const gsl::span<float> weights) const {
+    assert(size_t(weights.size()) == m_weightPlugs.size());
 
-    for (auto &plug : m_weightPlugs) {
-        float weight;
-        THROW_ON_FAILURE(plug.getValue(weight));
-        weights.emplace_back(weight);
+    for (size_t i = 0; i < m_weightPlugs.size(); ++i) {
+        THROW_ON_FAILURE(m_weightPlugs[i].getValue(weights[i]));
     }
-
-    return weights;
 }
 
 void ExportableMesh::attachToNode(GLTF::Node &node) {
-    node.mesh = &glMesh;
+    auto &instanceNode = hasDequantizationNode() ? m_glDequantizationNode : node;
+
+    if (hasDequantizationNode()) {
+        const auto &q = m_positionQuantization;
+        makeIdentity(m_glDequantizationTransform);
+        std::copy(q.offset.begin(), q.offset.end(), m_glDequantizationTransform.translation);
+        std::fill_n(m_glDequantizationTransform.scale, 3, q.scale);
+
+        m_glDequantizationNode.name = glMesh.name.empty() ? "" : glMesh.name + "/dequantized";
+        m_glDequantizationNode.transform = &m_glDequantizationTransform;
+        node.children.push_back(&m_glDequantizationNode);
+    }
+
+    instanceNode.mesh = &glMesh;
 
     if (glSkin.inverseBindMatrices) {
-        node.skin = &glSkin;
+        instanceNode.skin = &glSkin;
     }
 }
 
+const GLTF::Node &ExportableMesh::glInstanceNode(const GLTF::Node &node) const {
+    return hasDequantizationNode() ? m_glDequantizationNode : node;
+}
+
+bool ExportableMesh::hasDequantizationNode() const {
+    return m_positionQuantization.isEnabled() && !glSkin.inverseBindMatrices;
+}
+
+bool ExportableMesh::hasQuantizedAttributes() const {
+    return std::any_of(m_primitives.begin(), m_primitives.end(),
+                       [](auto &&primitive) { return primitive->hasQuantizedAttributes; });
+}
+
 void ExportableMesh::updateWeights() {
     for (size_t i = 0; i < m_weightPlugs.size(); ++i) {
         auto &plug = m_weightPlugs.at(i);
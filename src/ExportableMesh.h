@@ -2,12 +2,18 @@
 
 #include "ExportableObject.h"
 #include "BasicTypes.h"
+#include "MeshQuantization.h"
+#include "MeshRenderables.h"
+#include "SkinEncoding.h"
 
 class ExportableResources;
 class ExportablePrimitive;
+class ExportableMaterial;
+class Mesh;
 class Arguments;
 class ExportableScene;
 class ExportableNode;
+class MeshCache;
 
 class ExportableMesh : public ExportableObject {
   public:
@@ -26,21 +32,65 @@ class ExportableMesh : public ExportableObject {
 
     gsl::span<const float> initialWeights() const { return m_initialWeights; }
 
-    std::vector<float> currentWeights() const;
+    /** Reads the weights at the current time, one per blend shape */
+    void getCurrentWeights(gsl::span<float> weights) const;
 
     void attachToNode(GLTF::Node &node);
 
+    /** The node that instantiates the glMesh, when attached to the given
+     * node. This is a child node when the positions are quantized */
+    const GLTF::Node &glInstanceNode(const GLTF::Node &node) const;
+
+    /** Does any primitive use KHR_mesh_quantization? */
+    bool hasQuantizedAttributes() const;
+
     void updateWeights();
 
     void getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const;
 
+    /** Waits until the primitives are built, and adds them to the glMesh.
+     * Must be called on the main thread before the mesh is used. */
+    void finish();
+
   private:
     DISALLOW_COPY_MOVE_ASSIGN(ExportableMesh);
 
+    bool hasDequantizationNode() const;
+
+    typedef std::function<ExportableMaterial *(ShaderIndex shaderIndex, size_t vertexBufferIndex,
+                                               size_t vertexBufferCount)>
+        MaterialResolver;
+
+    /** Welds the vertices, or loads these from the mesh cache when given,
+     * and builds the primitives, without calling Maya */
+    void buildPrimitives(const CoreArguments &args, const MeshCache *meshCache,
+                         const MaterialResolver &getMaterial);
+
+    std::string m_shapeName;
+
+    // The Maya mesh owns the geometry tables, and must be released on the main thread
+    std::unique_ptr<Mesh> m_mayaMesh;
+    MeshGeometry m_geometry;
+    std::future<void> m_pendingPrimitives;
+    WeldStatistics m_weldStatistics;
+    // Were the welded vertex buffers loaded from the mesh cache?
+    bool m_isCached = false;
+    VertexCacheOptimization m_vertexCacheOptimization;
+
     std::vector<float> m_initialWeights;
     std::vector<MPlug> m_weightPlugs;
     std::vector<std::unique_ptr<ExportablePrimitive>> m_primitives;
 
+    PositionQuantization m_positionQuantization;
+
+    // The joints of the skin, when compacting skins
+    JointPalette m_jointPalette;
+
+    // Holds the dequantization transform of quantized positions, unless the
+    // mesh is skinned, then it is part of the inverse bind matrices
+    GLTF::Node m_glDequantizationNode;
+    GLTF::Node::TransformTRS m_glDequantizationTransform;
+
     std::vector<Float4x4> m_inverseBindMatrices;
     std::unique_ptr<GLTF::Accessor> m_inverseBindMatricesAccessor;
     std::unique_ptr<GLTF::MorphTargetNames> m_morphTargetNames =
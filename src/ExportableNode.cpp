@@ -146,9 +146,10 @@ void ExportableNode::load(ExportableScene &scene, NodeTransformCache &transformC
 ExportableNode::~ExportableNode() = default;
 
 std::unique_ptr<NodeAnimation>
-ExportableNode::createAnimation(const Arguments &args, const ExportableFrames &frameTimes, const double scaleFactor) {
+ExportableNode::createAnimation(const Arguments &args, const ExportableFrames &frameTimes, SampleStore &samples,
+                                const double scaleFactor) {
 
-    return std::make_unique<NodeAnimation>(*this, frameTimes, scaleFactor, args);
+    return std::make_unique<NodeAnimation>(*this, frameTimes, samples, scaleFactor, args);
 }
 
 void ExportableNode::updateNodeTransforms(NodeTransformCache &transformCache) {
@@ -44,7 +44,7 @@ class ExportableNode : public ExportableObject {
     NodeTransformState currentTransformState;
 
     std::unique_ptr<NodeAnimation> createAnimation(const Arguments &args, const ExportableFrames &frameTimes,
-                                                   double scaleFactor) override;
+                                                   SampleStore &samples, double scaleFactor) override;
 
     // The primary node to represent the transform
     // See Transform.h for details
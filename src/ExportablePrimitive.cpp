@@ -1,9 +1,10 @@
-#include "externals.h"
+#include "coreExternals.h"
 
-#include "Arguments.h"
+#include "CoreArguments.h"
 #include "ExportablePrimitive.h"
-#include "ExportableResources.h"
 #include "MeshRenderables.h"
+#include "Profiler.h"
+#include "SparseAccessor.h"
 #include "accessors.h"
 
 using namespace GLTF::Constants;
@@ -37,12 +38,15 @@ inline std::string glTFattributeName(const Kind s, const int setIndex) {
 
 ExportablePrimitive::ExportablePrimitive(const std::string &name,
                                          const VertexBuffer &vertexBuffer,
-                                         ExportableResources &resources,
-                                         ExportableMaterial *material) {
-    auto &args = resources.arguments();
+                                         const CoreArguments &args,
+                                         GLTF::Material *glMaterial,
+                                         const bool hasTextures,
+                                         const PositionQuantization &positionQuantization,
+                                         const JointPalette *jointPalette) {
+    PROFILE_SCOPE("mesh.primitive");
 
     glPrimitive.mode = GLTF::Primitive::TRIANGLES;
-    glPrimitive.material = material->glMaterial();
+    glPrimitive.material = glMaterial;
 
     auto &vertexIndices = vertexBuffer.indices;
 
@@ -86,12 +90,19 @@ ExportablePrimitive::ExportablePrimitive(const std::string &name,
 
     // Don't add texture coordinates if no textures are used, if option is
     // enabled
-    if (args.excludeUnusedTexcoord && !material->hasTextures())
+    if (args.excludeUnusedTexcoord && !hasTextures)
         mainShapeSemanticSet.set(Semantic::TEXCOORD, false);
 
     const auto blendShapeSemanticSet =
         args.blendPrimitiveAttributes & mainShapeSemanticSet;
 
+    // The weights of all sets of a vertex are rounded together.
+    QuantizedJointWeights quantizedJointWeights;
+    if (jointPalette) {
+        quantizedJointWeights = QuantizedJointWeights::fromVertexBuffer(
+            vertexBuffer, args.jointWeightQuantizationError);
+    }
+
     for (auto &&group : componentsPerShapeIndex) {
         const auto shapeIndex = group.first;
 
@@ -103,7 +114,20 @@ ExportablePrimitive::ExportablePrimitive(const std::string &name,
                                 ? mainShapeSemanticSet
                                 : blendShapeSemanticSet;
 
+        // Sort the slots, so the accessor order doesn't depend on the order
+        // of the hash table, e.g. when the buffer is restored from a cache.
+        std::vector<const VertexElementsMap::value_type *> slotEntries;
         for (auto &&pair : group.second) {
+            slotEntries.emplace_back(&pair);
+        }
+
+        std::sort(slotEntries.begin(), slotEntries.end(),
+                  [](auto *left, auto *right) {
+                      return left->first < right->first;
+                  });
+
+        for (auto *slotEntry : slotEntries) {
+            auto &pair = *slotEntry;
             auto &slot = pair.first;
             if (semanticSet.test(slot.semantic)) {
                 auto attributeSlot =
@@ -125,8 +149,67 @@ ExportablePrimitive::ExportablePrimitive(const std::string &name,
                     accessorName = ss.str();
                 }
 
-                auto accessor = contiguousElementAccessor(
-                    accessorName, slot.semantic, slot.shapeIndex, pair.second);
+                std::unique_ptr<GLTF::Accessor> accessor;
+
+                if (jointPalette && slot.shapeIndex.isMainShapeIndex()) {
+                    if (slot.semantic == Semantic::JOINTS) {
+                        accessor = jointIndicesAccessor(
+                            accessorName,
+                            reinterpret_span<JointIndex>(pair.second),
+                            *jointPalette);
+                    } else if (slot.semantic == Semantic::WEIGHTS &&
+                               !quantizedJointWeights.isEmpty()) {
+                        accessor = quantizedJointWeights.accessor(
+                            accessorName, slot.setIndex);
+                    }
+                }
+
+                const auto nonZeroVertices =
+                    vertexBuffer.nonZeroDeltaVertices.find(slot);
+
+                if (args.sparseTargetDensity > 0 &&
+                    nonZeroVertices !=
+                        vertexBuffer.nonZeroDeltaVertices.end()) {
+                    // Quantized positions are dequantized by the mesh
+                    // transform, which scales the morph targets too.
+                    const auto valueScale =
+                        slot.semantic == Semantic::POSITION &&
+                                positionQuantization.isEnabled()
+                            ? 1 / positionQuantization.scale
+                            : 1.0f;
+
+                    accessor = sparseElementAccessor(
+                        accessorName, slot.semantic, slot.shapeIndex,
+                        vertexBuffer.vertexCount,
+                        span(nonZeroVertices->second), pair.second,
+                        args.sparseTargetDensity, valueScale);
+                }
+
+                // Blend-shape slots only store their non-zero deltas.
+                VertexElementData denseDeltas;
+                if (!accessor && slot.shapeIndex.isBlendShapeIndex()) {
+                    denseDeltas = vertexBuffer.denseComponents(slot);
+                }
+
+                const auto &components = slot.shapeIndex.isBlendShapeIndex()
+                                             ? denseDeltas
+                                             : pair.second;
+
+                if (!accessor && args.quantizeMeshes &&
+                    Component::type(slot.semantic) == Component::FLOAT) {
+                    accessor = quantizedElementAccessor(
+                        accessorName, slot.semantic, slot.shapeIndex,
+                        reinterpret_span<float>(components), args,
+                        positionQuantization);
+                    hasQuantizedAttributes |= accessor != nullptr;
+                }
+
+                if (!accessor) {
+                    accessor = contiguousElementAccessor(
+                        accessorName, slot.semantic, slot.shapeIndex,
+                        components);
+                }
+
                 glAttributes[attributeSlot] = accessor.get();
                 glAccessors.emplace_back(std::move(accessor));
             }
@@ -136,13 +219,11 @@ ExportablePrimitive::ExportablePrimitive(const std::string &name,
 
 ExportablePrimitive::ExportablePrimitive(const std::string &name,
                                          const VertexBuffer &vertexBuffer,
-                                         ExportableResources &resources,
+                                         const CoreArguments &args,
                                          const Semantic::Kind debugSemantic,
                                          const ShapeIndex &debugShapeIndex,
                                          const double debugLineLength,
                                          const Color debugLineColor) {
-    auto &args = resources.arguments();
-
     glPrimitive.mode = GLTF::Primitive::LINES;
 
     const auto positionSlot =
@@ -1,25 +1,27 @@
 #pragma once
 
-#include "ExportableMaterial.h"
-#include "ExportableMesh.h"
+#include "MeshQuantization.h"
 #include "MeshRenderables.h"
+#include "SkinEncoding.h"
 #include "sceneTypes.h"
 
 typedef std::vector<std::unique_ptr<GLTF::Primitive::Target>>
     BlendShapeToTargetTable;
 
-class ExportableResources;
+struct CoreArguments;
 
 class ExportablePrimitive {
   public:
     ExportablePrimitive(const std::string &name,
                         const VertexBuffer &vertexBuffer,
-                        ExportableResources &resources,
-                        ExportableMaterial *material);
+                        const CoreArguments &args,
+                        GLTF::Material *glMaterial, bool hasTextures,
+                        const PositionQuantization &positionQuantization,
+                        const JointPalette *jointPalette = nullptr);
 
     ExportablePrimitive(const std::string &name,
                         const VertexBuffer &vertexBuffer,
-                        ExportableResources &resources,
+                        const CoreArguments &args,
                         Semantic::Kind debugSemantic,
                         const ShapeIndex &debugShapeIndex,
                         double debugLineLength, Color debugLineColor);
@@ -30,6 +32,9 @@ class ExportablePrimitive {
     std::unique_ptr<GLTF::Accessor> glIndices;
     BlendShapeToTargetTable glTargetTable;
 
+    /** Does any vertex attribute use KHR_mesh_quantization? */
+    bool hasQuantizedAttributes = false;
+
     void getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const;
 
   private:
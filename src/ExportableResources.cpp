@@ -8,7 +8,11 @@
 #include "filesystem.h"
 
 ExportableResources::ExportableResources(const Arguments &args)
-    : m_args(args) {}
+    : m_args(args), m_threadPool(ThreadPool::workerCountFor(args.threadCount)) {
+    if (!args.meshCacheFolder.empty()) {
+        m_meshCache = std::make_unique<MeshCache>(args.meshCacheFolder);
+    }
+}
 
 ExportableResources::~ExportableResources() {}
 
@@ -1,6 +1,8 @@
 #pragma once
 #include "ExportableItem.h"
 #include "ExportableMaterial.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
 #include "filesystem.h"
 
 class Arguments;
@@ -46,6 +48,12 @@ class ExportableResources : public ExportableItem {
 
     void getAllAccessors(std::vector<GLTF::Accessor *> &accessors);
 
+    /** Runs the Maya-free mesh processing stages */
+    ThreadPool &threadPool() { return m_threadPool; }
+
+    /** nullptr unless a mesh cache folder is given */
+    const MeshCache *meshCache() const { return m_meshCache.get(); }
+
   private:
     std::map<MayaNodeName, std::unique_ptr<ExportableMaterial>> m_materialMap;
     std::map<Float3, std::unique_ptr<ExportableMaterial>> m_debugMaterialMap;
@@ -57,4 +65,7 @@ class ExportableResources : public ExportableItem {
 
     ExportableDefaultMaterial m_defaultMaterial;
     const Arguments &m_args;
+
+    ThreadPool m_threadPool;
+    std::unique_ptr<MeshCache> m_meshCache;
 };
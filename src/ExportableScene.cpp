@@ -19,6 +19,26 @@ void ExportableScene::updateCurrentValues() {
     }
 }
 
+void ExportableScene::finishMeshes() {
+    for (auto &&pair : m_table) {
+        auto *mesh = pair.second->mesh();
+        if (mesh) {
+            mesh->finish();
+        }
+    }
+}
+
+bool ExportableScene::hasQuantizedMeshes() const {
+    for (auto &&pair : m_table) {
+        auto *mesh = pair.second->mesh();
+        if (mesh && mesh->hasQuantizedAttributes()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void ExportableScene::mergeRedundantShapeNodes() {
     std::set<NodeTable::key_type> redundantKeys;
 
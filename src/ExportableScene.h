@@ -31,6 +31,12 @@ class ExportableScene {
 
     void mergeRedundantShapeNodes();
 
+    // Waits until the primitives of all meshes are built
+    void finishMeshes();
+
+    // Does any mesh use KHR_mesh_quantization?
+    bool hasQuantizedMeshes() const;
+
     // Gets or creates the node
     // Returns null if the DAG path has no node
     ExportableNode *getNode(const MDagPath &dagPath);
@@ -1,10 +1,17 @@
 #include "externals.h"
 
 #include "Arguments.h"
+#include "AsyncFileWriter.h"
 #include "ExportableAsset.h"
 #include "Exporter.h"
 #include "MayaException.h"
 #include "OutputWindow.h"
+#include "Profiler.h"
+
+namespace {
+// Writes the files of all exports in order, on a background thread
+std::unique_ptr<AsyncFileWriter> outputWriter;
+} // namespace
 
 Exporter::Exporter() = default;
 
@@ -80,10 +87,50 @@ bool Exporter::isUndoable() const { return false; }
 bool Exporter::hasSyntax() const { return true; }
 
 void Exporter::exportScene(const Arguments &args) {
-    ExportableAsset exportableAsset(args);
-    exportableAsset.save();
+    PROFILE_STAGE("export");
+
+    const auto maxPendingByteLength = size_t(std::max(1, args.asyncOutputMemory)) << 20;
+
+    if (!outputWriter) {
+        outputWriter = std::make_unique<AsyncFileWriter>(maxPendingByteLength);
+    }
+
+    auto &writer = *outputWriter;
+    writer.setMaxPendingByteLength(maxPendingByteLength);
+
+    // An earlier asynchronous export might still write to the output folder.
+    writer.wait();
+
+    AsyncFileWriter::BatchReporter reporter;
+    if (args.asyncOutput) {
+        const std::string sceneName = args.sceneName.asChar();
+        reporter = [sceneName](const std::string &error) {
+            // Runs on the writer thread, so let Maya print on its main thread.
+            const auto command = error.empty()
+                                     ? "print " + escaped("maya2glTF: Finished writing '" + sceneName + "'\n")
+                                     : "error " + escaped("maya2glTF: " + error);
+            MGlobal::executeCommandOnIdle(command.c_str());
+        };
+    }
+
+    std::future<void> written;
+
+    try {
+        ExportableAsset exportableAsset(args);
+        written = exportableAsset.save(writer, reporter);
+    } catch (...) {
+        // Don't leave the files of a failed export behind
+        writer.cancelBatch();
+        throw;
+    }
+
+    if (!args.asyncOutput) {
+        written.get();
+    }
 }
 
+void Exporter::finishOutput() { outputWriter.reset(); }
+
 MStatus Exporter::run(const MArgList &args) const {
     try {
         std::cout << prefix << "Parsing arguments..." << endl;
@@ -93,10 +140,25 @@ MStatus Exporter::run(const MArgList &args) const {
             OutputWindow().clear();
         }
 
+        if (!arguments.profileFile.empty()) {
+            Profiler::start();
+        }
+
         std::cout << prefix << "Starting export..." << endl;
         exportScene(arguments);
 
-        std::cout << prefix << "Finished export :-)" << endl;
+        if (Profiler::isEnabled()) {
+            Profiler::stop();
+            std::cout << prefix << "Writing profile to '" << arguments.profileFile << "'" << endl;
+            Profiler::writeTrace(arguments.profileFile);
+            Profiler::printSummary(std::cout);
+        }
+
+        if (arguments.asyncOutput) {
+            std::cout << prefix << "Finished export, writing the files in the background :-)" << endl;
+        } else {
+            std::cout << prefix << "Finished export :-)" << endl;
+        }
         std::cout << "---------------------------------------------------------"
                      "-----------------------"
                   << endl;
@@ -110,5 +172,7 @@ MStatus Exporter::run(const MArgList &args) const {
         MayaException::printError("Unexpected fatal error!");
     }
 
+    Profiler::stop();
+
     return MStatus::kFailure;
 }
@@ -18,6 +18,10 @@ class Exporter : public MPxCommand {
 
     static void exportScene(const Arguments &args);
 
+    /** Waits for the files of asynchronous exports, and stops the thread
+     * that writes these. Called before the plugin unloads or Maya quits */
+    static void finishOutput();
+
   private:
     DISALLOW_COPY_MOVE_ASSIGN(Exporter);
     MStatus run(const MArgList &args) const;
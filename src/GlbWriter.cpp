@@ -0,0 +1,56 @@
+#include "coreExternals.h"
+
+#include "GlbWriter.h"
+
+void writeGLB(std::ostream &out, const std::string &json, const byte *data,
+              const size_t dataLength) {
+    writeGLB(out, json, dataLength, [data, dataLength](std::ostream &stream) {
+        stream.write(reinterpret_cast<const char *>(data), dataLength);
+    });
+}
+
+void writeGLB(std::ostream &out, const std::string &json,
+              const size_t dataLength,
+              const std::function<void(std::ostream &)> &writeData) {
+    const uint32_t jsonLength = static_cast<uint32_t>(json.length());
+    const uint32_t bufferLength = static_cast<uint32_t>(dataLength);
+    const uint32_t jsonPadding = (4 - (jsonLength & 3)) & 3;
+    const uint32_t binPadding = (4 - (bufferLength & 3)) & 3;
+
+    const uint32_t headerLength = 12;
+    const uint32_t chunkHeaderLength = 8;
+
+    const uint32_t dataChunkSize =
+        bufferLength ? (chunkHeaderLength + bufferLength + binPadding) : 0;
+
+    uint32_t writeHeader[2];
+
+    out.write("glTF", 4); // magic header
+
+    writeHeader[0] = 2; // version
+    writeHeader[1] = headerLength +
+                     (chunkHeaderLength + jsonLength + jsonPadding) +
+                     dataChunkSize; // length
+    out.write(reinterpret_cast<char *>(writeHeader),
+              sizeof(writeHeader)); // GLB header
+
+    writeHeader[0] = jsonLength + jsonPadding; // chunkLength
+    writeHeader[1] = 0x4E4F534A;               // chunkType JSON
+    out.write(reinterpret_cast<char *>(writeHeader), sizeof(writeHeader));
+
+    out.write(json.c_str(), jsonLength);
+    for (uint32_t i = 0; i < jsonPadding; i++) {
+        out.write(" ", 1);
+    }
+
+    if (bufferLength) {
+        writeHeader[0] = bufferLength + binPadding; // chunkLength
+        writeHeader[1] = 0x004E4942;                // chunkType BIN
+        out.write(reinterpret_cast<char *>(writeHeader), sizeof(writeHeader));
+
+        writeData(out);
+        for (uint32_t i = 0; i < binPadding; i++) {
+            out.write("\0", 1);
+        }
+    }
+}
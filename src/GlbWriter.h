@@ -0,0 +1,19 @@
+#pragma once
+
+#include "BasicTypes.h"
+
+/**
+ * Writes a binary glTF container: the 12-byte header, the JSON chunk padded
+ * with spaces, and when dataLength is non-zero, the BIN chunk padded with
+ * zeros. See https://github.com/KhronosGroup/glTF/tree/master/specification/2.0#glb-file-format-specification
+ */
+void writeGLB(std::ostream &out, const std::string &json, const byte *data,
+              size_t dataLength);
+
+/**
+ * Same as above, but the dataLength bytes of the BIN chunk are written by
+ * writeData, so the binary data doesn't have to be in a single block of
+ * memory.
+ */
+void writeGLB(std::ostream &out, const std::string &json, size_t dataLength,
+              const std::function<void(std::ostream &)> &writeData);
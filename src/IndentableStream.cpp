@@ -1,4 +1,4 @@
-#include "externals.h"
+#include "coreExternals.h"
 
 #include "IndentableStream.h"
 
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "externals.h"
+#include "coreExternals.h"
 
 /** Prints the common prefix ("maya2glTF@<time>: ") */
 ostream &prefix(ostream &stream);
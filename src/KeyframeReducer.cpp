@@ -0,0 +1,180 @@
+#include "coreExternals.h"
+
+#include "KeyframeReducer.h"
+
+namespace {
+/**
+ * Ramer-Douglas-Peucker on the frame indices: a segment between two keys
+ * is split at its worst sample until no sample exceeds the tolerance.
+ * errorAt(index, start, end, t) returns the error of the sample at index
+ * when interpolating between the keys at start and end with factor t.
+ */
+template <typename ErrorAt>
+std::vector<int> reduceKeys(const int frameCount, const double tolerance, const gsl::span<const float> times,
+                            const ErrorAt &errorAt) {
+    assert(times.empty() || times.size() == frameCount);
+
+    const auto interpolationFactor = [times](const int index, const int start, const int end) {
+        return times.empty() ? double(index - start) / (end - start)
+                             : (double(times[index]) - times[start]) / (double(times[end]) - times[start]);
+    };
+
+    if (frameCount <= 2) {
+        std::vector<int> keys(frameCount);
+        std::iota(keys.begin(), keys.end(), 0);
+        return keys;
+    }
+
+    std::vector<bool> isKey(frameCount);
+    isKey.front() = true;
+    isKey.back() = true;
+
+    std::vector<std::pair<int, int>> segments;
+    segments.emplace_back(0, frameCount - 1);
+
+    while (!segments.empty()) {
+        const auto segment = segments.back();
+        segments.pop_back();
+
+        const auto start = segment.first;
+        const auto end = segment.second;
+
+        double maxError = tolerance;
+        int splitIndex = -1;
+
+        for (auto index = start + 1; index < end; ++index) {
+            const auto error = errorAt(index, start, end, interpolationFactor(index, start, end));
+            if (error > maxError) {
+                maxError = error;
+                splitIndex = index;
+            }
+        }
+
+        if (splitIndex >= 0) {
+            isKey[splitIndex] = true;
+            segments.emplace_back(start, splitIndex);
+            segments.emplace_back(splitIndex, end);
+        }
+    }
+
+    std::vector<int> keys;
+    for (auto index = 0; index < frameCount; ++index) {
+        if (isKey[index]) {
+            keys.push_back(index);
+        }
+    }
+
+    return keys;
+}
+} // namespace
+
+std::vector<int> reduceLinearKeys(const gsl::span<const float> values, const size_t dimension, const double tolerance,
+                                  const gsl::span<const float> times) {
+    const auto frameCount = static_cast<int>(values.size() / dimension);
+
+    return reduceKeys(frameCount, tolerance, times, [&](const int index, const int start, const int end, const double t) {
+        const float *v0 = &values[start * dimension];
+        const float *v1 = &values[end * dimension];
+        const float *v = &values[index * dimension];
+
+        double error = 0;
+        for (size_t axis = 0; axis < dimension; ++axis) {
+            const auto interpolated = v0[axis] + (v1[axis] - v0[axis]) * t;
+            error = std::max(error, std::abs(interpolated - v[axis]));
+        }
+        return error;
+    });
+}
+
+std::vector<int> reduceRotationKeys(const gsl::span<const float> quaternions, const double angularTolerance,
+                                    const gsl::span<const float> times) {
+    const auto frameCount = static_cast<int>(quaternions.size() / 4);
+
+    // The angle between two unit vectors, more accurate than acos for small angles
+    const auto angleBetween = [](const double *a, const double *b) {
+        double difference = 0;
+        double sum = 0;
+        for (size_t axis = 0; axis < 4; ++axis) {
+            difference += (a[axis] - b[axis]) * (a[axis] - b[axis]);
+            sum += (a[axis] + b[axis]) * (a[axis] + b[axis]);
+        }
+        return 2 * std::atan2(std::sqrt(difference), std::sqrt(sum));
+    };
+
+    const auto quaternionAt = [&quaternions](const int index, double (&q)[4]) {
+        const float *p = &quaternions[index * 4];
+        const auto length = std::sqrt(double(p[0]) * p[0] + double(p[1]) * p[1] + double(p[2]) * p[2] + double(p[3]) * p[3]);
+        for (size_t axis = 0; axis < 4; ++axis) {
+            q[axis] = length > 0 ? p[axis] / length : 0;
+        }
+    };
+
+    return reduceKeys(frameCount, angularTolerance, times, [&](const int index, const int start, const int end, const double t) {
+        double q0[4], q1[4], q[4];
+        quaternionAt(start, q0);
+        quaternionAt(end, q1);
+        quaternionAt(index, q);
+
+        // Spherical interpolation, as done by glTF viewers for LINEAR rotations.
+        const auto theta = angleBetween(q0, q1);
+        const auto sinTheta = std::sin(theta);
+
+        double s0 = 1 - t;
+        double s1 = t;
+        if (sinTheta > 1e-9) {
+            s0 = std::sin((1 - t) * theta) / sinTheta;
+            s1 = std::sin(t * theta) / sinTheta;
+        }
+
+        double interpolated[4];
+        double length = 0;
+        for (size_t axis = 0; axis < 4; ++axis) {
+            interpolated[axis] = s0 * q0[axis] + s1 * q1[axis];
+            length += interpolated[axis] * interpolated[axis];
+        }
+
+        length = std::sqrt(length);
+        if (length == 0)
+            return std::numeric_limits<double>::infinity();
+
+        double sign = 0;
+        for (size_t axis = 0; axis < 4; ++axis) {
+            interpolated[axis] /= length;
+            sign += interpolated[axis] * q[axis];
+        }
+
+        // q and -q are the same rotation
+        if (sign < 0) {
+            for (auto &component : q) {
+                component = -component;
+            }
+        }
+
+        // The rotation angle is twice the angle between the quaternions
+        return 2 * angleBetween(interpolated, q);
+    });
+}
+
+std::vector<int> reduceStepKeys(const gsl::span<const float> values, const size_t dimension, const double tolerance) {
+    const auto frameCount = static_cast<int>(values.size() / dimension);
+
+    std::vector<int> keys;
+
+    for (auto index = 0; index < frameCount; ++index) {
+        bool isKey = keys.empty() || index == frameCount - 1;
+
+        if (!isKey) {
+            const float *held = &values[keys.back() * dimension];
+            const float *v = &values[index * dimension];
+            for (size_t axis = 0; axis < dimension && !isKey; ++axis) {
+                isKey = std::abs(held[axis] - v[axis]) > tolerance;
+            }
+        }
+
+        if (isKey) {
+            keys.push_back(index);
+        }
+    }
+
+    return keys;
+}
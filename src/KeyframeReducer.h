@@ -0,0 +1,25 @@
+#pragma once
+
+#include "BasicTypes.h"
+
+/**
+ * Error-bounded keyframe reduction of sampled animation channels.
+ * Each function returns the indices of the keys to keep, always including
+ * the first and last key, such that interpolating the kept keys reproduces
+ * every dropped key within the tolerance. The times of the keys are only
+ * needed when they are not uniformly spaced.
+ */
+
+/** For LINEAR channels, the tolerance bounds the error of each component */
+std::vector<int> reduceLinearKeys(gsl::span<const float> values, size_t dimension, double tolerance,
+                                  gsl::span<const float> times = {});
+
+/** For LINEAR rotation channels with hemisphere-aligned quaternions, the
+ * tolerance bounds the angle in radians between a sample and the
+ * spherical interpolation of the kept keys */
+std::vector<int> reduceRotationKeys(gsl::span<const float> quaternions, double angularTolerance,
+                                    gsl::span<const float> times = {});
+
+/** For STEP channels, only the keys that change the value by more than the
+ * tolerance are kept */
+std::vector<int> reduceStepKeys(gsl::span<const float> values, size_t dimension, double tolerance);
@@ -10,3 +10,18 @@ MTransformationMatrix getTransformation(const MDagPath &path);
 // underscore.
 MString simpleName(const MString &name);
 } // namespace utils
+
+static gsl::span<const MFloatPoint> span(const MFloatPointArray &marray) {
+    return marray.length() > 0 ? gsl::make_span(&marray[0], marray.length())
+                               : gsl::span<const MFloatPoint>();
+}
+
+static gsl::span<const MFloatVector> span(const MFloatVectorArray &marray) {
+    return marray.length() > 0 ? gsl::make_span(&marray[0], marray.length())
+                               : gsl::span<const MFloatVector>();
+}
+
+static gsl::span<const MColor> span(const MColorArray &marray) {
+    return marray.length() > 0 ? gsl::make_span(&marray[0], marray.length())
+                               : gsl::span<const MColor>();
+}
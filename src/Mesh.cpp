@@ -7,6 +7,7 @@
 #include "MayaUtils.h"
 #include "Mesh.h"
 #include "MeshBlendShapeWeights.h"
+#include "MikkTSpaceContext.h"
 
 Mesh::Mesh(ExportableScene &scene, MDagPath dagPath,
            const ExportableNode &node) {
@@ -28,6 +29,7 @@ Mesh::Mesh(ExportableScene &scene, MDagPath dagPath,
         m_mainShape = std::make_unique<MainShape>(scene, fnMesh, node,
                                                   ShapeIndex::main());
         m_allShapes.emplace_back(m_mainShape.get());
+        generateTangents(scene.resources().threadPool(), args, m_allShapes);
     } else {
         // Shape with morph targets.
         MFnBlendShapeDeformer fnBlendShapeDeformer(blendShapeDeformer, &status);
@@ -64,6 +66,33 @@ Mesh::Mesh(ExportableScene &scene, MDagPath dagPath,
                                                   ShapeIndex::main());
         m_allShapes.emplace_back(m_mainShape.get());
 
+        auto &threadPool = scene.resources().threadPool();
+        generateTangents(threadPool, args, m_allShapes);
+
+        // Only a batch of targets keeps its dense vertices, until their
+        // tangents are computed and they are reduced to sparse deltas,
+        // so memory scales with the moved vertices, not with the targets.
+        const auto batchSize = std::max<size_t>(1, threadPool.workerCount());
+        MeshShapes batch;
+
+        const auto releaseBatch = [&]() {
+            generateTangents(threadPool, args, batch);
+
+            std::vector<std::future<void>> pending;
+            for (auto *shape : batch) {
+                pending.emplace_back(threadPool.submit([this, shape, &args]() {
+                    shape->releaseVertices(m_mainShape->vertices(),
+                                           args.blendShapeTolerance);
+                }));
+            }
+
+            for (auto &future : pending) {
+                future.get();
+            }
+
+            batch.clear();
+        };
+
         for (auto &&pair : weightEntries) {
             auto &entry = pair.second;
             weightPlugs.clearWeightsExceptFor(&entry);
@@ -74,9 +103,36 @@ Mesh::Mesh(ExportableScene &scene, MDagPath dagPath,
                 ShapeIndex::target(entry.shapeIndex), weightPlug,
                 initialWeight);
             m_allShapes.emplace_back(blendShape.get());
+            batch.emplace_back(blendShape.get());
             m_blendShapes.emplace_back(std::move(blendShape));
+
+            if (batch.size() >= batchSize) {
+                releaseBatch();
+            }
+        }
+
+        releaseBatch();
+    }
+}
+
+void Mesh::generateTangents(ThreadPool &threadPool, const Arguments &args,
+                            const MeshShapes &shapes) const {
+    // The MikkTSpace tangents of each shape and set are independent
+    std::vector<MikkTSpaceContext *> contexts;
+    for (auto &&shape : shapes) {
+        for (auto &&context : shape->vertices().mikkTSpaceContexts()) {
+            contexts.emplace_back(context.get());
         }
     }
+
+    if (contexts.empty())
+        return;
+
+    computeTangents(threadPool, contexts, args.mikkelsenTangentAngularThreshold);
+
+    for (auto &&shape : shapes) {
+        shape->vertices().reportTangentErrors(m_mainShape->indices());
+    }
 }
 
 Mesh::~Mesh() = default;
@@ -168,6 +224,29 @@ Mesh::tryExtractBlendShapeDeformer(const MFnMesh &fnMesh,
     return deformer;
 }
 
+MeshGeometry Mesh::geometry() const {
+    const auto &mainIndices = m_mainShape->indices();
+    const auto instanceNumber = m_mainShape->instanceNumber();
+
+    MeshGeometry geometry;
+    geometry.name = m_mainShape->dagPath().partialPathName().asChar();
+    geometry.instanceNumber = instanceNumber;
+    geometry.perPrimitiveVertexCount = mainIndices.perPrimitiveVertexCount();
+    geometry.primitiveCount = mainIndices.primitiveCount();
+    geometry.indices = &mainIndices.table();
+    geometry.primitiveToShaderIndexMap =
+        &mainIndices.shadingPerInstance().at(instanceNumber).primitiveToShaderIndexMap;
+
+    geometry.mainVertices = &m_mainShape->vertices().table();
+
+    geometry.targetDeltas.reserve(m_blendShapes.size());
+    for (auto &shape : m_blendShapes) {
+        geometry.targetDeltas.emplace_back(&shape->deltas());
+    }
+
+    return geometry;
+}
+
 void Mesh::dump(class IndentableStream &out, const std::string &name) const {
     out << quoted(name) << ": {" << endl << indent;
 
@@ -4,6 +4,7 @@
 
 class ExportableNode;
 class Arguments;
+class ThreadPool;
 
 typedef std::vector<MeshShape *> MeshShapes;
 
@@ -19,6 +20,9 @@ class Mesh {
     const MainShape &shape() const { return *m_mainShape; }
     const MeshShapes &allShapes() const { return m_allShapes; }
 
+    /** The Maya-free view on the shapes, used to build the renderables */
+    MeshGeometry geometry() const;
+
   private:
     DISALLOW_COPY_MOVE_ASSIGN(Mesh);
 
@@ -33,6 +37,10 @@ class Mesh {
 
     Cleanup m_cleanup;
 
+    /** Computes the deferred MikkTSpace tangents of the shapes on the pool */
+    void generateTangents(ThreadPool &threadPool, const Arguments &args,
+                          const MeshShapes &shapes) const;
+
     MObject getOrCreateOutputShape(MPlug &outputGeometryPlug,
                                    MObject &createdMesh) const;
 
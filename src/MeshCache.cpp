@@ -0,0 +1,343 @@
+#include "coreExternals.h"
+
+#include "BufferHash.h"
+#include "CoreArguments.h"
+#include "IndentableStream.h"
+#include "MeshCache.h"
+#include "Profiler.h"
+
+namespace {
+// Bump when the entry layout, or the welding of the vertex buffers, changes
+const uint32_t formatVersion = 1;
+const char formatMagic[8] = {'M', '2', 'G', 'M', 'E', 'S', 'H', '\0'};
+
+/** Collects the small values and the hashes of the spans, and hashes
+ * these at the end. The spans are hashed in place, not copied. */
+class ContentHasher {
+  public:
+    explicit ContentHasher(const BufferHash::Function function) : m_function(function) {}
+
+    template <typename T> void add(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Hash the bytes of plain values only");
+        const auto *bytes = reinterpret_cast<const byte *>(&value);
+        m_bytes.insert(m_bytes.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T> void addSpan(const gsl::span<const T> values) {
+        add(uint64_t(values.size()));
+        const auto bytes = reinterpret_span<byte>(values);
+        const auto hex = BufferHash::hex(bytes.data(), bytes.size(), m_function);
+        m_bytes.insert(m_bytes.end(), hex.begin(), hex.end());
+    }
+
+    std::string hex() const { return BufferHash::hex(m_bytes.data(), m_bytes.size(), m_function); }
+
+  private:
+    const BufferHash::Function m_function;
+    std::vector<byte> m_bytes;
+};
+
+class EntryWriter {
+  public:
+    explicit EntryWriter(std::ostream &out) : m_out(out) {}
+
+    template <typename T> void write(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Write plain values only");
+        m_out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T> void writeVector(const std::vector<T> &values) {
+        write(uint64_t(values.size()));
+        m_out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+    }
+
+    void writeSlot(const VertexSlot &slot) {
+        write(int32_t(slot.shapeIndex.arrayIndex()));
+        write(int32_t(slot.semantic));
+        write(int32_t(slot.setIndex));
+    }
+
+  private:
+    std::ostream &m_out;
+};
+
+/** Reads what the EntryWriter wrote, failing on truncated or corrupt entries */
+class EntryReader {
+  public:
+    EntryReader(std::istream &in, const uint64_t byteLength) : m_in(in), m_remaining(byteLength) {}
+
+    template <typename T> T read() {
+        static_assert(std::is_trivially_copyable<T>::value, "Read plain values only");
+        T value;
+        readBytes(&value, sizeof(T));
+        return value;
+    }
+
+    template <typename T> std::vector<T> readVector() {
+        const auto count = read<uint64_t>();
+        if (count > m_remaining / sizeof(T))
+            throw std::runtime_error("Invalid mesh cache entry");
+        std::vector<T> values(count);
+        readBytes(values.data(), count * sizeof(T));
+        return values;
+    }
+
+    /** Reads vertex indices, which must be below the vertex count */
+    std::vector<Index> readIndices(const uint64_t vertexCount) {
+        auto indices = readVector<Index>();
+        for (auto index : indices) {
+            if (index < 0 || uint64_t(index) >= vertexCount)
+                throw std::runtime_error("Invalid vertex index in mesh cache entry");
+        }
+        return indices;
+    }
+
+    VertexSlot readSlot() {
+        const auto shape = read<int32_t>();
+        const auto semantic = read<int32_t>();
+        const auto setIndex = read<int32_t>();
+        if (shape < 0 || semantic < 0 || semantic >= Semantic::COUNT || setIndex < 0)
+            throw std::runtime_error("Invalid mesh cache entry");
+        return VertexSlot(ShapeIndex::shape(shape), Semantic::from(semantic), setIndex);
+    }
+
+  private:
+    std::istream &m_in;
+    uint64_t m_remaining;
+
+    void readBytes(void *data, const uint64_t length) {
+        if (length > m_remaining || !m_in.read(static_cast<char *>(data), length))
+            throw std::runtime_error("Truncated mesh cache entry");
+        m_remaining -= length;
+    }
+};
+
+void writeStatistics(EntryWriter &writer, const VertexCacheStatistics &statistics) {
+    writer.write(uint64_t(statistics.triangleCount));
+    writer.write(uint64_t(statistics.vertexCount));
+    writer.write(uint64_t(statistics.cacheMissCount));
+}
+
+VertexCacheStatistics readStatistics(EntryReader &reader) {
+    VertexCacheStatistics statistics;
+    statistics.triangleCount = reader.read<uint64_t>();
+    statistics.vertexCount = reader.read<uint64_t>();
+    statistics.cacheMissCount = reader.read<uint64_t>();
+    return statistics;
+}
+
+// The entry repeats its key, to detect entries that were renamed or mixed up
+typedef std::array<char, 64> KeyChars;
+
+KeyChars keyChars(const std::string &key) {
+    KeyChars chars{};
+    std::copy_n(key.begin(), std::min(key.size(), chars.size()), chars.begin());
+    return chars;
+}
+
+/** The slots of a map, sorted, so equal buffers give equal entries */
+template <typename Map> std::vector<const typename Map::value_type *> sortedSlots(const Map &map) {
+    std::vector<const typename Map::value_type *> entries;
+    entries.reserve(map.size());
+    for (auto &&pair : map) {
+        entries.emplace_back(&pair);
+    }
+    std::sort(entries.begin(), entries.end(), [](auto *left, auto *right) { return left->first < right->first; });
+    return entries;
+}
+} // namespace
+
+MeshCache::MeshCache(std::string folder) : folder(std::move(folder)) {}
+
+MeshCache::~MeshCache() = default;
+
+std::string MeshCache::key(const MeshGeometry &geometry, const CoreArguments &args) {
+    PROFILE_SCOPE("mesh.cacheKey");
+
+    ContentHasher hasher(args.sha256MeshCacheKeys ? BufferHash::SHA256 : BufferHash::FAST128);
+
+    hasher.add(formatVersion);
+
+    // The arguments that affect welding and optimizing the vertex buffers.
+    hasher.add(uint64_t(args.meshPrimitiveAttributes.to_ullong()));
+    hasher.add(args.weldByIndices);
+    hasher.add(args.force32bitIndices);
+    hasher.add(args.splitLargePrimitives);
+    hasher.add(args.optimizeVertexCache);
+    hasher.add(args.overdrawThreshold);
+
+    hasher.add(uint64_t(geometry.instanceNumber));
+    hasher.add(int32_t(geometry.perPrimitiveVertexCount));
+    hasher.add(int32_t(geometry.primitiveCount));
+    hasher.addSpan(span(*geometry.primitiveToShaderIndexMap));
+
+    for (auto semanticIndex = 0; semanticIndex < Semantic::COUNT; ++semanticIndex) {
+        const auto &indicesPerSet = geometry.indices->at(semanticIndex);
+        hasher.add(uint64_t(indicesPerSet.size()));
+        for (auto &indices : indicesPerSet) {
+            hasher.addSpan(span(indices));
+        }
+
+        const auto &elementsPerSet = geometry.mainVertices->at(semanticIndex);
+        hasher.add(uint64_t(elementsPerSet.size()));
+        for (auto &elements : elementsPerSet) {
+            hasher.add(int32_t(elements.type));
+            hasher.addSpan(elements.bytes());
+        }
+    }
+
+    hasher.add(uint64_t(geometry.targetDeltas.size()));
+    for (auto *targetDeltas : geometry.targetDeltas) {
+        for (auto &elementsPerSet : *targetDeltas) {
+            hasher.add(uint64_t(elementsPerSet.size()));
+            for (auto &elements : elementsPerSet) {
+                hasher.addSpan(span(elements.elementIndices));
+                hasher.addSpan(span(elements.deltas));
+            }
+        }
+    }
+
+    return hasher.hex();
+}
+
+std::string MeshCache::entryPath(const std::string &key) const {
+    const auto separator = folder.empty() || folder.back() == '/' || folder.back() == '\\' ? "" : "/";
+    return folder + separator + key + ".m2gmesh";
+}
+
+std::unique_ptr<MeshRenderables> MeshCache::load(const std::string &key) const {
+    PROFILE_SCOPE("mesh.cacheLoad");
+
+    std::ifstream in(entryPath(key), std::ios::binary | std::ios::ate);
+    if (!in)
+        return nullptr;
+
+    const auto byteLength = uint64_t(in.tellg());
+    in.seekg(0);
+
+    try {
+        EntryReader reader(in, byteLength);
+
+        const auto magic = reader.read<std::array<char, sizeof(formatMagic)>>();
+        if (!std::equal(magic.begin(), magic.end(), formatMagic) || reader.read<uint32_t>() != formatVersion ||
+            reader.read<KeyChars>() != keyChars(key))
+            return nullptr;
+
+        const auto instanceNumber = InstanceNumber(reader.read<uint64_t>());
+
+        WeldStatistics weldStatistics;
+        weldStatistics.weldCount = reader.read<uint64_t>();
+        weldStatistics.minVertexCount = reader.read<uint64_t>();
+        weldStatistics.maxVertexCount = reader.read<uint64_t>();
+
+        VertexCacheOptimization vertexCacheOptimization;
+        vertexCacheOptimization.before = readStatistics(reader);
+        vertexCacheOptimization.after = readStatistics(reader);
+
+        VertexBufferEntries table;
+        const auto entryCount = reader.read<uint64_t>();
+
+        for (uint64_t entryIndex = 0; entryIndex < entryCount; ++entryIndex) {
+            const auto shaderIndex = reader.read<int32_t>();
+            const auto slotUsage = reader.read<uint64_t>();
+
+            auto &parts = table.emplace_back(VertexSignature(shaderIndex, slotUsage), VertexBufferParts()).second;
+            const auto partCount = reader.read<uint64_t>();
+
+            for (uint64_t partIndex = 0; partIndex < partCount; ++partIndex) {
+                auto &part = parts.emplace_back();
+                part.vertexCount = reader.read<uint64_t>();
+                part.indices = reader.readIndices(part.vertexCount);
+
+                const auto slotCount = reader.read<uint64_t>();
+                for (uint64_t slotIndex = 0; slotIndex < slotCount; ++slotIndex) {
+                    const auto slot = reader.readSlot();
+                    part.componentsMap[slot] = reader.readVector<byte>();
+                }
+
+                const auto sparseSlotCount = reader.read<uint64_t>();
+                for (uint64_t slotIndex = 0; slotIndex < sparseSlotCount; ++slotIndex) {
+                    const auto slot = reader.readSlot();
+                    part.nonZeroDeltaVertices[slot] = reader.readIndices(part.vertexCount);
+                }
+            }
+        }
+
+        return std::make_unique<MeshRenderables>(instanceNumber, std::move(table), weldStatistics,
+                                                 vertexCacheOptimization);
+    } catch (const std::exception &ex) {
+        cerr << prefix << "WARNING: Ignoring mesh cache entry " << key << ": " << ex.what() << endl;
+        return nullptr;
+    }
+}
+
+void MeshCache::store(const std::string &key, const MeshRenderables &renderables) const {
+    PROFILE_SCOPE("mesh.cacheStore");
+
+    // Write a temporary file first, so a concurrent export never reads a partial entry.
+    // Thread ids are only unique within a process, so add a random suffix for exports
+    // running in other processes.
+    const auto path = entryPath(key);
+    std::random_device randomDevice;
+    std::stringstream tempSuffix;
+    tempSuffix << ".tmp" << std::this_thread::get_id() << '-' << std::hex << randomDevice() << randomDevice();
+    const auto tempPath = path + tempSuffix.str();
+
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        EntryWriter writer(out);
+
+        writer.write(formatMagic);
+        writer.write(formatVersion);
+
+        writer.write(keyChars(key));
+
+        writer.write(uint64_t(renderables.instanceNumber));
+
+        const auto &weldStatistics = renderables.weldStatistics();
+        writer.write(uint64_t(weldStatistics.weldCount));
+        writer.write(uint64_t(weldStatistics.minVertexCount));
+        writer.write(uint64_t(weldStatistics.maxVertexCount));
+
+        writeStatistics(writer, renderables.vertexCacheOptimization().before);
+        writeStatistics(writer, renderables.vertexCacheOptimization().after);
+
+        const auto &table = renderables.table();
+        writer.write(uint64_t(table.size()));
+
+        for (auto &&pair : table) {
+            writer.write(int32_t(pair.first.shaderIndex));
+            writer.write(uint64_t(pair.first.slotUsage));
+            writer.write(uint64_t(pair.second.size()));
+
+            for (auto &part : pair.second) {
+                writer.write(uint64_t(part.vertexCount));
+                writer.writeVector(part.indices);
+
+                writer.write(uint64_t(part.componentsMap.size()));
+                for (auto *slotEntry : sortedSlots(part.componentsMap)) {
+                    writer.writeSlot(slotEntry->first);
+                    writer.writeVector(slotEntry->second);
+                }
+
+                writer.write(uint64_t(part.nonZeroDeltaVertices.size()));
+                for (auto *slotEntry : sortedSlots(part.nonZeroDeltaVertices)) {
+                    writer.writeSlot(slotEntry->first);
+                    writer.writeVector(slotEntry->second);
+                }
+            }
+        }
+
+        if (!out) {
+            cerr << prefix << "WARNING: Failed to write mesh cache entry " << tempPath << endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return;
+        }
+    }
+
+    // Renaming onto an existing file fails on Windows; another export wrote the same entry then.
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+    }
+}
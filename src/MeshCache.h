@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MeshRenderables.h"
+
+/**
+ * An on-disk cache of the welded vertex buffers of meshes, so unchanged
+ * meshes are not welded and optimized again by the next export.
+ * Each entry is a file named after the content hash of the extracted
+ * geometry of a mesh and the arguments that affect welding, the fast
+ * 128-bit hash of BufferHash, or SHA-256 when the arguments ask for it.
+ * Entries are never invalidated, a changed mesh just gets a new hash,
+ * so the folder can be deleted at any time.
+ */
+class MeshCache {
+  public:
+    explicit MeshCache(std::string folder);
+    ~MeshCache();
+
+    const std::string folder;
+
+    /** The content hash of everything that determines the renderables */
+    static std::string key(const MeshGeometry &geometry,
+                           const CoreArguments &args);
+
+    /** nullptr when the entry doesn't exist, can't be read, or holds vertex
+     * indices out of range */
+    std::unique_ptr<MeshRenderables> load(const std::string &key) const;
+
+    /** Failures are reported, not thrown, a cache miss only costs time */
+    void store(const std::string &key,
+               const MeshRenderables &renderables) const;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(MeshCache);
+
+    std::string entryPath(const std::string &key) const;
+};
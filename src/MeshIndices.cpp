@@ -2,11 +2,14 @@
 
 #include "MayaException.h"
 #include "MeshIndices.h"
+#include "Profiler.h"
 #include "dump.h"
 
 MeshIndices::MeshIndices(const MeshSemantics *meshSemantics,
                          const MFnMesh &fnMesh)
     : meshName(fnMesh.partialPathName().asChar()), semantics(*meshSemantics) {
+    PROFILE_SCOPE("mesh.indices");
+
     MStatus status;
 
     const auto instanceCount = fnMesh.instanceCount(true);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MeshSemantics.h"
+#include "MeshTables.h"
 #include "macros.h"
 #include "sceneTypes.h"
 
@@ -13,16 +14,6 @@
  * corner
  */
 
-// NOTE: Some elements might have no indices for some semantics (UVs, color,
-// tangent). In this case, NoIndex (-1) is used.
-//
-// When splitting a mesh into renderable parts,
-// we determine what semantics are actually used
-const Index NoIndex = -1;
-
-typedef std::vector<IndexVector> VertexElementIndicesPerSetIndex;
-typedef std::array<VertexElementIndicesPerSetIndex, Semantic::COUNT>
-    VertexElementIndicesPerSetIndexTable;
 typedef std::vector<bool> ShaderUsageVector;
 
 // Maya face index
@@ -0,0 +1,174 @@
+#include "coreExternals.h"
+
+#include "CoreArguments.h"
+#include "MeshQuantization.h"
+#include "accessors.h"
+
+using GLTF::Constants::WebGL;
+
+namespace {
+const int maxShort = std::numeric_limits<int16_t>::max();
+
+template <typename T>
+std::unique_ptr<GLTF::Accessor> integerAccessor(const std::string &name, const size_t dimension,
+                                                const WebGL componentType, const bool isNormalized,
+                                                const std::vector<T> &values) {
+    auto bytes = reinterpret_span<byte>(values);
+    auto data = const_cast<byte *>(bytes.data());
+    const auto count = int(values.size() / dimension);
+    const auto type = glAccessorType(dimension);
+
+    std::unique_ptr<GLTF::Accessor> accessor =
+        isNormalized ? std::make_unique<NormalizedAccessor>(type, componentType, data, count, WebGL::ARRAY_BUFFER)
+                     : std::make_unique<GLTF::Accessor>(type, componentType, data, count, WebGL::ARRAY_BUFFER);
+
+    accessor->name = name;
+    return accessor;
+}
+
+template <typename T>
+std::unique_ptr<GLTF::Accessor> normalizedAccessor(const std::string &name, const size_t dimension,
+                                                   const WebGL componentType,
+                                                   const gsl::span<const float> components) {
+    const double maxValue = std::numeric_limits<T>::max();
+    const double minValue = std::is_signed<T>::value ? -1 : 0;
+
+    std::vector<T> values(components.size());
+    for (size_t index = 0; index < values.size(); ++index) {
+        const auto component = std::min(1.0, std::max(minValue, double(components[index])));
+        values[index] = static_cast<T>(std::lround(component * maxValue));
+    }
+
+    return integerAccessor(name, dimension, componentType, true, values);
+}
+
+/** The smallest normalized accessor within the error bound, if the components are in its range */
+std::unique_ptr<GLTF::Accessor> normalizedAccessor(const std::string &name, const size_t dimension,
+                                                   const gsl::span<const float> components, const double maxError,
+                                                   const bool allowUnsigned, const bool allowSigned) {
+    if (components.empty())
+        return nullptr;
+
+    const auto range = std::minmax_element(components.begin(), components.end());
+    const auto minComponent = *range.first;
+    const auto maxComponent = *range.second;
+
+    if (allowUnsigned && minComponent >= 0 && maxComponent <= 1) {
+        if (0.5 / std::numeric_limits<uint8_t>::max() <= maxError)
+            return normalizedAccessor<uint8_t>(name, dimension, WebGL::UNSIGNED_BYTE, components);
+        if (0.5 / std::numeric_limits<uint16_t>::max() <= maxError)
+            return normalizedAccessor<uint16_t>(name, dimension, WebGL::UNSIGNED_SHORT, components);
+    }
+
+    if (allowSigned && minComponent >= -1 && maxComponent <= 1) {
+        if (0.5 / std::numeric_limits<int8_t>::max() <= maxError)
+            return normalizedAccessor<int8_t>(name, dimension, WebGL::BYTE, components);
+        if (0.5 / std::numeric_limits<int16_t>::max() <= maxError)
+            return normalizedAccessor<int16_t>(name, dimension, WebGL::SHORT, components);
+    }
+
+    return nullptr;
+}
+
+std::unique_ptr<GLTF::Accessor> positionAccessor(const std::string &name, const ShapeIndex &shapeIndex,
+                                                 const gsl::span<const float> components,
+                                                 const PositionQuantization &quantization) {
+    const auto dimension = array_size<Position>::size;
+    const double invScale = 1.0 / quantization.scale;
+    const bool isMainShape = shapeIndex.isMainShapeIndex();
+
+    std::vector<int16_t> values(components.size());
+    bool fitsShort = true;
+
+    for (size_t index = 0; index < values.size() && fitsShort; ++index) {
+        // Blend shape deltas are only scaled, not offset.
+        const auto offset = isMainShape ? quantization.offset[index % dimension] : 0;
+        const auto value = std::lround((components[index] - offset) * invScale);
+        fitsShort = std::abs(value) <= maxShort;
+        values[index] = static_cast<int16_t>(std::min<long>(maxShort, std::max<long>(-maxShort, value)));
+    }
+
+    if (fitsShort || isMainShape) {
+        return integerAccessor(name, dimension, WebGL::SHORT, false, values);
+    }
+
+    // Large blend shape deltas stay FLOAT, but are still dequantized by the mesh transform.
+    std::vector<float> scaledComponents(components.size());
+    for (size_t index = 0; index < scaledComponents.size(); ++index) {
+        scaledComponents[index] = static_cast<float>(components[index] * invScale);
+    }
+
+    return contiguousAccessor(name, glAccessorType(dimension), WebGL::FLOAT, WebGL::ARRAY_BUFFER,
+                              span(scaledComponents), dimension);
+}
+} // namespace
+
+PositionQuantization PositionQuantization::fromPositions(const gsl::span<const Position> positions,
+                                                         const double maxError) {
+    PositionQuantization quantization;
+
+    if (positions.empty())
+        return quantization;
+
+    Position minPosition = positions[0];
+    Position maxPosition = positions[0];
+
+    for (auto &position : positions) {
+        for (size_t axis = 0; axis < position.size(); ++axis) {
+            minPosition[axis] = std::min(minPosition[axis], position[axis]);
+            maxPosition[axis] = std::max(maxPosition[axis], position[axis]);
+        }
+    }
+
+    double extent = 0;
+    for (size_t axis = 0; axis < minPosition.size(); ++axis) {
+        quantization.offset[axis] = (minPosition[axis] + maxPosition[axis]) / 2;
+        extent = std::max(extent, double(maxPosition[axis]) - minPosition[axis]);
+    }
+
+    const auto scale = extent > 0 ? extent / (2 * maxShort) : 1;
+
+    // Rounding to the nearest integer introduces an error of half a step.
+    quantization.scale = scale / 2 <= maxError ? static_cast<float>(scale) : 0;
+
+    return quantization;
+}
+
+void NormalizedAccessor::writeJSON(void *writer, GLTF::Options *options) {
+    GLTF::Accessor::writeJSON(writer, options);
+
+    auto *jsonWriter = static_cast<rapidjson::Writer<rapidjson::StringBuffer> *>(writer);
+    jsonWriter->Key("normalized");
+    jsonWriter->Bool(true);
+}
+
+std::unique_ptr<GLTF::Accessor> quantizedElementAccessor(const std::string &name, const Semantic::Kind semantic,
+                                                         const ShapeIndex &shapeIndex,
+                                                         const gsl::span<const float> components,
+                                                         const CoreArguments &args,
+                                                         const PositionQuantization &positionQuantization) {
+    const auto dim = dimension(semantic, shapeIndex);
+    const bool isMainShape = shapeIndex.isMainShapeIndex();
+
+    switch (semantic) {
+    case Semantic::POSITION:
+        return positionQuantization.isEnabled()
+                   ? positionAccessor(name, shapeIndex, components, positionQuantization)
+                   : nullptr;
+
+    case Semantic::NORMAL:
+    case Semantic::TANGENT:
+        return normalizedAccessor(name, dim, components, args.normalQuantizationError, false, true);
+
+    case Semantic::TEXCOORD:
+        return isMainShape ? normalizedAccessor(name, dim, components, args.texCoordQuantizationError, true, true)
+                           : nullptr;
+
+    case Semantic::COLOR:
+        return isMainShape ? normalizedAccessor(name, dim, components, args.colorQuantizationError, true, false)
+                           : nullptr;
+
+    default:
+        return nullptr;
+    }
+}
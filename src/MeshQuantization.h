@@ -0,0 +1,39 @@
+#pragma once
+
+#include "sceneTypes.h"
+
+struct CoreArguments;
+
+/**
+ * The KHR_mesh_quantization of the positions of a mesh: 16-bit integers in
+ * a cube around the mesh, with position = offset + scale * quantized. The
+ * scale is uniform, so the dequantization transform doesn't skew normals.
+ */
+struct PositionQuantization {
+    Position offset = {0, 0, 0};
+    float scale = 0;
+
+    bool isEnabled() const { return scale > 0; }
+
+    /** Disabled when the quantization error would exceed maxError */
+    static PositionQuantization fromPositions(gsl::span<const Position> positions, double maxError);
+};
+
+/** An accessor with normalized integer components */
+class NormalizedAccessor : public GLTF::Accessor {
+  public:
+    using GLTF::Accessor::Accessor;
+
+    void writeJSON(void *writer, GLTF::Options *options) override;
+};
+
+/**
+ * Creates a KHR_mesh_quantization accessor for the float components of a
+ * vertex attribute, using the smallest integer type that stays within the
+ * error bound of the attribute. Returns nullptr when the attribute must
+ * stay FLOAT.
+ */
+std::unique_ptr<GLTF::Accessor> quantizedElementAccessor(const std::string &name, Semantic::Kind semantic,
+                                                         const ShapeIndex &shapeIndex,
+                                                         gsl::span<const float> components, const CoreArguments &args,
+                                                         const PositionQuantization &positionQuantization);
@@ -1,50 +1,361 @@
-#include "externals.h"
+#include "coreExternals.h"
 
-#include "Arguments.h"
+#include "CoreArguments.h"
 #include "IndentableStream.h"
-#include "Mesh.h"
-#include "MeshIndices.h"
 #include "MeshRenderables.h"
-#include "MeshVertices.h"
+#include "Profiler.h"
+#include "VertexCacheOptimizer.h"
 using namespace coveo::linq;
 
-MeshRenderables::MeshRenderables(const MeshShapes &meshShapes,
-                                 const Arguments &args)
-    : instanceNumber(meshShapes.at(0)->instanceNumber()) {
-    MStatus status;
+namespace {
+/** 16-bit indices can't use 0xFFFF, the primitive restart value */
+const size_t maxShortIndexVertexCount = std::numeric_limits<uint16_t>::max();
+
+/** Spreads the lower 10 bits of x to every third bit */
+uint32_t spreadMortonBits(uint32_t x) {
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
 
-    const auto &mainShape = dynamic_cast<MainShape *>(meshShapes.at(0));
-    const auto &mainIndices = mainShape->indices();
-    const auto &mainVertices = mainShape->vertices();
-    const auto &mainIndicesTable = mainIndices.table();
-    const auto &mainVerticesTable = mainVertices.table();
+/** The triangles of a vertex buffer, sorted along a Morton curve through
+ * their centroids */
+std::vector<size_t> spatialTriangleOrder(const VertexBuffer &vertexBuffer) {
+    const auto &indices = vertexBuffer.indices;
+    const auto triangleCount = indices.size() / 3;
 
-    auto &shadingPerInstance = mainIndices.shadingPerInstance();
+    std::vector<size_t> order(triangleCount);
+    std::iota(order.begin(), order.end(), 0);
 
-    auto &shading = shadingPerInstance.at(instanceNumber);
+    const VertexSlot positionSlot(ShapeIndex::main(), Semantic::POSITION, 0);
+    const auto positionsIt = vertexBuffer.componentsMap.find(positionSlot);
+    if (positionsIt == vertexBuffer.componentsMap.end())
+        return order;
 
-    const auto primitiveCount = mainIndices.primitiveCount();
-    const auto maxVertexCount = mainIndices.maxVertexCount();
-    const auto minVertexCount = mainShape->semantics()
-                                    .descriptions(Semantic::POSITION)
-                                    .at(0)
-                                    .elementCount;
-    const auto perPrimitiveVertexCount = mainIndices.perPrimitiveVertexCount();
+    const auto positions = reinterpret_span<Position>(positionsIt->second);
 
-    auto primitiveVertexIndex = 0;
+    Position minPosition = positions[0];
+    Position maxPosition = positions[0];
+    for (auto &position : positions) {
+        for (size_t axis = 0; axis < 3; ++axis) {
+            minPosition[axis] = std::min(minPosition[axis], position[axis]);
+            maxPosition[axis] = std::max(maxPosition[axis], position[axis]);
+        }
+    }
+
+    std::vector<uint32_t> codes(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        uint32_t code = 0;
+        for (size_t axis = 0; axis < 3; ++axis) {
+            const auto centroid = (positions[indices[triangle * 3 + 0]][axis] +
+                                   positions[indices[triangle * 3 + 1]][axis] +
+                                   positions[indices[triangle * 3 + 2]][axis]) /
+                                  3;
+            const auto extent = maxPosition[axis] - minPosition[axis];
+            const auto cell =
+                extent > 0 ? (centroid - minPosition[axis]) / extent * 1023 : 0;
+            code |= spreadMortonBits(static_cast<uint32_t>(cell)) << axis;
+        }
+        codes[triangle] = code;
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+                     [&codes](const size_t a, const size_t b) {
+                         return codes[a] < codes[b];
+                     });
+
+    return order;
+}
+
+/**
+ * Renumbers the vertices of the sparse deltas of a blend-shape slot,
+ * dropping the vertices without a new index, and keeps them sorted.
+ */
+void remapSparseDeltas(const IndexVector &vertices,
+                       const VertexElementData &deltas,
+                       const size_t elementByteSize,
+                       const IndexVector &newVertexIndices,
+                       IndexVector &newVertices, VertexElementData &newDeltas) {
+    std::vector<std::pair<Index, size_t>> order;
+    order.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const auto newVertexIndex = newVertexIndices[vertices[i]];
+        if (newVertexIndex >= 0) {
+            order.emplace_back(newVertexIndex, i);
+        }
+    }
+
+    std::sort(order.begin(), order.end());
+
+    newVertices.clear();
+    newVertices.reserve(order.size());
+    newDeltas.clear();
+    newDeltas.reserve(order.size() * elementByteSize);
+
+    for (auto &&pair : order) {
+        const auto element = deltas.begin() + pair.second * elementByteSize;
+        newVertices.push_back(pair.first);
+        newDeltas.insert(newDeltas.end(), element, element + elementByteSize);
+    }
+}
 
-    VertexElementData vertexIndexKey;
-    VertexLayout vertexLayout;
+/**
+ * Splits a vertex buffer into parts of at most maxVertexCount vertices, so
+ * each part can use 16-bit indices. Spatially coherent triangles are kept
+ * together, so only the vertices on the boundaries of the parts are
+ * duplicated, with the components of all their slots.
+ */
+VertexBufferParts splitVertexBuffer(const VertexBuffer &vertexBuffer,
+                                    const size_t maxVertexCount) {
+    const auto &indices = vertexBuffer.indices;
+
+    VertexBufferParts parts;
+    IndexVector partVertexIndices(vertexBuffer.vertexCount, -1);
+    IndexVector partVertices;
+    IndexVector partIndices;
+
+    const auto addPart = [&]() {
+        VertexBuffer part;
+        part.indices = std::move(partIndices);
+        part.vertexCount = partVertices.size();
+
+        for (auto &&pair : vertexBuffer.componentsMap) {
+            const auto &slot = pair.first;
+            const auto &data = pair.second;
+
+            if (slot.shapeIndex.isBlendShapeIndex()) {
+                remapSparseDeltas(vertexBuffer.nonZeroDeltaVertices.at(slot),
+                                  data, slot.elementByteSize(),
+                                  partVertexIndices,
+                                  part.nonZeroDeltaVertices[slot],
+                                  part.componentsMap[slot]);
+                continue;
+            }
+
+            const auto elementByteSize = data.size() / vertexBuffer.vertexCount;
+
+            auto &partData = part.componentsMap[pair.first];
+            partData.reserve(partVertices.size() * elementByteSize);
+
+            for (auto vertex : partVertices) {
+                const auto element = data.begin() + vertex * elementByteSize;
+                partData.insert(partData.end(), element,
+                                element + elementByteSize);
+            }
+        }
+
+        for (auto vertex : partVertices) {
+            partVertexIndices[vertex] = -1;
+        }
+
+        partVertices.clear();
+        partIndices = IndexVector();
+        parts.emplace_back(std::move(part));
+    };
+
+    for (auto triangle : spatialTriangleOrder(vertexBuffer)) {
+        const auto *corners = &indices[triangle * 3];
+
+        size_t newVertexCount = 0;
+        for (int corner = 0; corner < 3; ++corner) {
+            const auto isRepeated = std::find(corners, corners + corner,
+                                              corners[corner]) != corners + corner;
+            newVertexCount += partVertexIndices[corners[corner]] < 0 && !isRepeated;
+        }
+
+        if (partVertices.size() + newVertexCount > maxVertexCount) {
+            addPart();
+        }
+
+        for (int corner = 0; corner < 3; ++corner) {
+            auto &partVertexIndex = partVertexIndices[corners[corner]];
+            if (partVertexIndex < 0) {
+                partVertexIndex = static_cast<Index>(partVertices.size());
+                partVertices.push_back(corners[corner]);
+            }
+            partIndices.push_back(partVertexIndex);
+        }
+    }
+
+    if (!partIndices.empty()) {
+        addPart();
+    }
+
+    return parts;
+}
+
+} // namespace
+
+MeshRenderables::MeshRenderables(const MeshGeometry &geometry,
+                                 const CoreArguments &args)
+    : instanceNumber(geometry.instanceNumber) {
+    PROFILE_STAGE("mesh.weld");
+
+    const auto &mainIndicesTable = *geometry.indices;
+    const auto &mainVerticesTable = *geometry.mainVertices;
+    const auto &targetDeltas = geometry.targetDeltas;
+
+    const auto &primitiveToShaderIndexMap =
+        *geometry.primitiveToShaderIndexMap;
+
+    const auto primitiveCount = geometry.primitiveCount;
+    const auto maxVertexCount = geometry.maxVertexCount();
+    const auto minVertexCount =
+        mainVerticesTable.at(Semantic::POSITION).at(0).floats().size() /
+        dimension(Semantic::POSITION, ShapeIndex::main());
+    const auto perPrimitiveVertexCount = geometry.perPrimitiveVertexCount;
+
+    auto primitiveVertexIndex = 0;
 
     const auto semanticsMask = args.meshPrimitiveAttributes;
 
+    VertexBufferTable table;
+
+    // The slots of the main shape that can be used by a vertex, per semantic
+    // and set.
+    struct SlotSource {
+        VertexSlot slot;
+        const IndexVector &indices;
+        const VertexElementsPerSetIndex &elementsPerSet;
+    };
+
+    std::vector<SlotSource> slotSources;
+
+    for (auto semanticIndex = 0U; semanticIndex < mainVerticesTable.size();
+         ++semanticIndex) {
+        if (!mainVerticesTable.at(semanticIndex).empty() &&
+            semanticsMask.test(semanticIndex)) {
+            const auto semantic = Semantic::from(semanticIndex);
+            const auto &indicesPerSet = mainIndicesTable.at(semanticIndex);
+
+            for (size_t setIndex = 0; setIndex < indicesPerSet.size();
+                 ++setIndex) {
+                slotSources.push_back(
+                    {VertexSlot(ShapeIndex::main(), semantic, int(setIndex)),
+                     indicesPerSet.at(setIndex),
+                     mainVerticesTable.at(semantic)});
+            }
+        }
+    }
+
+    // The blend-shape slots share the element indices of the main shape,
+    // but only store the elements that differ from it.
+    struct TargetSlotSource {
+        VertexSlot slot;
+        const IndexVector &indices;
+        const SparseVertexElements &elements;
+
+        gsl::span<const float> deltasAt(const Index sparseIndex) const {
+            const auto dim = slot.dimension();
+            return gsl::make_span(elements.deltas)
+                .subspan(sparseIndex * dim, dim);
+        }
+    };
+
+    std::vector<TargetSlotSource> targetSlotSources;
+
+    // Per main shape slot and element, the (target slot source, sparse
+    // index) pairs of the targets that move it, so building a vertex only
+    // visits these targets.
+    struct ElementDeltas {
+        const IndexVector &indices;
+        IndexVector firstDelta;
+        std::vector<std::pair<Index, Index>> deltas;
+    };
+
+    std::vector<ElementDeltas> elementDeltasPerSlot;
+
+    for (auto &&source : slotSources) {
+        const auto &slot = source.slot;
+        const auto firstTargetSlotSource = targetSlotSources.size();
+
+        size_t elementCount = 0;
+
+        for (size_t targetIndex = 0; targetIndex < targetDeltas.size();
+             ++targetIndex) {
+            const auto &elementsPerSet =
+                targetDeltas.at(targetIndex)->at(slot.semantic);
+
+            if (size_t(slot.setIndex) < elementsPerSet.size()) {
+                const auto &elements = elementsPerSet.at(slot.setIndex);
+                targetSlotSources.push_back(
+                    {VertexSlot(ShapeIndex::shape(targetIndex + 1),
+                                slot.semantic, slot.setIndex),
+                     source.indices, elements});
+
+                if (!elements.elementIndices.empty()) {
+                    elementCount = std::max(
+                        elementCount,
+                        size_t(elements.elementIndices.back()) + 1);
+                }
+            }
+        }
+
+        if (elementCount == 0)
+            continue;
+
+        ElementDeltas elementDeltas{source.indices,
+                                    IndexVector(elementCount + 1, 0),
+                                    {}};
+        auto &firstDelta = elementDeltas.firstDelta;
+
+        for (auto index = firstTargetSlotSource;
+             index < targetSlotSources.size(); ++index) {
+            for (auto elementIndex :
+                 targetSlotSources[index].elements.elementIndices) {
+                ++firstDelta[elementIndex + 1];
+            }
+        }
+
+        std::partial_sum(firstDelta.begin(), firstDelta.end(),
+                         firstDelta.begin());
+
+        elementDeltas.deltas.resize(firstDelta.back());
+        IndexVector nextDelta(firstDelta.begin(), firstDelta.end() - 1);
+
+        for (auto index = firstTargetSlotSource;
+             index < targetSlotSources.size(); ++index) {
+            const auto &elementIndices =
+                targetSlotSources[index].elements.elementIndices;
+            for (size_t sparseIndex = 0; sparseIndex < elementIndices.size();
+                 ++sparseIndex) {
+                elementDeltas.deltas[nextDelta[elementIndices[sparseIndex]]++] =
+                    {static_cast<Index>(index), static_cast<Index>(sparseIndex)};
+            }
+        }
+
+        elementDeltasPerSlot.emplace_back(std::move(elementDeltas));
+    }
+
+    // The element indices of the main shape, used as the first weld key.
+    std::vector<Index> elementIndicesKey;
+
+    // The component values of the main shape, followed by the identifier of
+    // the blend-shape deltas, used when welding by value.
+    VertexElementData vertexValuesKey;
+
+    // The non-zero blend-shape deltas of a face-vertex. Since these vary in
+    // length, the value weld key holds their length and their index in a
+    // weld table per length, so it has a fixed length.
+    std::vector<std::pair<Index, Index>> vertexDeltas;
+    VertexElementData vertexDeltasKey;
+    std::unordered_map<size_t, WeldTable> vertexDeltasTables;
+
+    // Per vertex buffer and target slot source, the deltas and vertices of
+    // the slot, to add a moved vertex without looking up its slots.
+    typedef std::pair<VertexElementData *, IndexVector *> TargetSlotData;
+    std::unordered_map<const VertexBuffer *, std::vector<TargetSlotData>>
+        targetSlotDataPerBuffer;
+
     auto totalWeldCount = 0;
-    auto totalVertexCount = 0;
 
     for (auto primitiveIndex = 0; primitiveIndex < primitiveCount;
          ++primitiveIndex) {
-        const auto shaderIndex =
-            shading.primitiveToShaderIndexMap[primitiveIndex];
+        const auto shaderIndex = primitiveToShaderIndexMap[primitiveIndex];
 
         for (int counter = perPrimitiveVertexCount; --counter >= 0;
              ++primitiveVertexIndex) {
@@ -52,102 +363,177 @@ MeshRenderables::MeshRenderables(const MeshShapes &meshShapes,
             // 1=used)
             VertexSignature vertexSignature(shaderIndex, 0);
 
-            vertexLayout.clear();
-            vertexIndexKey.clear();
-
-            for (auto shapeIndex = 0U; shapeIndex < meshShapes.size();
-                 ++shapeIndex) {
-                auto &shape = meshShapes.at(shapeIndex);
-                const auto &shapeVerticesTable = shape->vertices().table();
-
-                for (auto semanticIndex = 0U;
-                     semanticIndex < shapeVerticesTable.size();
-                     ++semanticIndex) {
-                    if (!shapeVerticesTable.at(semanticIndex).empty() &&
-                        semanticsMask.test(semanticIndex)) {
-                        const auto &indicesPerSet =
-                            mainIndicesTable.at(semanticIndex);
-
-                        for (auto setIndex = 0; setIndex < indicesPerSet.size();
-                             ++setIndex) {
-                            const auto &indices = indicesPerSet.at(setIndex);
-                            const auto index = indices[primitiveVertexIndex];
-                            const int isUsed = index >= 0;
-                            vertexSignature.slotUsage <<= 1;
-                            vertexSignature.slotUsage |= isUsed;
-                            if (isUsed) {
-                                auto semantic = Semantic::from(semanticIndex);
-                                vertexLayout.emplace_back(
-                                    ShapeIndex::shape(shapeIndex), semantic,
-                                    setIndex);
-
-                                const auto &elementIndices =
-                                    indicesPerSet.at(setIndex);
-                                const auto vertexIndex =
-                                    elementIndices.at(primitiveVertexIndex);
-                                const auto &vertexElements =
-                                    shapeVerticesTable.at(semantic).at(
-                                        setIndex);
-                                const auto &sourceComponents =
-                                    componentsAt(vertexElements, vertexIndex,
-                                                 semantic, shape->shapeIndex);
-                                const auto sourceBytes =
-                                    sourceComponents.bytes();
-                                vertexIndexKey.insert(vertexIndexKey.end(),
-                                                      sourceBytes.begin(),
-                                                      sourceBytes.end());
-                            }
-                        }
+            elementIndicesKey.clear();
+
+            for (auto &&source : slotSources) {
+                const auto index = source.indices[primitiveVertexIndex];
+                const int isUsed = index >= 0;
+                vertexSignature.slotUsage <<= 1;
+                vertexSignature.slotUsage |= isUsed;
+                elementIndicesKey.push_back(index);
+            }
+
+            auto &vertexBuffers = table[vertexSignature];
+            if (vertexBuffers.empty()) {
+                auto &newBuffer = vertexBuffers.emplace_back();
+                auto &targetSlotData = targetSlotDataPerBuffer[&newBuffer];
+                targetSlotData.resize(targetSlotSources.size());
+
+                // Every buffer has all the blend-shape slots of its
+                // signature, also when none of its vertices is moved.
+                for (size_t index = 0; index < targetSlotSources.size();
+                     ++index) {
+                    const auto &source = targetSlotSources[index];
+                    if (source.indices[primitiveVertexIndex] >= 0) {
+                        auto &deltas = newBuffer.componentsMap[source.slot];
+                        auto &vertices =
+                            newBuffer.nonZeroDeltaVertices[source.slot];
+                        deltas.reserve(source.elements.deltas.size() *
+                                       sizeof(float));
+                        vertices.reserve(source.elements.size());
+                        targetSlotData[index] = {&deltas, &vertices};
                     }
                 }
             }
 
-            // Check if a vertex with exactly the same components already
-            // exists.
-            VertexBuffer &vertexBuffer = m_table[vertexSignature];
+            VertexBuffer &vertexBuffer = vertexBuffers.front();
+
+            // Face-vertices with the same element indices always weld.
+            bool isNewElementIndices;
+
+            const auto elementIndicesIndex =
+                vertexBuffer.elementIndicesTable.findOrInsert(
+                    reinterpret_span<byte>(elementIndicesKey),
+                    isNewElementIndices);
+
+            if (!isNewElementIndices) {
+                // Reuse the same vertex.
+                vertexBuffer.indices.push_back(
+                    vertexBuffer.elementIndicesToVertex[elementIndicesIndex]);
+
+                ++totalWeldCount;
+                continue;
+            }
 
-            auto &componentsMap = vertexBuffer.componentsMap;
+            vertexDeltas.clear();
+
+            for (auto &&elementDeltas : elementDeltasPerSlot) {
+                const auto index = elementDeltas.indices[primitiveVertexIndex];
+                if (index >= 0 &&
+                    size_t(index) + 1 < elementDeltas.firstDelta.size()) {
+                    const auto first = elementDeltas.deltas.begin();
+                    vertexDeltas.insert(
+                        vertexDeltas.end(),
+                        first + elementDeltas.firstDelta[index],
+                        first + elementDeltas.firstDelta[index + 1]);
+                }
+            }
 
             VertexIndex sharedVertexIndex;
+            bool isNewVertex = true;
+
+            if (args.weldByIndices) {
+                sharedVertexIndex =
+                    static_cast<VertexIndex>(vertexBuffer.vertexCount);
+            } else {
+                // Check if a vertex with exactly the same components already
+                // exists.
+                vertexValuesKey.clear();
+
+                for (auto &&source : slotSources) {
+                    const auto index = source.indices[primitiveVertexIndex];
+                    if (index >= 0) {
+                        const auto &sourceComponents = componentsAt(
+                            source.elementsPerSet.at(source.slot.setIndex),
+                            index, source.slot.semantic,
+                            source.slot.shapeIndex);
+                        const auto sourceBytes = sourceComponents.bytes();
+                        vertexValuesKey.insert(vertexValuesKey.end(),
+                                               sourceBytes.begin(),
+                                               sourceBytes.end());
+                    }
+                }
 
-            const auto itSharedIndex =
-                vertexBuffer.vertexToIndexMapping.find(vertexIndexKey);
-
-            if (itSharedIndex == vertexBuffer.vertexToIndexMapping.end()) {
-                // No vertex with same indices found, create a new output vertex
-                // index.
-                sharedVertexIndex = static_cast<VertexIndex>(
-                    vertexBuffer.vertexToIndexMapping.size());
-                vertexBuffer.vertexToIndexMapping[vertexIndexKey] =
-                    sharedVertexIndex;
-
-                // Build the vertex.
-                for (auto &&slot : vertexLayout) {
-                    auto &shape = meshShapes.at(slot.shapeIndex.arrayIndex());
-
-                    const auto &elementIndices =
-                        mainIndices.indicesAt(slot.semantic, slot.setIndex);
-                    const auto vertexIndex =
-                        elementIndices.at(primitiveVertexIndex);
-                    const auto &vertexElements =
-                        shape->vertices().vertexElementComponentsAt(
-                            slot.semantic, slot.setIndex);
-                    const auto &sourceComponents =
-                        componentsAt(vertexElements, vertexIndex, slot.semantic,
-                                     slot.shapeIndex);
-                    const auto sourceBytes = sourceComponents.bytes();
-                    auto &target = componentsMap[slot];
-                    if (target.empty()) {
-                        target.reserve(maxVertexCount * slot.elementByteSize());
+                Index vertexDeltasId[2] = {0, NoIndex};
+
+                if (!vertexDeltas.empty()) {
+                    vertexDeltasKey.clear();
+
+                    for (auto &&delta : vertexDeltas) {
+                        const auto sourceBytes =
+                            reinterpret_span<byte>(gsl::make_span(&delta.first, 1));
+                        const auto deltaBytes = reinterpret_span<byte>(
+                            targetSlotSources[delta.first].deltasAt(
+                                delta.second));
+                        vertexDeltasKey.insert(vertexDeltasKey.end(),
+                                               sourceBytes.begin(),
+                                               sourceBytes.end());
+                        vertexDeltasKey.insert(vertexDeltasKey.end(),
+                                               deltaBytes.begin(),
+                                               deltaBytes.end());
                     }
 
-                    target.insert(target.end(), sourceBytes.begin(),
-                                  sourceBytes.end());
+                    bool isNewDeltas;
+                    vertexDeltasId[0] =
+                        static_cast<Index>(vertexDeltasKey.size());
+                    vertexDeltasId[1] =
+                        vertexDeltasTables[vertexDeltasKey.size()].findOrInsert(
+                            span(vertexDeltasKey), isNewDeltas);
+                }
+
+                const auto idBytes = reinterpret_span<byte>(
+                    gsl::make_span(vertexDeltasId, 2));
+                vertexValuesKey.insert(vertexValuesKey.end(), idBytes.begin(),
+                                       idBytes.end());
+
+                sharedVertexIndex = vertexBuffer.weldTable.findOrInsert(
+                    span(vertexValuesKey), isNewVertex);
+            }
+
+            vertexBuffer.elementIndicesToVertex.push_back(sharedVertexIndex);
+
+            if (isNewVertex) {
+                // No vertex with same components found, build a new one.
+                ++vertexBuffer.vertexCount;
+
+                auto &componentsMap = vertexBuffer.componentsMap;
+
+                for (auto &&source : slotSources) {
+                    const auto index = source.indices[primitiveVertexIndex];
+                    if (index >= 0) {
+                        auto &slot = source.slot;
+                        const auto &sourceComponents =
+                            componentsAt(source.elementsPerSet.at(slot.setIndex),
+                                         index, slot.semantic, slot.shapeIndex);
+                        const auto sourceBytes = sourceComponents.bytes();
+                        auto &target = componentsMap[slot];
+                        if (target.empty()) {
+                            target.reserve(maxVertexCount *
+                                           slot.elementByteSize());
+                        }
+
+                        target.insert(target.end(), sourceBytes.begin(),
+                                      sourceBytes.end());
+                    }
+                }
+
+                if (!vertexDeltas.empty()) {
+                    const auto &targetSlotData =
+                        targetSlotDataPerBuffer.at(&vertexBuffer);
+
+                    for (auto &&delta : vertexDeltas) {
+                        const auto deltaBytes = reinterpret_span<byte>(
+                            targetSlotSources[delta.first].deltasAt(
+                                delta.second));
+                        auto &target = *targetSlotData[delta.first].first;
+                        target.insert(target.end(), deltaBytes.begin(),
+                                      deltaBytes.end());
+                        targetSlotData[delta.first].second->push_back(
+                            sharedVertexIndex);
+                    }
                 }
             } else {
                 // Reuse the same vertex.
-                sharedVertexIndex = itSharedIndex->second;
-
                 ++totalWeldCount;
             }
 
@@ -155,59 +541,144 @@ MeshRenderables::MeshRenderables(const MeshShapes &meshShapes,
         }
     }
 
-    cout << prefix << mainShape->dagPath().partialPathName().asChar()
-         << " will have " << maxVertexCount - totalWeldCount
-         << " vertices. Welded#" << totalWeldCount << ", min#" << minVertexCount
-         << ", max#" << maxVertexCount << endl;
-
-    // Now compute the blend-shape vector-deltas by subtracting the
-    // blend-shape-base mesh from the blend-shape-targets
-    if (meshShapes.size() > 1) {
-        for (auto &&pair : m_table) {
-            VertexBuffer &buffer = pair.second;
-            VertexElementsMap &compMap = buffer.componentsMap;
-
-            for (auto &&slotCompPair : compMap) {
-                auto &targetSlot = slotCompPair.first;
-
-                if (targetSlot.shapeIndex.isBlendShapeIndex()) {
-                    const VertexSlot mainSlot(ShapeIndex::main(),
-                                              targetSlot.semantic,
-                                              targetSlot.setIndex);
-                    auto sourceComponents =
-                        reinterpret_span<float>(compMap.at(mainSlot));
-                    auto targetComponents = mutable_span(
-                        reinterpret_span<float>(slotCompPair.second));
-
-                    // The annoying fact that TANGENTs have dimension 4 in the
-                    // main shape and 3 in the targets requires this hacky code.
-                    const auto sourceDimension = mainSlot.dimension();
-                    const auto targetDimension = targetSlot.dimension();
-                    const auto sharedDimension =
-                        std::min(sourceDimension, targetDimension);
-                    const auto sourceComponentCount = sourceComponents.size();
-                    const auto targetComponentCount = targetComponents.size();
-                    assert(sourceComponentCount / sourceDimension ==
-                           targetComponentCount / targetDimension);
-
-                    for (size_t sourceIndex = 0U, targetIndex = 0U;
-                         sourceIndex < size_t(sourceComponentCount);
-                         sourceIndex += sourceDimension,
-                                targetIndex += targetDimension) {
-                        for (size_t dimension = 0; dimension < sharedDimension;
-                             ++dimension) {
-                            targetComponents[targetIndex + dimension] -=
-                                sourceComponents[sourceIndex + dimension];
-                        }
-                    }
+    // The weld tables are only needed while welding.
+    for (auto &&pair : table) {
+        auto &vertexBuffer = pair.second.front();
+        vertexBuffer.weldTable = WeldTable();
+        vertexBuffer.elementIndicesTable = WeldTable();
+        vertexBuffer.elementIndicesToVertex = IndexVector();
+    }
+
+    m_weldStatistics.weldCount = totalWeldCount;
+    m_weldStatistics.minVertexCount = minVertexCount;
+    m_weldStatistics.maxVertexCount = maxVertexCount;
+
+    if (perPrimitiveVertexCount == 3) {
+        for (auto &&pair : table) {
+            auto &vertexBuffers = pair.second;
+            const auto &vertexBuffer = vertexBuffers.front();
+
+            if (args.optimizeVertexCache) {
+                m_vertexCacheOptimization.before += analyzeVertexCache(
+                    span(vertexBuffer.indices), vertexBuffer.vertexCount);
+            }
+
+            if (args.splitLargePrimitives && !args.force32bitIndices &&
+                vertexBuffer.vertexCount > maxShortIndexVertexCount) {
+                vertexBuffers =
+                    splitVertexBuffer(vertexBuffer, maxShortIndexVertexCount);
+            }
+
+            if (args.optimizeVertexCache) {
+                for (auto &part : vertexBuffers) {
+                    optimizeVertexBuffer(part, args);
+                    m_vertexCacheOptimization.after +=
+                        analyzeVertexCache(span(part.indices), part.vertexCount);
                 }
             }
         }
     }
+
+    m_table.reserve(table.size());
+    for (auto &&pair : table) {
+        m_table.emplace_back(pair.first, std::move(pair.second));
+    }
 }
 
+MeshRenderables::MeshRenderables(
+    const InstanceNumber instanceNumber, VertexBufferEntries table,
+    const WeldStatistics &weldStatistics,
+    const VertexCacheOptimization &vertexCacheOptimization)
+    : instanceNumber(instanceNumber), m_table(std::move(table)),
+      m_weldStatistics(weldStatistics),
+      m_vertexCacheOptimization(vertexCacheOptimization) {}
+
 MeshRenderables::~MeshRenderables() = default;
 
+void MeshRenderables::optimizeVertexBuffer(VertexBuffer &vertexBuffer,
+                                           const CoreArguments &args) {
+    auto &indices = vertexBuffer.indices;
+    const auto vertexCount = vertexBuffer.vertexCount;
+
+    if (vertexCount == 0)
+        return;
+
+    optimizeVertexCache(gsl::make_span(indices), vertexCount);
+
+    const VertexSlot positionSlot(ShapeIndex::main(), Semantic::POSITION, 0);
+    const auto positionsIt = vertexBuffer.componentsMap.find(positionSlot);
+
+    if (args.overdrawThreshold > 0 &&
+        positionsIt != vertexBuffer.componentsMap.end()) {
+        optimizeOverdraw(gsl::make_span(indices),
+                         reinterpret_span<Position>(positionsIt->second),
+                         args.overdrawThreshold);
+    }
+
+    // Store the vertices in the order they are first used.
+    const auto newVertexIndices =
+        optimizeVertexFetch(gsl::make_span(indices), vertexCount);
+
+    for (auto &&pair : vertexBuffer.componentsMap) {
+        const auto &slot = pair.first;
+        auto &data = pair.second;
+
+        if (slot.shapeIndex.isBlendShapeIndex()) {
+            auto &vertices = vertexBuffer.nonZeroDeltaVertices.at(slot);
+            IndexVector sortedVertices;
+            VertexElementData sortedDeltas;
+            remapSparseDeltas(vertices, data, slot.elementByteSize(),
+                              newVertexIndices, sortedVertices, sortedDeltas);
+            vertices = std::move(sortedVertices);
+            data = std::move(sortedDeltas);
+            continue;
+        }
+
+        const auto elementByteSize = data.size() / vertexCount;
+
+        VertexElementData sortedData(data.size());
+        for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+            std::copy_n(&data[vertex * elementByteSize], elementByteSize,
+                        &sortedData[newVertexIndices[vertex] * elementByteSize]);
+        }
+
+        data = std::move(sortedData);
+    }
+}
+
+VertexElementData VertexBuffer::denseComponents(const VertexSlot &slot) const {
+    const auto &data = componentsMap.at(slot);
+
+    if (!slot.shapeIndex.isBlendShapeIndex())
+        return data;
+
+    const auto elementByteSize = slot.elementByteSize();
+    const auto &vertices = nonZeroDeltaVertices.at(slot);
+
+    VertexElementData components(vertexCount * elementByteSize);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        std::copy_n(&data[i * elementByteSize], elementByteSize,
+                    &components[vertices[i] * elementByteSize]);
+    }
+
+    return components;
+}
+
+std::ostream &operator<<(std::ostream &out, const WeldStatistics &obj) {
+    out << "will have " << obj.vertexCount() << " vertices. Welded#"
+        << obj.weldCount << ", min#" << obj.minVertexCount << ", max#"
+        << obj.maxVertexCount;
+    return out;
+}
+
+std::ostream &operator<<(std::ostream &out,
+                         const VertexCacheOptimization &obj) {
+    out << std::fixed << std::setprecision(3) << "ACMR " << obj.before.acmr()
+        << " -> " << obj.after.acmr() << ", ATVR " << obj.before.atvr()
+        << " -> " << obj.after.atvr() << std::defaultfloat;
+    return out;
+}
+
 std::ostream &operator<<(std::ostream &out, const VertexSignature &obj) {
     out << '{' << ' ';
     out << std::quoted("shaderIndex") << ':' << obj.shaderIndex << ',';
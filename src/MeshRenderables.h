@@ -1,10 +1,12 @@
 #pragma once
 
-#include "Mesh.h"
+#include "MeshTables.h"
+#include "VertexCacheOptimizer.h"
+#include "WeldTable.h"
 #include "hashers.h"
 #include "sceneTypes.h"
 
-class Arguments;
+struct CoreArguments;
 
 typedef int VertexIndex;
 
@@ -16,10 +18,11 @@ struct VertexSignature {
     VertexSlotUsage slotUsage;
 
     /**
-     * For each semantic/set-index pair, per shader, for both main mesh and
-     * blend-shapes, a bit to indicate if a vertex element has this
-     * semantic/set-index For example, some of the vertices of a Maya mesh might
-     * not have UVs, colors, etc...
+     * For each semantic/set-index pair of the main mesh, per shader,
+     * a bit to indicate if a vertex element has this semantic/set-index.
+     * The blend-shapes share the element indices, so also their usage.
+     * For example, some of the vertices of a Maya mesh might not have UVs,
+     * colors, etc...
      * TODO: Simpify this!
      */
 
@@ -162,45 +165,100 @@ struct VertexHashers {
     std::size_t operator()(const VertexComponents &vec) const {
         return hash_value(vec.shorts());
     }
-
-    std::size_t operator()(const VertexElementData &elems) const {
-        size_t seed = 0x26DFB62C;
-        for (auto &elem : elems) {
-            seed ^=
-                (seed << 6) + (seed >> 2) + 0x3C2E6B88 + static_cast<size_t>(elem);
-        }
-        return seed;
-    }
 };
 
-typedef std::unordered_map<VertexElementData, Index, VertexHashers>
-    VertexToIndexMapping;
-
 typedef std::unordered_map<VertexSlot, VertexElementData, VertexHashers>
     VertexElementsMap;
 
 struct VertexBuffer {
-    VertexToIndexMapping vertexToIndexMapping;
     IndexVector indices;
+
+    // The components of all vertices for the main shape slots, but only
+    // the deltas of the nonZeroDeltaVertices for the blend-shape slots.
     VertexElementsMap componentsMap;
+    size_t vertexCount = 0;
+
+    // Maps the main shape element indices of a face-vertex to its vertex
+    WeldTable elementIndicesTable;
+    IndexVector elementIndicesToVertex;
+
+    // Maps the component values of a face-vertex to its vertex
+    WeldTable weldTable;
 
-    size_t maxIndex() const { return vertexToIndexMapping.size(); };
+    // The sorted vertices with a non-zero delta, per blend-shape slot
+    std::unordered_map<VertexSlot, IndexVector, VertexHashers>
+        nonZeroDeltaVertices;
+
+    size_t maxIndex() const { return vertexCount; };
+
+    /** The components of all vertices of a slot, with zero deltas for
+     * the blend-shape vertices that are not stored */
+    VertexElementData denseComponents(const VertexSlot &slot) const;
 };
 
-typedef std::unordered_map<VertexSignature, VertexBuffer, VertexHashers>
+/** The vertex buffers of one signature. A single buffer, unless a large
+ * buffer is split to keep 16-bit indices */
+typedef std::vector<VertexBuffer> VertexBufferParts;
+
+typedef std::unordered_map<VertexSignature, VertexBufferParts, VertexHashers>
     VertexBufferTable;
 
+/** The vertex buffers per signature, in a fixed order, so the primitives
+ * keep their order when the renderables are restored from a cache */
+typedef std::vector<std::pair<VertexSignature, VertexBufferParts>>
+    VertexBufferEntries;
+
+/** The number of vertices of a mesh, before and after welding */
+struct WeldStatistics {
+    size_t weldCount = 0;
+    size_t minVertexCount = 0;
+    size_t maxVertexCount = 0;
+
+    size_t vertexCount() const { return maxVertexCount - weldCount; }
+
+    friend std::ostream &operator<<(std::ostream &out,
+                                    const WeldStatistics &obj);
+};
+
+/** The vertex cache efficiency of a mesh, before and after optimisation */
+struct VertexCacheOptimization {
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+
+    friend std::ostream &operator<<(std::ostream &out,
+                                    const VertexCacheOptimization &obj);
+};
+
 class MeshRenderables {
   public:
-    MeshRenderables(const MeshShapes &meshShapes, const Arguments &args);
+    MeshRenderables(const MeshGeometry &geometry, const CoreArguments &args);
+
+    /** Restores renderables that were built before, e.g. by the MeshCache */
+    MeshRenderables(InstanceNumber instanceNumber, VertexBufferEntries table,
+                    const WeldStatistics &weldStatistics,
+                    const VertexCacheOptimization &vertexCacheOptimization);
 
     ~MeshRenderables();
 
     const InstanceNumber instanceNumber;
 
-    const VertexBufferTable &table() const { return m_table; }
+    const VertexBufferEntries &table() const { return m_table; }
+
+    /** Reported by the caller, the renderables can be built on a worker
+     * thread */
+    const WeldStatistics &weldStatistics() const { return m_weldStatistics; }
+
+    /** Empty unless the vertex cache is optimized */
+    const VertexCacheOptimization &vertexCacheOptimization() const {
+        return m_vertexCacheOptimization;
+    }
 
   protected:
     DISALLOW_COPY_MOVE_ASSIGN(MeshRenderables);
-    VertexBufferTable m_table;
+    VertexBufferEntries m_table;
+    WeldStatistics m_weldStatistics;
+    VertexCacheOptimization m_vertexCacheOptimization;
+
+    void optimizeVertexBuffer(VertexBuffer &vertexBuffer,
+                              const CoreArguments &args);
 };
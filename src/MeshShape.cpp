@@ -6,6 +6,35 @@
 #include "IndentableStream.h"
 #include "MeshShape.h"
 #include "MeshSkeleton.h"
+#include "dump.h"
+
+namespace {
+void dump_sparse_vertex_table(
+    IndentableStream &out, const std::string &name,
+    const SparseVertexElementsPerSetIndexTable &table,
+    const ShapeIndex &shapeIndex) {
+    out << quoted(name) << ": {" << endl << indent;
+
+    JsonSeparator sep(",\n");
+
+    for (int semanticIndex = 0; semanticIndex < Semantic::COUNT;
+         ++semanticIndex) {
+        const auto semanticKind = Semantic::from(semanticIndex);
+
+        for (auto &&elements : table.at(semanticKind)) {
+            out << sep;
+            dump_iterable(out,
+                          std::string(Semantic::name(semanticKind)) + "_INDICES",
+                          elements.elementIndices, 16);
+            out << sep;
+            dump_iterable(out, Semantic::name(semanticKind), elements.deltas,
+                          dimension(semanticKind, shapeIndex));
+        }
+    }
+
+    out << endl << undent << "}";
+}
+} // namespace
 
 MeshShape::MeshShape(ShapeIndex shapeIndex) : shapeIndex(shapeIndex) {}
 
@@ -27,6 +56,14 @@ MeshShape::MeshShape(const MeshIndices &mainIndices, const MFnMesh &fnMesh,
 
 MeshShape::~MeshShape() = default;
 
+void MeshShape::releaseVertices(const MeshVertices &mainVertices,
+                                const double tolerance) {
+    assert(shapeIndex.isBlendShapeIndex());
+    m_deltas = sparseTargetDeltas(mainVertices.table(), m_vertices->table(),
+                                  shapeIndex, tolerance);
+    m_vertices.reset();
+}
+
 size_t MeshShape::instanceNumber() const {
     MStatus status;
     const auto instanceNumber = m_dagPath.instanceNumber(&status);
@@ -39,7 +76,11 @@ void MeshShape::dump(IndentableStream &out, const std::string &name) const {
 
     m_semantics->dump(out, "semantics");
     out << "," << endl;
-    m_vertices->dump(out, "vertices");
+    if (m_vertices) {
+        m_vertices->dump(out, "vertices");
+    } else {
+        dump_sparse_vertex_table(out, "deltas", m_deltas, shapeIndex);
+    }
 
     out << endl << undent << '}' << endl;
 }
@@ -27,6 +27,15 @@ class MeshShape {
     const MeshSemantics &semantics() const { return *m_semantics; }
     const MeshVertices &vertices() const { return *m_vertices; }
 
+    /** The sparse deltas of a blend-shape target, after releaseVertices */
+    const SparseVertexElementsPerSetIndexTable &deltas() const {
+        return m_deltas;
+    }
+
+    /** Replaces the vertices of a blend-shape target by the elements that
+     * differ more than tolerance from the main shape */
+    void releaseVertices(const MeshVertices &mainVertices, double tolerance);
+
     size_t instanceNumber() const;
 
   protected:
@@ -36,6 +45,7 @@ class MeshShape {
 
     std::unique_ptr<MeshSemantics> m_semantics;
     std::unique_ptr<MeshVertices> m_vertices;
+    SparseVertexElementsPerSetIndexTable m_deltas;
 
     DISALLOW_COPY_MOVE_ASSIGN(MeshShape);
 };
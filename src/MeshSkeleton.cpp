@@ -6,6 +6,7 @@
 #include "IndentableStream.h"
 #include "MayaException.h"
 #include "MeshSkeleton.h"
+#include "Profiler.h"
 #include "spans.h"
 
 struct VertexJointAssignmentSlice {
@@ -29,6 +30,8 @@ void scaleTranslation(MMatrix &m, double s) {
 MeshSkeleton::MeshSkeleton(ExportableScene &scene, const ExportableNode &node,
                            const MFnMesh &mesh)
     : m_maxVertexJointAssignmentCount(0) {
+    PROFILE_SCOPE("mesh.skin");
+
     MStatus status;
 
     auto &args = scene.arguments();
@@ -107,6 +110,10 @@ MeshSkeleton::MeshSkeleton(ExportableScene &scene, const ExportableNode &node,
         std::vector<VertexJointAssignment> assignments;
         assignments.reserve(jointCount);
 
+        const auto maxInfluences = size_t(std::max(0, args.maxJointInfluences));
+        size_t cappedVertexCount = 0;
+        float maxWeightError = 0;
+
         for (; !iterGeom.isDone(); iterGeom.next()) {
             const auto pointIndex = iterGeom.index(&status);
             THROW_ON_FAILURE(status);
@@ -128,12 +135,14 @@ MeshSkeleton::MeshSkeleton(ExportableScene &scene, const ExportableNode &node,
                 }
             }
 
-            // Sort weights from large to small.
-            // TODO: Use insertion sort when adding the weights?
-            std::sort(assignments.begin(), assignments.end(),
-                      [](auto &left, auto &right) {
-                          return left.jointWeight > right.jointWeight;
-                      });
+            // Sort weights from large to small, keeping the heaviest ones.
+            if (maxInfluences > 0 && assignments.size() > maxInfluences) {
+                ++cappedVertexCount;
+            }
+
+            maxWeightError = std::max(
+                maxWeightError,
+                selectJointAssignments(assignments, maxInfluences));
 
             const auto assignmentsLength = assignments.size();
             const auto assignmentsOffset =
@@ -153,6 +162,12 @@ MeshSkeleton::MeshSkeleton(ExportableScene &scene, const ExportableNode &node,
                   << m_maxVertexJointAssignmentCount << " weights per vertex"
                   << endl;
 
+        if (cappedVertexCount > 0) {
+            std::cout << prefix << "Dropped the lightest weights of "
+                      << cappedVertexCount << " vertices, max weight error "
+                      << std::setprecision(4) << maxWeightError << endl;
+        }
+
         // The vector now contains all the assignments, and cannot be relocated
         // anymore; lets construct the table of spans
         m_vertexJointAssignmentsTable.resize(numPoints);
@@ -3,6 +3,7 @@
 #include "MeshSemantics.h"
 #include "dump.h"
 #include "macros.h"
+#include "SkinEncoding.h"
 #include "sceneTypes.h"
 #include <ostream>
 
@@ -11,27 +12,6 @@ class MeshIndices;
 class ExportableScene;
 class ExportableNode;
 
-class VertexJointAssignment {
-  public:
-    int jointIndex;
-    float jointWeight;
-
-    VertexJointAssignment(const int jointIndex, const float jointWeight)
-        : jointIndex(jointIndex), jointWeight(jointWeight) {}
-
-    friend std::ostream &operator<<(std::ostream &os,
-                                    const VertexJointAssignment &obj) {
-        return os << "[" << obj.jointIndex << ", " << std::setprecision(3)
-                  << obj.jointWeight << "]";
-    }
-
-    DEFAULT_COPY_MOVE_ASSIGN_CTOR_DTOR(VertexJointAssignment);
-};
-
-// Per vertex, the joint assignments
-typedef std::vector<gsl::span<const VertexJointAssignment>>
-    VertexJointAssignmentTable;
-
 struct MeshJoint {
     ExportableNode *node;
     MMatrix inverseBindMatrix;
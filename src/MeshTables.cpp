@@ -0,0 +1,75 @@
+#include "coreExternals.h"
+
+#include "MeshTables.h"
+
+SparseVertexElementsPerSetIndexTable
+sparseTargetDeltas(const VertexElementsPerSetIndexTable &mainVertices,
+                   const VertexElementsPerSetIndexTable &targetVertices,
+                   const ShapeIndex &targetShapeIndex, const double tolerance) {
+    SparseVertexElementsPerSetIndexTable table;
+
+    for (auto semanticIndex = 0; semanticIndex < Semantic::COUNT;
+         ++semanticIndex) {
+        const auto semantic = Semantic::from(semanticIndex);
+        const auto &mainElementsPerSet = mainVertices.at(semantic);
+        const auto &targetElementsPerSet = targetVertices.at(semantic);
+
+        if (Component::type(semantic) != Component::FLOAT)
+            continue;
+
+        // The annoying fact that TANGENTs have dimension 4 in the main shape
+        // and 3 in the targets requires this hacky code.
+        const size_t mainDimension =
+            dimension(semantic, ShapeIndex::main());
+        const size_t targetDimension = dimension(semantic, targetShapeIndex);
+        const auto sharedDimension = std::min(mainDimension, targetDimension);
+
+        const auto setCount =
+            std::min(mainElementsPerSet.size(), targetElementsPerSet.size());
+
+        auto &sparseElementsPerSet = table.at(semantic);
+        sparseElementsPerSet.resize(setCount);
+
+        for (size_t setIndex = 0; setIndex < setCount; ++setIndex) {
+            const auto mainComponents =
+                mainElementsPerSet.at(setIndex).floats();
+            const auto targetComponents =
+                targetElementsPerSet.at(setIndex).floats();
+            const auto elementCount =
+                std::min(size_t(mainComponents.size()) / mainDimension,
+                         size_t(targetComponents.size()) / targetDimension);
+
+            auto &sparseElements = sparseElementsPerSet.at(setIndex);
+
+            float delta[4];
+
+            for (size_t elementIndex = 0; elementIndex < elementCount;
+                 ++elementIndex) {
+                bool isMoved = false;
+
+                for (size_t axis = 0; axis < targetDimension; ++axis) {
+                    delta[axis] =
+                        targetComponents[elementIndex * targetDimension + axis];
+                    if (axis < sharedDimension) {
+                        delta[axis] -=
+                            mainComponents[elementIndex * mainDimension + axis];
+                    }
+                    isMoved |= std::abs(delta[axis]) > tolerance;
+                }
+
+                if (isMoved) {
+                    sparseElements.elementIndices.push_back(
+                        static_cast<Index>(elementIndex));
+                    sparseElements.deltas.insert(sparseElements.deltas.end(),
+                                                 delta,
+                                                 delta + targetDimension);
+                }
+            }
+
+            sparseElements.elementIndices.shrink_to_fit();
+            sparseElements.deltas.shrink_to_fit();
+        }
+    }
+
+    return table;
+}
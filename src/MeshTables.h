@@ -0,0 +1,142 @@
+#pragma once
+
+#include "macros.h"
+#include "sceneTypes.h"
+#include "spans.h"
+
+/**
+ * The Maya-free tables that describe a mesh shape: per semantic and set,
+ * the per-corner element indices, and the element components.
+ * These are filled by MeshIndices and MeshVertices from the Maya mesh,
+ * but can also be built directly (e.g. for synthetic test scenes).
+ */
+
+// NOTE: Some elements might have no indices for some semantics (UVs, color,
+// tangent). In this case, NoIndex (-1) is used.
+//
+// When splitting a mesh into renderable parts,
+// we determine what semantics are actually used
+const Index NoIndex = -1;
+
+typedef std::vector<IndexVector> VertexElementIndicesPerSetIndex;
+typedef std::array<VertexElementIndicesPerSetIndex, Semantic::COUNT>
+    VertexElementIndicesPerSetIndexTable;
+
+class VertexComponents {
+  public:
+    Component::Type type;
+
+    const gsl::span<const byte> &bytes() const { return m_data; }
+    gsl::span<const float> floats() const {
+        return reinterpret_span<float>(m_data);
+    }
+    gsl::span<const ushort> shorts() const {
+        return reinterpret_span<ushort>(m_data);
+    }
+
+    explicit VertexComponents(const gsl::span<const float> &fs)
+        : type(Component::FLOAT), m_data(reinterpret_span<byte>(fs)) {}
+
+    explicit VertexComponents(const gsl::span<const ushort> &ns)
+        : type(Component::USHORT), m_data(reinterpret_span<byte>(ns)) {}
+
+    VertexComponents subspan(const size_t offset, const size_t count) const {
+        switch (type) {
+        case Component::FLOAT:
+            return VertexComponents(floats().subspan(offset, count));
+        case Component::USHORT:
+            return VertexComponents(shorts().subspan(offset, count));
+        default:
+            throw std::runtime_error("Invalid component type");
+        }
+    }
+
+    friend bool operator==(const VertexComponents &lhs,
+                           const VertexComponents &rhs) {
+        return lhs.type == rhs.type && lhs.m_data == rhs.m_data;
+    }
+
+    friend bool operator!=(const VertexComponents &lhs,
+                           const VertexComponents &rhs) {
+        return !(lhs == rhs);
+    }
+
+    bool empty() const { return m_data.empty(); }
+
+    DEFAULT_COPY_MOVE_ASSIGN_DTOR(VertexComponents);
+
+  private:
+    gsl::span<const byte> m_data;
+};
+
+template <typename T> inline VertexComponents floats(gsl::span<T> span) {
+    return VertexComponents(reinterpret_span<float>(span));
+}
+
+template <typename T> inline VertexComponents shorts(gsl::span<T> span) {
+    return VertexComponents(reinterpret_span<ushort>(span));
+}
+
+typedef std::vector<VertexComponents> VertexElementsPerSetIndex;
+
+typedef std::array<VertexElementsPerSetIndex, Semantic::COUNT>
+    VertexElementsPerSetIndexTable;
+
+inline VertexComponents componentsAt(const VertexComponents &elements,
+                                     const size_t vertexIndex,
+                                     const Semantic::Kind semantic,
+                                     const ShapeIndex &shapeIndex) {
+    const auto count = dimension(semantic, shapeIndex);
+    return elements.subspan(vertexIndex * count, count);
+}
+
+/**
+ * The elements of a blend-shape target that differ from the main shape,
+ * stored as deltas, so a target only costs memory for its moved elements.
+ * The element indices are sorted, the deltas have the dimension of the
+ * target.
+ */
+struct SparseVertexElements {
+    IndexVector elementIndices;
+    FloatVector deltas;
+
+    size_t size() const { return elementIndices.size(); }
+};
+
+typedef std::vector<SparseVertexElements> SparseVertexElementsPerSetIndex;
+
+typedef std::array<SparseVertexElementsPerSetIndex, Semantic::COUNT>
+    SparseVertexElementsPerSetIndexTable;
+
+/**
+ * Subtracts the main shape from the float elements of a blend-shape target,
+ * keeping only the elements with a delta component larger than tolerance.
+ */
+SparseVertexElementsPerSetIndexTable
+sparseTargetDeltas(const VertexElementsPerSetIndexTable &mainVertices,
+                   const VertexElementsPerSetIndexTable &targetVertices,
+                   const ShapeIndex &targetShapeIndex, double tolerance);
+
+/**
+ * Everything MeshRenderables needs to build the vertex buffers of one mesh
+ * instance, without referring to Maya: the per-corner indices of the main
+ * shape, the shader of each primitive, the vertex table of the main shape,
+ * and the sparse deltas of the blend-shape targets, which share the indices
+ * of the main shape.
+ * The tables are not owned, they must outlive the renderables.
+ */
+struct MeshGeometry {
+    std::string name;
+    InstanceNumber instanceNumber = 0;
+    int perPrimitiveVertexCount = 3;
+    int primitiveCount = 0;
+
+    const VertexElementIndicesPerSetIndexTable *indices = nullptr;
+    const IndexVector *primitiveToShaderIndexMap = nullptr;
+    const VertexElementsPerSetIndexTable *mainVertices = nullptr;
+    std::vector<const SparseVertexElementsPerSetIndexTable *> targetDeltas;
+
+    size_t maxVertexCount() const {
+        return perPrimitiveVertexCount * primitiveCount;
+    }
+};
@@ -8,162 +8,16 @@
 #include "MeshIndices.h"
 #include "MeshSkeleton.h"
 #include "MeshVertices.h"
+#include "MikkTSpaceContext.h"
+#include "Profiler.h"
 #include "dump.h"
-#include "mikktspace.h"
 #include "spans.h"
 
-struct MikkTSpaceIndices {
-    gsl::span<const Index> positions;
-    gsl::span<const Index> normals;
-    gsl::span<const Index> texcoords;
-    gsl::span<Index> tangents;
-
-    MikkTSpaceIndices(const MeshIndices &meshIndices, const int setIndex) {
-        positions = gsl::make_span(meshIndices.indicesAt(Semantic::POSITION, 0));
-        normals = gsl::make_span(meshIndices.indicesAt(Semantic::NORMAL, 0));
-        texcoords = gsl::make_span(meshIndices.indicesAt(Semantic::TEXCOORD, setIndex));
-        tangents = mutable_span(gsl::make_span(meshIndices.indicesAt(Semantic::TANGENT, setIndex)));
-    }
-};
-
-struct MikkTSpaceVectors {
-    gsl::span<const Position> positions;
-    gsl::span<const Normal> normals;
-    gsl::span<const TexCoord> texcoords;
-    gsl::span<float> tangentComponents;
-
-    MikkTSpaceVectors(const MeshIndices &meshIndices, VertexElementsPerSetIndexTable &vertexTable, const int setIndex) {
-        const auto numTangents = meshIndices.maxVertexCount();
-
-        // HACK: We assume the indices arrays are large enough here...
-        assert(meshIndices.indicesAt(Semantic::TANGENT, setIndex).size() >= numTangents);
-
-        positions = reinterpret_span<Position>(vertexTable.at(Semantic::POSITION).at(0).floats());
-        normals = reinterpret_span<Normal>(vertexTable.at(Semantic::NORMAL).at(0).floats());
-        texcoords = reinterpret_span<TexCoord>(vertexTable.at(Semantic::TEXCOORD).at(setIndex).floats());
-        tangentComponents = mutable_span<float>(vertexTable.at(Semantic::TANGENT).at(setIndex).floats());
-    }
-};
-
-struct MikkTSpaceContext : SMikkTSpaceContext {
-    const size_t triangleCount;
-    const ShapeIndex shapeIndex;
-    MikkTSpaceIndices indices;
-    MikkTSpaceVectors vectors;
-    SMikkTSpaceInterface interface;
-
-    // TODO: It seems MikkTSpace can generate zero tangents for some degenerate
-    // triangles, although it does contain code to deal with these. NOTE:
-    // Cleaning up the mesh with Maya seems to fix this.
-    mutable std::unordered_set<int> invalidTriangleIndices;
-
-    MikkTSpaceContext(const MeshIndices &meshIndices, VertexElementsPerSetIndexTable &vertexTable, const int setIndex,
-                      const ShapeIndex &shapeIndex)
-        : SMikkTSpaceContext{}, triangleCount(meshIndices.primitiveCount()), shapeIndex(shapeIndex),
-          indices(meshIndices, setIndex), vectors(meshIndices, vertexTable, setIndex), interface{} {
-        m_pInterface = &interface;
-        m_pUserData = this;
-
-        interface.m_getNumFaces = getNumFaces;
-        interface.m_getNumVerticesOfFace = getNumVerticesOfFace;
-        interface.m_getPosition = getPosition;
-        interface.m_getNormal = getNormal;
-        interface.m_getTexCoord = getTexCoord;
-        interface.m_setTSpaceBasic = setTSpaceBasic;
-        interface.m_reportDegenerateTriangle = reportDegenerateTriangle;
-    }
-
-    void computeTangents(const double angularThreshold) const {
-        const auto mkr = genTangSpace(this, static_cast<float>(angularThreshold));
-
-        if (!mkr) {
-            MayaException::printError("Failed to get Mikkelsen tangents (aka MikkTSpace)");
-        }
-    }
-
-    static int getNumFaces(const SMikkTSpaceContext *pContext) {
-        const auto count = reinterpret_cast<const MikkTSpaceContext *>(pContext)->triangleCount;
-        return static_cast<int>(count);
-    }
-
-    static int getNumVerticesOfFace(const SMikkTSpaceContext *pContext, const int iFace) { return 3; }
-
-    static void getPosition(const SMikkTSpaceContext *pContext, float fvPosOut[], const int iFace, const int iVert) {
-        const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
-        const auto index = context->indices.positions[iFace * 3 + iVert];
-        const auto &vector = context->vectors.positions[index];
-        fvPosOut[0] = vector[0];
-        fvPosOut[1] = vector[1];
-        fvPosOut[2] = vector[2];
-    }
-
-    static void getNormal(const SMikkTSpaceContext *pContext, float fvNormOut[], const int iFace, const int iVert) {
-        const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
-        const auto index = context->indices.normals[iFace * 3 + iVert];
-        const auto &vector = context->vectors.normals[index];
-        fvNormOut[0] = vector[0];
-        fvNormOut[1] = vector[1];
-        fvNormOut[2] = vector[2];
-    }
-
-    static void getTexCoord(const SMikkTSpaceContext *pContext, float fvTexcOut[], const int iFace, const int iVert) {
-        const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
-        const auto index = context->indices.texcoords[iFace * 3 + iVert];
-
-        if (index < 0) {
-            fvTexcOut[0] = NAN;
-            fvTexcOut[1] = NAN;
-        } else {
-            const auto &vector = context->vectors.texcoords[index];
-            fvTexcOut[0] = vector[0];
-            fvTexcOut[1] = 1 - vector[1];
-        }
-    }
-
-    static void setTSpaceBasic(const SMikkTSpaceContext *pContext, const float fvTangent[], const float fSign,
-                               const int iFace, const int iVert) {
-        const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
-
-        // Re-index
-        const auto index = iFace * 3 + iVert;
-        auto &tangentIndexRef = context->indices.tangents[index];
-
-        // If the vertex doesn't have a tangent, don't assign one
-        if (tangentIndexRef >= 0) {
-            tangentIndexRef = index;
-
-            const float tx = fvTangent[0];
-            const float ty = fvTangent[1];
-            const float tz = fvTangent[2];
-
-            if (tx == 0 && ty == 0 && tz == 0) {
-                context->invalidTriangleIndices.insert(iFace);
-            }
-
-            if (context->shapeIndex.isMainShapeIndex()) {
-                float *p = &context->vectors.tangentComponents[index * array_size<MainShapeTangent>::size];
-                p[0] = tx;
-                p[1] = ty;
-                p[2] = tz;
-                p[3] = fSign;
-            } else {
-                float *p = &context->vectors.tangentComponents[index * array_size<BlendShapeTangent>::size];
-                p[0] = tx;
-                p[1] = ty;
-                p[2] = tz;
-            }
-        }
-    }
-
-    static void reportDegenerateTriangle(const SMikkTSpaceContext *pContext, int triangleIndex) {
-        const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
-        context->invalidTriangleIndices.insert(triangleIndex);
-    }
-};
-
 MeshVertices::MeshVertices(const MeshIndices &meshIndices, const MeshSkeleton *meshSkeleton, const MFnMesh &mesh,
                            ShapeIndex shapeIndex, const ExportableNode &node, const Arguments &args)
     : shapeIndex(shapeIndex) {
+    PROFILE_SCOPE("mesh.vertices");
+
     MStatus status;
 
     auto &semantics = meshIndices.semantics;
@@ -262,28 +116,29 @@ MeshVertices::MeshVertices(const MeshIndices &meshIndices, const MeshSkeleton *m
             const auto tangentSpan = floats(span(tangentSet));
             m_table.at(Semantic::TANGENT).push_back(tangentSpan);
 
-            MikkTSpaceContext context(meshIndices, m_table, semantic.setIndex, shapeIndex);
-            context.computeTangents(args.mikkelsenTangentAngularThreshold);
+            const auto setIndex = semantic.setIndex;
 
-            if (!context.invalidTriangleIndices.empty()) {
-                // Don't flood the console output if too many faces are invalid.
-                int maxIndices = 10;
+            // HACK: We assume the indices arrays are large enough here...
+            assert(meshIndices.indicesAt(Semantic::TANGENT, setIndex).size() >= meshIndices.maxVertexCount());
 
-                std::stringstream ss;
-                ss << "select -r";
-                for (auto triangleIndex : context.invalidTriangleIndices) {
-                    ss << ' ' << mesh.name() << ".f[" << meshIndices.triangleToFaceIndex(triangleIndex) << "]";
-                    if (--maxIndices < 0)
-                        break;
-                }
-                ss << ";";
+            const auto tangentIndices = gsl::make_span(meshIndices.indicesAt(Semantic::TANGENT, setIndex));
+            MikkTSpaceContext::reindexTangents(mutable_span(tangentIndices));
 
-                MayaException::printError(formatted("Tangent generator found degenerate faces!\nThis can cause "
-                                                    "rendering artifacts.\nPlease check and fix your mesh and "
-                                                    "UV mapping.\nUse the following command select the first "
-                                                    "invalid faces:\n%s\n\n",
-                                                    ss.str().c_str()));
-            }
+            const MikkTSpaceIndices indices{gsl::make_span(meshIndices.indicesAt(Semantic::POSITION, 0)),
+                                            gsl::make_span(meshIndices.indicesAt(Semantic::NORMAL, 0)),
+                                            gsl::make_span(meshIndices.indicesAt(Semantic::TEXCOORD, setIndex)),
+                                            tangentIndices};
+
+            const MikkTSpaceVectors vectors{
+                reinterpret_span<Position>(m_table.at(Semantic::POSITION).at(0).floats()),
+                reinterpret_span<Normal>(m_table.at(Semantic::NORMAL).at(0).floats()),
+                reinterpret_span<TexCoord>(m_table.at(Semantic::TEXCOORD).at(setIndex).floats()),
+                mutable_span<float>(m_table.at(Semantic::TANGENT).at(setIndex).floats())};
+
+            // The tangents are computed by the mesh, concurrently for all shapes and sets.
+            m_mikkTSpaceContexts.emplace_back(
+                std::make_unique<MikkTSpaceContext>(numTriangles, indices, vectors, shapeIndex, setIndex));
+            m_meshName = mesh.name().asChar();
         } else {
             MFloatVectorArray mTangents;
 
@@ -375,68 +230,49 @@ MeshVertices::MeshVertices(const MeshIndices &meshIndices, const MeshSkeleton *m
     if (meshSkeleton) {
         // Now group vertex joint assignments into element of multiple
         // components (4 in GLTF)
-        const auto vertexJointAssignmentElementSize = int(array_size<JointIndices>::size);
-
-        const auto setCount = int(meshSkeleton->vertexJointAssignmentSetCount());
-        const auto &assignmentsTable = meshSkeleton->vertexJointAssignments();
-
-        m_jointWeightSums.resize(numPoints);
+        auto sets = JointWeightSets::fromAssignments(meshSkeleton->vertexJointAssignments(),
+                                                     meshSkeleton->vertexJointAssignmentSetCount());
 
-        for (int setIndex = 0; setIndex < setCount; ++setIndex) {
-            auto &weightsComponents = m_jointWeights[setIndex];
-            auto &indicesComponents = m_jointIndices[setIndex];
-            weightsComponents.resize(numPoints);
-            indicesComponents.resize(numPoints);
+        for (size_t setIndex = 0; setIndex < sets.weights.size(); ++setIndex) {
+            auto &weightsComponents = m_jointWeights[int(setIndex)] = std::move(sets.weights[setIndex]);
+            auto &indicesComponents = m_jointIndices[int(setIndex)] = std::move(sets.joints[setIndex]);
 
-            auto weightsSpan = span(weightsComponents);
-            auto indicesSpan = span(indicesComponents);
-
-            m_table.at(Semantic::WEIGHTS).push_back(floats(weightsSpan));
-            m_table.at(Semantic::JOINTS).push_back(shorts(indicesSpan));
-
-            const auto componentOffset = int(setIndex * vertexJointAssignmentElementSize);
+            m_table.at(Semantic::WEIGHTS).push_back(floats(span(weightsComponents)));
+            m_table.at(Semantic::JOINTS).push_back(shorts(span(indicesComponents)));
+        }
+    }
+}
 
-            for (int pointIndex = 0; pointIndex < numPoints; ++pointIndex) {
-                const auto &assignments = assignmentsTable.at(pointIndex);
-                const auto assignmentsSize = int(assignments.size());
+MeshVertices::~MeshVertices() = default;
 
-                const auto assignmentCount =
-                    std::clamp<int>(assignmentsSize - componentOffset, 0, vertexJointAssignmentElementSize);
-                const auto assignmentIndex = std::clamp<int>(componentOffset, 0, assignmentsSize - assignmentCount);
-                const auto sourceComponents = assignments.subspan(assignmentIndex, assignmentCount);
+void MeshVertices::reportTangentErrors(const MeshIndices &meshIndices) const {
+    for (auto &context : m_mikkTSpaceContexts) {
+        if (!context->succeeded) {
+            MayaException::printError("Failed to get Mikkelsen tangents (aka MikkTSpace)");
+        }
 
-                const auto targetWeights =
-                    mutable_span(reinterpret_span<JointWeight>(weightsSpan.subspan(pointIndex, 1)));
-                const auto targetIndices =
-                    mutable_span(reinterpret_span<JointIndex>(indicesSpan.subspan(pointIndex, 1)));
+        if (!context->invalidTriangleIndices.empty()) {
+            // Don't flood the console output if too many faces are invalid.
+            int maxIndices = 10;
 
-                for (auto componentIndex = 0; componentIndex < assignmentCount; ++componentIndex) {
-                    const auto &components = sourceComponents.at(componentIndex);
-                    targetIndices[componentIndex] = components.jointIndex;
-                    targetWeights[componentIndex] = components.jointWeight;
-                    m_jointWeightSums[pointIndex] += components.jointWeight;
-                }
+            std::stringstream ss;
+            ss << "select -r";
+            for (auto triangleIndex : context->invalidTriangleIndices) {
+                ss << ' ' << m_meshName << ".f[" << meshIndices.triangleToFaceIndex(triangleIndex) << "]";
+                if (--maxIndices < 0)
+                    break;
             }
-        }
+            ss << ";";
 
-        // Normalize
-        for (int setIndex = 0; setIndex < setCount; ++setIndex) {
-            auto &weightsComponents = m_jointWeights[setIndex];
-            auto weightsSpan = span(weightsComponents);
-            for (int pointIndex = 0; pointIndex < numPoints; ++pointIndex) {
-                const auto targetWeights =
-                    mutable_span(reinterpret_span<JointWeight>(weightsSpan.subspan(pointIndex, 1)));
-                float normalize = 1 / m_jointWeightSums[pointIndex];
-                for (auto &weight : targetWeights) {
-                    weight *= normalize;
-                }
-            }
+            MayaException::printError(formatted("Tangent generator found degenerate faces!\nThis can cause "
+                                                "rendering artifacts.\nPlease check and fix your mesh and "
+                                                "UV mapping.\nUse the following command select the first "
+                                                "invalid faces:\n%s\n\n",
+                                                ss.str().c_str()));
         }
     }
 }
 
-MeshVertices::~MeshVertices() = default;
-
 void MeshVertices::dump(IndentableStream &out, const std::string &name) const {
     dump_vertex_table(out, name, m_table, shapeIndex);
 }
@@ -0,0 +1,132 @@
+#include "coreExternals.h"
+
+#include "MikkTSpaceContext.h"
+#include "Profiler.h"
+
+MikkTSpaceContext::MikkTSpaceContext(const size_t triangleCount, const MikkTSpaceIndices &indices,
+                                     const MikkTSpaceVectors &vectors, const ShapeIndex &shapeIndex,
+                                     const SetIndex setIndex)
+    : SMikkTSpaceContext{}, triangleCount(triangleCount), shapeIndex(shapeIndex), setIndex(setIndex),
+      indices(indices), vectors(vectors), interface{} {
+    m_pInterface = &interface;
+    m_pUserData = this;
+
+    interface.m_getNumFaces = getNumFaces;
+    interface.m_getNumVerticesOfFace = getNumVerticesOfFace;
+    interface.m_getPosition = getPosition;
+    interface.m_getNormal = getNormal;
+    interface.m_getTexCoord = getTexCoord;
+    interface.m_setTSpaceBasic = setTSpaceBasic;
+    interface.m_reportDegenerateTriangle = reportDegenerateTriangle;
+}
+
+void MikkTSpaceContext::computeTangents(const double angularThreshold) {
+    PROFILE_SCOPE("mesh.tangents");
+
+    invalidTriangleIndices.clear();
+    succeeded = genTangSpace(this, static_cast<float>(angularThreshold)) != 0;
+}
+
+void MikkTSpaceContext::reindexTangents(const gsl::span<Index> tangentIndices) {
+    for (Index index = 0; index < tangentIndices.size(); ++index) {
+        auto &tangentIndexRef = tangentIndices[index];
+
+        // If the vertex doesn't have a tangent, don't assign one
+        if (tangentIndexRef >= 0) {
+            tangentIndexRef = index;
+        }
+    }
+}
+
+int MikkTSpaceContext::getNumFaces(const SMikkTSpaceContext *pContext) {
+    const auto count = reinterpret_cast<const MikkTSpaceContext *>(pContext)->triangleCount;
+    return static_cast<int>(count);
+}
+
+int MikkTSpaceContext::getNumVerticesOfFace(const SMikkTSpaceContext *pContext, const int iFace) { return 3; }
+
+void MikkTSpaceContext::getPosition(const SMikkTSpaceContext *pContext, float fvPosOut[], const int iFace,
+                                    const int iVert) {
+    const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
+    const auto index = context->indices.positions[iFace * 3 + iVert];
+    const auto &vector = context->vectors.positions[index];
+    fvPosOut[0] = vector[0];
+    fvPosOut[1] = vector[1];
+    fvPosOut[2] = vector[2];
+}
+
+void MikkTSpaceContext::getNormal(const SMikkTSpaceContext *pContext, float fvNormOut[], const int iFace,
+                                  const int iVert) {
+    const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
+    const auto index = context->indices.normals[iFace * 3 + iVert];
+    const auto &vector = context->vectors.normals[index];
+    fvNormOut[0] = vector[0];
+    fvNormOut[1] = vector[1];
+    fvNormOut[2] = vector[2];
+}
+
+void MikkTSpaceContext::getTexCoord(const SMikkTSpaceContext *pContext, float fvTexcOut[], const int iFace,
+                                    const int iVert) {
+    const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
+    const auto index = context->indices.texcoords[iFace * 3 + iVert];
+
+    if (index < 0) {
+        fvTexcOut[0] = NAN;
+        fvTexcOut[1] = NAN;
+    } else {
+        const auto &vector = context->vectors.texcoords[index];
+        fvTexcOut[0] = vector[0];
+        fvTexcOut[1] = 1 - vector[1];
+    }
+}
+
+void MikkTSpaceContext::setTSpaceBasic(const SMikkTSpaceContext *pContext, const float fvTangent[],
+                                       const float fSign, const int iFace, const int iVert) {
+    const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
+
+    // The tangent indices were re-indexed up-front, see reindexTangents
+    const auto index = iFace * 3 + iVert;
+
+    // If the vertex doesn't have a tangent, don't assign one
+    if (context->indices.tangents[index] >= 0) {
+        const float tx = fvTangent[0];
+        const float ty = fvTangent[1];
+        const float tz = fvTangent[2];
+
+        if (tx == 0 && ty == 0 && tz == 0) {
+            context->invalidTriangleIndices.insert(iFace);
+        }
+
+        if (context->shapeIndex.isMainShapeIndex()) {
+            float *p = &context->vectors.tangentComponents[index * array_size<MainShapeTangent>::size];
+            p[0] = tx;
+            p[1] = ty;
+            p[2] = tz;
+            p[3] = fSign;
+        } else {
+            float *p = &context->vectors.tangentComponents[index * array_size<BlendShapeTangent>::size];
+            p[0] = tx;
+            p[1] = ty;
+            p[2] = tz;
+        }
+    }
+}
+
+void MikkTSpaceContext::reportDegenerateTriangle(const SMikkTSpaceContext *pContext, const int triangleIndex) {
+    const auto context = reinterpret_cast<const MikkTSpaceContext *>(pContext);
+    context->invalidTriangleIndices.insert(triangleIndex);
+}
+
+void computeTangents(ThreadPool &pool, const std::vector<MikkTSpaceContext *> &contexts,
+                     const double angularThreshold) {
+    std::vector<std::future<void>> pending;
+    pending.reserve(contexts.size());
+
+    for (auto *context : contexts) {
+        pending.emplace_back(pool.submit([context, angularThreshold]() { context->computeTangents(angularThreshold); }));
+    }
+
+    for (auto &future : pending) {
+        future.get();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "mikktspace.h"
+#include "sceneTypes.h"
+
+/** The per face-vertex indices of a triangle mesh, for one tangent set */
+struct MikkTSpaceIndices {
+    gsl::span<const Index> positions;
+    gsl::span<const Index> normals;
+    gsl::span<const Index> texcoords;
+
+    // A face-vertex only gets a tangent if its index is not negative
+    gsl::span<const Index> tangents;
+};
+
+/** The vectors of one shape the indices refer to, and the tangents to generate */
+struct MikkTSpaceVectors {
+    gsl::span<const Position> positions;
+    gsl::span<const Normal> normals;
+    gsl::span<const TexCoord> texcoords;
+    gsl::span<float> tangentComponents;
+};
+
+/**
+ * Generates the Mikkelsen tangents of one tangent set of one shape.
+ * Contexts only read the shared indices and write their own tangent
+ * components, so the contexts of different shapes and sets can run
+ * concurrently.
+ */
+struct MikkTSpaceContext : SMikkTSpaceContext {
+    const size_t triangleCount;
+    const ShapeIndex shapeIndex;
+    const SetIndex setIndex;
+    const MikkTSpaceIndices indices;
+    const MikkTSpaceVectors vectors;
+    SMikkTSpaceInterface interface;
+
+    // TODO: It seems MikkTSpace can generate zero tangents for some degenerate
+    // triangles, although it does contain code to deal with these. NOTE:
+    // Cleaning up the mesh with Maya seems to fix this.
+    // Ordered, so these are reported in the same order as a serial export.
+    mutable std::set<int> invalidTriangleIndices;
+
+    bool succeeded = false;
+
+    MikkTSpaceContext(size_t triangleCount, const MikkTSpaceIndices &indices, const MikkTSpaceVectors &vectors,
+                      const ShapeIndex &shapeIndex, SetIndex setIndex);
+
+    DISALLOW_COPY_MOVE_ASSIGN(MikkTSpaceContext);
+
+    void computeTangents(double angularThreshold);
+
+    /** MikkTSpace writes the tangent of face-vertex i at index i, so the
+     * tangent indices must be rewritten before the contexts sharing them
+     * run concurrently. */
+    static void reindexTangents(gsl::span<Index> tangentIndices);
+
+  private:
+    static int getNumFaces(const SMikkTSpaceContext *pContext);
+    static int getNumVerticesOfFace(const SMikkTSpaceContext *pContext, int iFace);
+    static void getPosition(const SMikkTSpaceContext *pContext, float fvPosOut[], int iFace, int iVert);
+    static void getNormal(const SMikkTSpaceContext *pContext, float fvNormOut[], int iFace, int iVert);
+    static void getTexCoord(const SMikkTSpaceContext *pContext, float fvTexcOut[], int iFace, int iVert);
+    static void setTSpaceBasic(const SMikkTSpaceContext *pContext, const float fvTangent[], float fSign, int iFace,
+                               int iVert);
+    static void reportDegenerateTriangle(const SMikkTSpaceContext *pContext, int triangleIndex);
+};
+
+typedef std::vector<std::unique_ptr<MikkTSpaceContext>> MikkTSpaceContexts;
+
+/** Computes the tangents of all contexts on the pool, and waits for them */
+void computeTangents(ThreadPool &pool, const std::vector<MikkTSpaceContext *> &contexts, double angularThreshold);
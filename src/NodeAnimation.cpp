@@ -4,9 +4,11 @@
 #include "ExportableNode.h"
 #include "NodeAnimation.h"
 #include "OutputStreamsPatch.h"
+#include "Profiler.h"
 #include "Transform.h"
 
-NodeAnimation::NodeAnimation(const ExportableNode &node, const ExportableFrames &frames, const double scaleFactor, const Arguments &arguments)
+NodeAnimation::NodeAnimation(const ExportableNode &node, const ExportableFrames &frames, SampleStore &samples, const double scaleFactor,
+                             const Arguments &arguments)
     : node(node), mesh(node.mesh()), m_scaleFactor(scaleFactor), m_blendShapeCount(mesh ? mesh->blendShapeCount() : 0), m_arguments(arguments) {
     auto &sNode = node.glSecondaryNode();
     auto &pNode = node.glPrimaryNode();
@@ -17,33 +19,33 @@ NodeAnimation::NodeAnimation(const ExportableNode &node, const ExportableFrames
 
     switch (node.transformKind) {
     case TransformKind::Simple:
-        m_positions = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
-        m_rotations = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
-        m_scales = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+        m_positions = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
+        m_rotations = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
+        m_scales = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
         break;
     case TransformKind::ComplexJoint:
-        m_positions = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
-        m_rotations = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
-        m_scales = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+        m_positions = std::make_unique<PropAnimation>(frames, samples, sNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
+        m_rotations = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
+        m_scales = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
 
-        m_correctors = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+        m_correctors = std::make_unique<PropAnimation>(frames, samples, sNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
 
         if (m_arguments.forceAnimationChannels) {
-            m_dummyProps1 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
-            m_dummyProps2 = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
+            m_dummyProps1 = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
+            m_dummyProps2 = std::make_unique<PropAnimation>(frames, samples, sNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
         }
         break;
 
     case TransformKind::ComplexTransform:
-        m_positions = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
-        m_rotations = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
-        m_scales = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+        m_positions = std::make_unique<PropAnimation>(frames, samples, sNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
+        m_rotations = std::make_unique<PropAnimation>(frames, samples, sNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
+        m_scales = std::make_unique<PropAnimation>(frames, samples, sNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
 
-        m_correctors = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
+        m_correctors = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
 
         if (m_arguments.forceAnimationChannels) {
-            m_dummyProps1 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
-            m_dummyProps2 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
+            m_dummyProps1 = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+            m_dummyProps2 = std::make_unique<PropAnimation>(frames, samples, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
         }
         break;
 
@@ -53,44 +55,37 @@ NodeAnimation::NodeAnimation(const ExportableNode &node, const ExportableFrames
     }
 
     if (m_blendShapeCount > 0) {
-        m_weights = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::WEIGHTS, m_blendShapeCount, detectStepSampleCount, true);
+        // Morph weights must target the node that instantiates the mesh
+        auto &meshNode = mesh->glInstanceNode(pNode);
+        m_weights = std::make_unique<PropAnimation>(frames, samples, meshNode, GLTF::Animation::Path::WEIGHTS, m_blendShapeCount, detectStepSampleCount, true);
     }
 }
 
-void NodeAnimation::sampleAt(const MTime &absoluteTime, const int frameIndex, const int superSampleIndex, NodeTransformCache &transformCache) {
-    auto &transformState = transformCache.getTransform(&node, m_scaleFactor);
-    auto &pTRS = transformState.primaryTRS();
-    auto &sTRS = transformState.secondaryTRS();
+void NodeAnimation::sampleAt(const MTime &absoluteTime, const int frameIndex, const int superSampleIndex, NodeTransformCache &transformCache,
+                             std::vector<AffineMatrix> &sampledMatrices) {
+    PROFILE_SCOPE("node.sample");
 
-    if (transformState.maxNonOrthogonality > MAX_NON_ORTHOGONALITY && m_invalidLocalTransformTimes.size() < m_invalidLocalTransformTimes.capacity()) {
-        m_maxNonOrthogonality = std::max(m_maxNonOrthogonality, transformState.maxNonOrthogonality);
-        m_invalidLocalTransformTimes.emplace_back(absoluteTime);
-    }
+    // Only the values that don't come from the matrix are appended now,
+    // the matrix is decomposed when all samples are taken.
+    auto &sample = transformCache.getSample(&node, m_scaleFactor);
+    auto &pTRS = sample.state.primaryTRS();
+    auto &sTRS = sample.state.secondaryTRS();
+
+    sampledMatrices.emplace_back(sample.matrix);
 
     switch (node.transformKind) {
     case TransformKind::Simple:
-        m_positions->append(gsl::make_span(pTRS.translation), superSampleIndex);
-        m_rotations->appendQuaternion(gsl::make_span(pTRS.rotation), superSampleIndex);
-        m_scales->append(gsl::make_span(pTRS.scale), superSampleIndex);
         break;
     case TransformKind::ComplexJoint:
         m_positions->append(gsl::make_span(sTRS.translation), superSampleIndex);
-        m_rotations->appendQuaternion(gsl::make_span(pTRS.rotation), superSampleIndex);
-        m_scales->append(gsl::make_span(pTRS.scale), superSampleIndex);
-
         m_correctors->append(gsl::make_span(sTRS.scale), superSampleIndex);
 
         if (m_arguments.forceAnimationChannels) {
-            m_dummyProps1->append(gsl::make_span(pTRS.translation), superSampleIndex);
             m_dummyProps2->appendQuaternion(gsl::make_span(sTRS.rotation), superSampleIndex);
         }
         break;
 
     case TransformKind::ComplexTransform:
-        m_positions->append(gsl::make_span(sTRS.translation), superSampleIndex);
-        m_rotations->appendQuaternion(gsl::make_span(sTRS.rotation), superSampleIndex);
-        m_scales->append(gsl::make_span(sTRS.scale), superSampleIndex);
-
         m_correctors->append(gsl::make_span(pTRS.translation), superSampleIndex);
 
         if (m_arguments.forceAnimationChannels) {
@@ -105,13 +100,41 @@ void NodeAnimation::sampleAt(const MTime &absoluteTime, const int frameIndex, co
     }
 
     if (m_blendShapeCount) {
-        auto weights = mesh->currentWeights();
-        assert(weights.size() == m_blendShapeCount);
-        m_weights->append(span(weights), superSampleIndex);
+        mesh->getCurrentWeights(m_weights->appendInPlace(superSampleIndex));
+    }
+}
+
+void NodeAnimation::appendDecomposed(const MTime &absoluteTime, const int superSampleIndex, const DecomposedTRS &trs) {
+    if (trs.nonOrthogonality > MAX_NON_ORTHOGONALITY && m_invalidLocalTransformTimes.size() < m_invalidLocalTransformTimes.capacity()) {
+        m_maxNonOrthogonality = std::max(m_maxNonOrthogonality, trs.nonOrthogonality);
+        m_invalidLocalTransformTimes.emplace_back(absoluteTime);
+    }
+
+    switch (node.transformKind) {
+    case TransformKind::Simple:
+    case TransformKind::ComplexTransform:
+        m_positions->append(gsl::make_span(trs.translation), superSampleIndex);
+        m_rotations->appendQuaternion(gsl::make_span(trs.rotation), superSampleIndex);
+        m_scales->append(gsl::make_span(trs.scale), superSampleIndex);
+        break;
+
+    case TransformKind::ComplexJoint:
+        m_rotations->appendQuaternion(gsl::make_span(trs.rotation), superSampleIndex);
+        m_scales->append(gsl::make_span(trs.scale), superSampleIndex);
+
+        if (m_arguments.forceAnimationChannels) {
+            m_dummyProps1->append(gsl::make_span(trs.translation), superSampleIndex);
+        }
+        break;
+
+    default:
+        assert(false);
+        break;
     }
 }
 
 void NodeAnimation::exportTo(GLTF::Animation &glAnimation) {
+    PROFILE_SCOPE("node.finish");
 
     if (!m_invalidLocalTransformTimes.empty()) {
         // TODO: Use SVG to decompose the 3x3 matrix into a product of rotation
@@ -185,15 +208,8 @@ void NodeAnimation::finish(GLTF::Animation &glAnimation, const char *propName, s
 
         const size_t detectStepSampleCount = m_arguments.getStepDetectSampleCount();
 
-        auto &componentValues = animatedProp->componentValuesPerFrameTable.at(0);
-
         // Check if all samples are constant. In that case, we drop the animation, unless it is forced
-        bool isConstant = true;
-        for (size_t offset = 0; offset < componentValues.size() && isConstant; offset += dimension) {
-            for (size_t axis = 0; axis < dimension && isConstant; ++axis) {
-                isConstant = std::abs(baseValues[axis] - componentValues[offset + axis]) < constantThreshold;
-            }
-        }
+        const bool isConstant = animatedProp->isConstant(baseValues, constantThreshold);
 
         if (isConstant && !m_arguments.forceAnimationSampling && !m_arguments.forceAnimationChannels) {
             // All animation frames are the same as the scene, to need to animate the prop.
@@ -202,28 +218,26 @@ void NodeAnimation::finish(GLTF::Animation &glAnimation, const char *propName, s
             const auto useSingleKey = isConstant && !m_arguments.forceAnimationSampling;
             auto interpolation = "LINEAR";
 
+            std::vector<bool> heldFrames;
+
             if (!useSingleKey && detectStepSampleCount > 1) {
-                // Check if STEP animation can be used for this channel.
-                // TODO: Split into multiple parts!
-                auto canUseStep = true;
-                for (size_t offset = 0; offset < componentValues.size() && canUseStep; offset += dimension) {
-                    const auto* startValues = &componentValues[offset];
-                    for (size_t superSample = 1; superSample < detectStepSampleCount; ++superSample) {
-                        auto &stepComponentValues = animatedProp->componentValuesPerFrameTable.at(superSample);
-                        for (size_t axis = 0; axis < dimension; ++axis) {
-                            canUseStep = std::abs(startValues[axis] - stepComponentValues[offset + axis]) < constantThreshold;
-                        }
-                    }
-                }
+                // Check if STEP animation can be used for this channel, or for some of its frames.
+                heldFrames = animatedProp->heldFrames(constantThreshold);
+
+                const size_t heldFrameCount = std::count(heldFrames.begin(), heldFrames.end(), true);
 
-                if (canUseStep) {
+                if (heldFrameCount == heldFrames.size()) {
                     std::cout << prefix << "Using STEP interpolation for channel " << node.name() << "/" << propName << std::endl;
                     interpolation = "STEP";
+                } else if (heldFrameCount > 0) {
+                    std::cout << prefix << "Using STEP interpolation for " << heldFrameCount << " of " << heldFrames.size() << " frames of channel "
+                              << node.name() << "/" << propName << std::endl;
                 }
             }
 
-            // TODO: Apply a curve simplifier.
-            animatedProp->finish(m_arguments.disableNameAssignment ? "" : node.name() + "/anim/" + glAnimation.name + "/" + propName, useSingleKey, interpolation);
+            const auto keyTolerance = m_arguments.getKeyframeTolerance(animatedProp->glTarget.path);
+            animatedProp->finish(m_arguments.disableNameAssignment ? "" : node.name() + "/anim/" + glAnimation.name + "/" + propName, useSingleKey, interpolation,
+                                 keyTolerance, heldFrames);
             glAnimation.channels.push_back(&animatedProp->glChannel);
         }
     }
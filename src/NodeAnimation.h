@@ -3,6 +3,7 @@
 #include "ExportableNode.h"
 #include "PropAnimation.h"
 #include "Arguments.h"
+#include "TransformDecomposition.h"
 
 class ExportableNode;
 class ExportableMesh;
@@ -10,15 +11,19 @@ class NodeTransformCache;
 
 class NodeAnimation {
   public:
-    NodeAnimation(const ExportableNode &node, const ExportableFrames &frames, double scaleFactor, const Arguments &args);
+    NodeAnimation(const ExportableNode &node, const ExportableFrames &frames, SampleStore &samples, double scaleFactor, const Arguments &args);
 
     /** Consider a blend shape weight animation path as constant if all values are below this threshold */
     double constantWeightsThreshold = 1e-9;
 
     virtual ~NodeAnimation() = default;
 
-    // Samples values at the current time
-    void sampleAt(const MTime &absoluteTime, int relativeFrameIndex, int superSampleIndex, NodeTransformCache &transformCache);
+    // Samples values at the current time, and appends the local matrix to decompose
+    void sampleAt(const MTime &absoluteTime, int relativeFrameIndex, int superSampleIndex, NodeTransformCache &transformCache,
+                  std::vector<AffineMatrix> &sampledMatrices);
+
+    // Appends the decomposition of a sampled matrix, in sampling order
+    void appendDecomposed(const MTime &absoluteTime, int superSampleIndex, const DecomposedTRS &trs);
 
     void exportTo(GLTF::Animation &glAnimation);
 
@@ -0,0 +1,211 @@
+#include "coreExternals.h"
+
+#include "IndentableStream.h"
+#include "Profiler.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+// Beyond this many events, the trace is truncated, but the summary is not.
+const size_t maxTraceEventCount = 1000000;
+
+struct ProfileEvent {
+    const char *name;
+    int threadIndex;
+    int64_t start;
+    int64_t duration;
+    int64_t peakMemoryDelta;
+};
+
+struct StageStatistics {
+    size_t callCount = 0;
+    int64_t totalDuration = 0;
+    int64_t maxDuration = 0;
+    int64_t maxPeakMemoryDelta = -1;
+};
+
+std::mutex eventsMutex;
+std::vector<ProfileEvent> events;
+size_t eventCount = 0;
+int threadCount = 0;
+// Per name pointer, so recording doesn't allocate; merged by name in the summary.
+std::unordered_map<const char *, StageStatistics> stages;
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+// Incremented by each start, so threads get a new index in the next trace.
+int generation = 0;
+
+/** The index of the calling thread in the trace, requires the events mutex */
+int currentThreadIndex() {
+    thread_local int threadIndex = -1;
+    thread_local int threadGeneration = -1;
+
+    if (threadGeneration != generation) {
+        threadIndex = threadCount++;
+        threadGeneration = generation;
+    }
+
+    return threadIndex;
+}
+
+void writeJsonString(std::ostream &out, const char *text) {
+    out << '"';
+    for (auto c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+} // namespace
+
+std::atomic<bool> Profiler::s_isEnabled(false);
+
+void Profiler::start() {
+    std::lock_guard<std::mutex> lock(eventsMutex);
+
+    events.clear();
+    stages.clear();
+    eventCount = 0;
+    threadCount = 0;
+    ++generation;
+    startTime = std::chrono::steady_clock::now();
+
+    // The calling thread is the first one in the trace.
+    currentThreadIndex();
+    s_isEnabled = true;
+}
+
+void Profiler::stop() {
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    s_isEnabled = false;
+}
+
+int64_t Profiler::nowMicroseconds() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime)
+        .count();
+}
+
+void Profiler::record(const char *name, const int64_t startMicroseconds, const int64_t endMicroseconds,
+                      const int64_t peakMemoryDelta) {
+    std::lock_guard<std::mutex> lock(eventsMutex);
+
+    // Drop the scopes that end after the profiler stopped
+    if (!s_isEnabled)
+        return;
+
+    const auto duration = endMicroseconds - startMicroseconds;
+
+    auto &stage = stages[name];
+    ++stage.callCount;
+    stage.totalDuration += duration;
+    stage.maxDuration = std::max(stage.maxDuration, duration);
+    stage.maxPeakMemoryDelta = std::max(stage.maxPeakMemoryDelta, peakMemoryDelta);
+
+    if (++eventCount <= maxTraceEventCount) {
+        events.push_back({name, currentThreadIndex(), startMicroseconds, duration, peakMemoryDelta});
+    }
+}
+
+size_t Profiler::peakMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return size_t(usage.ru_maxrss);
+#else
+    return size_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void Profiler::writeTrace(const std::string &path) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open())
+        throw std::runtime_error("Couldn't write to '" + path + "'");
+
+    std::lock_guard<std::mutex> lock(eventsMutex);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for (auto threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+        const auto threadName = threadIndex == 0 ? std::string("main") : "thread " + std::to_string(threadIndex);
+        out << (threadIndex == 0 ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << threadIndex << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+    }
+
+    for (auto &event : events) {
+        out << ",\n{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":\"maya2glTF\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadIndex
+            << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+        if (event.peakMemoryDelta >= 0) {
+            out << ",\"args\":{\"peakMemoryDelta\":" << event.peakMemoryDelta << "}";
+        }
+        out << "}";
+    }
+
+    out << "\n]}\n";
+
+    if (eventCount > maxTraceEventCount) {
+        cerr << prefix << "WARNING: The trace holds the first " << maxTraceEventCount << " of " << eventCount
+             << " events" << endl;
+    }
+}
+
+void Profiler::printSummary(std::ostream &out) {
+    std::map<std::string, StageStatistics> namedStages;
+
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        for (auto &&pair : stages) {
+            auto &stage = namedStages[pair.first];
+            stage.callCount += pair.second.callCount;
+            stage.totalDuration += pair.second.totalDuration;
+            stage.maxDuration = std::max(stage.maxDuration, pair.second.maxDuration);
+            stage.maxPeakMemoryDelta = std::max(stage.maxPeakMemoryDelta, pair.second.maxPeakMemoryDelta);
+        }
+    }
+
+    std::vector<std::pair<std::string, StageStatistics>> sortedStages(namedStages.begin(), namedStages.end());
+
+    std::stable_sort(sortedStages.begin(), sortedStages.end(), [](const auto &left, const auto &right) {
+        return left.second.totalDuration > right.second.totalDuration;
+    });
+
+    // The time of stages that run on multiple threads adds up, so can exceed the wall time.
+    out << prefix << std::left << std::setw(24) << "stage" << std::right << std::setw(10) << "calls" << std::setw(14)
+        << "total ms" << std::setw(12) << "max ms" << std::setw(14) << "peak +MB" << endl;
+
+    for (auto &stage : sortedStages) {
+        const auto &statistics = stage.second;
+        out << prefix << std::left << std::setw(24) << stage.first << std::right << std::setw(10)
+            << statistics.callCount << std::fixed << std::setprecision(2) << std::setw(14)
+            << statistics.totalDuration / 1000.0 << std::setw(12) << statistics.maxDuration / 1000.0
+            << std::setw(14);
+
+        if (statistics.maxPeakMemoryDelta >= 0) {
+            out << statistics.maxPeakMemoryDelta / double(1 << 20);
+        } else {
+            out << "-";
+        }
+
+        out << endl;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * Collects the wall time of the export stages, when enabled. The events of
+ * each thread are written as a Chrome trace (chrome://tracing, or
+ * https://ui.perfetto.dev), and summarized per stage. While disabled, a
+ * scope costs a single atomic load.
+ */
+class Profiler {
+  public:
+    /** Clears the collected events, and starts collecting */
+    static void start();
+
+    /** Stops collecting; the events are kept until the next start */
+    static void stop();
+
+    static bool isEnabled() {
+        return s_isEnabled.load(std::memory_order_relaxed);
+    }
+
+    /** Writes the events as a Chrome trace-event JSON file */
+    static void writeTrace(const std::string &path);
+
+    /** Prints the wall time, call count and peak memory growth per stage */
+    static void printSummary(std::ostream &out);
+
+    /** The peak resident memory of the process so far, in bytes */
+    static size_t peakMemory();
+
+  private:
+    friend class ProfileScope;
+
+    static std::atomic<bool> s_isEnabled;
+
+    static void record(const char *name, int64_t startMicroseconds,
+                       int64_t endMicroseconds, int64_t peakMemoryDelta);
+
+    static int64_t nowMicroseconds();
+};
+
+/**
+ * Records the time from construction to destruction under a static name.
+ * Stages also record how much the peak memory of the process grew, which
+ * costs a system call, so fine-grained scopes don't.
+ */
+class ProfileScope {
+  public:
+    explicit ProfileScope(const char *name, bool isStage = false)
+        : m_name(Profiler::isEnabled() ? name : nullptr) {
+        if (m_name) {
+            m_peakMemory = isStage ? int64_t(Profiler::peakMemory()) : -1;
+            m_start = Profiler::nowMicroseconds();
+        }
+    }
+
+    ~ProfileScope() {
+        if (m_name) {
+            const auto end = Profiler::nowMicroseconds();
+            const auto peakMemoryDelta =
+                m_peakMemory < 0 ? -1
+                                 : int64_t(Profiler::peakMemory()) - m_peakMemory;
+            Profiler::record(m_name, m_start, end, peakMemoryDelta);
+        }
+    }
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(ProfileScope);
+
+    const char *m_name;
+    int64_t m_start = 0;
+    int64_t m_peakMemory = -1;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+/** Profiles the rest of the enclosing block */
+#define PROFILE_SCOPE(name)                                                    \
+    const ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+/** Profiles the rest of the enclosing block, and its peak memory growth */
+#define PROFILE_STAGE(name)                                                    \
+    const ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "ExportableFrames.h"
+#include "KeyframeReducer.h"
+#include "SampleStore.h"
 #include "accessors.h"
 #include "macros.h"
 
@@ -8,14 +10,13 @@ class ExportableNode;
 
 class PropAnimation {
   public:
-    PropAnimation(const ExportableFrames &frames, const GLTF::Node &node, const GLTF::Animation::Path path, const size_t dimension,
-                  size_t stepDetectSampleCount, const bool useFloatArray)
-        : dimension(dimension), useFloatArray(useFloatArray), stepDetectSampleCount(stepDetectSampleCount), frames(frames) {
-
-        componentValuesPerFrameTable.resize(stepDetectSampleCount);
-        for (auto superSample = 0; superSample < stepDetectSampleCount; ++superSample) {
-            componentValuesPerFrameTable[superSample].reserve(frames.count * dimension);
-        }
+    /** Reserves the values of all frames and super-samples in the store,
+     * which must be allocated before the first sample is appended */
+    PropAnimation(const ExportableFrames &frames, SampleStore &samples, const GLTF::Node &node, const GLTF::Animation::Path path,
+                  const size_t dimension, size_t stepDetectSampleCount, const bool useFloatArray)
+        : dimension(dimension), useFloatArray(useFloatArray), stepDetectSampleCount(stepDetectSampleCount), frames(frames),
+          m_samples(samples), m_superSampleSize(frames.count * dimension),
+          m_offset(samples.reserve(stepDetectSampleCount * m_superSampleSize)), m_valueCounts(stepDetectSampleCount, 0) {
 
         glTarget.node = &const_cast<GLTF::Node &>(node);
         glTarget.path = path;
@@ -31,28 +32,41 @@ class PropAnimation {
     const size_t stepDetectSampleCount;
     const ExportableFrames &frames;
 
-    // For each step-detection super-sampling frame, a vector of component values
-    std::vector<std::vector<float>> componentValuesPerFrameTable;
-
     GLTF::Animation::Channel glChannel;
     GLTF::Animation::Sampler glSampler;
     GLTF::Animation::Channel::Target glTarget;
 
+    /** The component values sampled so far, of a step-detection super-sample */
+    gsl::span<const float> componentValues(const size_t superSample) const {
+        return gsl::make_span(values(superSample), m_valueCounts.at(superSample));
+    }
+
+    /** The values of the next sample, to be written in place */
+    gsl::span<float> appendInPlace(const size_t superSample) {
+        auto &count = m_valueCounts.at(superSample);
+        if (count + dimension > m_superSampleSize)
+            throw std::out_of_range("More samples than frames in animation channel");
+
+        const auto slot = gsl::make_span(values(superSample) + count, dimension);
+        count += dimension;
+        return slot;
+    }
+
     template <std::ptrdiff_t Extent> void append(const gsl::span<const float, Extent> &components, size_t superSample) {
-        std::copy(components.begin(), components.end(), std::back_inserter(componentValuesPerFrameTable.at(superSample)));
+        assert(size_t(components.size()) == dimension);
+        std::copy(components.begin(), components.end(), appendInPlace(superSample).begin());
     }
 
     void appendQuaternion(const gsl::span<const float, 4> &q, int superSample) {
-        auto &componentValuesPerFrame = componentValuesPerFrameTable.at(superSample);
-
-        const auto index = componentValuesPerFrame.size();
+        const auto index = m_valueCounts.at(superSample);
         if (index == 0) {
             append(q, superSample);
         } else {
-            auto x0 = componentValuesPerFrame[index - 4];
-            auto y0 = componentValuesPerFrame[index - 3];
-            auto z0 = componentValuesPerFrame[index - 2];
-            auto w0 = componentValuesPerFrame[index - 1];
+            const auto *previous = values(superSample) + index - 4;
+            auto x0 = previous[0];
+            auto y0 = previous[1];
+            auto z0 = previous[2];
+            auto w0 = previous[3];
 
             auto x1 = q[0];
             auto y1 = q[1];
@@ -70,31 +84,91 @@ class PropAnimation {
                 w1 = -w1;
             }
 
-            componentValuesPerFrame.push_back(x1);
-            componentValuesPerFrame.push_back(y1);
-            componentValuesPerFrame.push_back(z1);
-            componentValuesPerFrame.push_back(w1);
+            auto slot = appendInPlace(superSample);
+            slot[0] = x1;
+            slot[1] = y1;
+            slot[2] = z1;
+            slot[3] = w1;
         }
     }
 
-    void finish(const std::string &name, const bool useSingleKey, const char *interpolation) {
+    /** Are all sampled values within the threshold of the base values? */
+    bool isConstant(const gsl::span<const float> &baseValues, const double constantThreshold) const {
+        const auto componentValues = this->componentValues(0);
+
+        bool isConstant = true;
+        for (size_t offset = 0; offset < size_t(componentValues.size()) && isConstant; offset += dimension) {
+            for (size_t axis = 0; axis < dimension && isConstant; ++axis) {
+                isConstant = std::abs(baseValues[axis] - componentValues[offset + axis]) < constantThreshold;
+            }
+        }
+
+        return isConstant;
+    }
+
+    /** For each frame, do its step-detection super-samples all hold the value of that frame? */
+    std::vector<bool> heldFrames(const double constantThreshold) const {
+        const auto componentValues = this->componentValues(0);
+
+        std::vector<bool> heldFrames(componentValues.size() / dimension);
+
+        for (size_t frameIndex = 0; frameIndex < heldFrames.size(); ++frameIndex) {
+            const auto offset = frameIndex * dimension;
+            const auto *startValues = &componentValues[offset];
+
+            bool isHeld = true;
+            for (size_t superSample = 1; superSample < stepDetectSampleCount && isHeld; ++superSample) {
+                const auto *stepComponentValues = values(superSample);
+                for (size_t axis = 0; axis < dimension && isHeld; ++axis) {
+                    isHeld = std::abs(startValues[axis] - stepComponentValues[offset + axis]) < constantThreshold;
+                }
+            }
+
+            heldFrames[frameIndex] = isHeld;
+        }
+
+        return heldFrames;
+    }
+
+    /** Do the step-detection super-samples indicate that STEP interpolation can be used for all frames? */
+    bool canUseStep(const double constantThreshold) const {
+        const auto held = heldFrames(constantThreshold);
+        return std::all_of(held.begin(), held.end(), [](bool isHeld) { return isHeld; });
+    }
+
+    /** Creates the output accessor. When keyTolerance is non-0, only the
+     * keys needed to stay within that tolerance are kept. For rotations the
+     * tolerance is an angle in radians.
+     *
+     * For LINEAR channels, the frames that are held until the next frame
+     * get an extra key at their last super-sample, so the channel jumps to
+     * the next value like a STEP channel. */
+    void finish(const std::string &name, const bool useSingleKey, const char *interpolation, const double keyTolerance = 0,
+                const std::vector<bool> &heldFrames = {}) {
         glSampler.interpolation = interpolation;
 
         if (!m_outputs) {
-            auto &componentValuesPerFrame = componentValuesPerFrameTable.at(0);
-
             if (useSingleKey) {
-                componentValuesPerFrame.resize(dimension);
+                m_valueCounts.at(0) = dimension;
                 glSampler.input = frames.glInput0();
             } else {
-                glSampler.input = frames.glInputs();
-            }
+                std::vector<float> keyTimes = frames.times();
+
+                const bool isStep = std::strcmp(interpolation, "STEP") == 0;
 
-            if (stepDetectSampleCount > 1 && !useSingleKey) {
-                // Remove all
+                if (!isStep && !heldFrames.empty()) {
+                    insertStepKeys(keyTimes, heldFrames);
+                }
+
+                if (keyTolerance > 0) {
+                    reduceKeys(keyTimes, keyTolerance, isStep);
+                }
+
+                glSampler.input = keyTimes == frames.times() ? frames.glInputs() : frames.glInputs(keyTimes);
             }
 
-            m_outputs = contiguousChannelAccessor(name, span(componentValuesPerFrame), useFloatArray ? 1 : dimension);
+            // The accessor points into the sample store
+            m_outputs = contiguousChannelAccessor(name, componentValues(0), useFloatArray ? 1 : dimension);
 
             glSampler.output = m_outputs.get();
 
@@ -104,7 +178,84 @@ class PropAnimation {
     }
 
 private:
+    SampleStore &m_samples;
+
+    // The values of a super-sample of all frames
+    const size_t m_superSampleSize;
+
+    // Where the super-samples start in the store, one after the other
+    const size_t m_offset;
+
+    // The number of values appended per super-sample
+    std::vector<size_t> m_valueCounts;
+
     std::unique_ptr<GLTF::Accessor> m_outputs;
 
+    float *values(const size_t superSample) { return m_samples.data(m_offset + superSample * m_superSampleSize); }
+
+    const float *values(const size_t superSample) const { return m_samples.data(m_offset + superSample * m_superSampleSize); }
+
+    /** Duplicates the value of each held frame at the time of its last
+     * super-sample, when the next frame has a different value */
+    void insertStepKeys(std::vector<float> &keyTimes, const std::vector<bool> &heldFrames) {
+        const auto componentValuesPerFrame = componentValues(0);
+
+        const auto frameCount = keyTimes.size();
+        assert(heldFrames.size() == frameCount);
+
+        const double lastSuperSampleOffset = double(stepDetectSampleCount - 1) / (stepDetectSampleCount * frames.framesPerSecond);
+
+        std::vector<float> times;
+        std::vector<float> values;
+        times.reserve(frameCount);
+        values.reserve(componentValuesPerFrame.size());
+
+        for (size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            const auto frameValues = componentValuesPerFrame.begin() + frameIndex * dimension;
+
+            times.push_back(keyTimes[frameIndex]);
+            values.insert(values.end(), frameValues, frameValues + dimension);
+
+            if (heldFrames[frameIndex] && frameIndex + 1 < frameCount &&
+                !std::equal(frameValues, frameValues + dimension, frameValues + dimension)) {
+                times.push_back(static_cast<float>(keyTimes[frameIndex] + lastSuperSampleOffset));
+                values.insert(values.end(), frameValues, frameValues + dimension);
+            }
+        }
+
+        // The keys fit in the store, the other super-samples are no longer needed
+        assert(values.size() <= stepDetectSampleCount * m_superSampleSize);
+        std::copy(values.begin(), values.end(), this->values(0));
+        m_valueCounts.at(0) = values.size();
+
+        keyTimes = std::move(times);
+    }
+
+    /** Keeps only the keys needed to stay within the tolerance */
+    void reduceKeys(std::vector<float> &keyTimes, const double keyTolerance, const bool isStep) {
+        const auto values = componentValues(0);
+        const auto times = span(keyTimes);
+
+        std::vector<int> keys;
+
+        if (glTarget.path != GLTF::Animation::Path::ROTATION) {
+            keys = isStep ? reduceStepKeys(values, dimension, keyTolerance) : reduceLinearKeys(values, dimension, keyTolerance, times);
+        } else {
+            // A quaternion component differs by about half the rotation angle
+            keys = isStep ? reduceStepKeys(values, dimension, keyTolerance / 2) : reduceRotationKeys(values, keyTolerance, times);
+        }
+
+        // The kept keys move forward in place
+        auto *keyValues = this->values(0);
+        for (size_t keyIndex = 0; keyIndex < keys.size(); ++keyIndex) {
+            const auto source = keyValues + keys[keyIndex] * dimension;
+            std::copy(source, source + dimension, keyValues + keyIndex * dimension);
+            keyTimes[keyIndex] = keyTimes[keys[keyIndex]];
+        }
+
+        m_valueCounts.at(0) = keys.size() * dimension;
+        keyTimes.resize(keys.size());
+    }
+
     DISALLOW_COPY_MOVE_ASSIGN(PropAnimation);
 };
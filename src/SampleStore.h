@@ -0,0 +1,50 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * One contiguous block for the sampled values of all animated props of a
+ * clip. Each prop reserves its slice when it is created, the block is
+ * allocated once before sampling starts, and the samples are written in
+ * place. The output accessors of the props point into the block, so it
+ * must outlive these.
+ */
+class SampleStore {
+  public:
+    SampleStore() = default;
+    ~SampleStore() = default;
+
+    /** Reserves room for count values, returns their offset */
+    size_t reserve(const size_t count) {
+        assert(!m_isAllocated);
+        const auto offset = m_reservedCount;
+        m_reservedCount += count;
+        return offset;
+    }
+
+    /** Allocates the zeroed values of all reservations */
+    void allocate() {
+        assert(!m_isAllocated);
+        m_values.resize(m_reservedCount);
+        m_isAllocated = true;
+    }
+
+    float *data(const size_t offset) {
+        assert(m_isAllocated && offset <= m_values.size());
+        return m_values.data() + offset;
+    }
+
+    const float *data(const size_t offset) const {
+        assert(m_isAllocated && offset <= m_values.size());
+        return m_values.data() + offset;
+    }
+
+    size_t size() const { return m_values.size(); }
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(SampleStore);
+
+    std::vector<float> m_values;
+    size_t m_reservedCount = 0;
+    bool m_isAllocated = false;
+};
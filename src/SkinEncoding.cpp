@@ -0,0 +1,248 @@
+#include "coreExternals.h"
+
+#include "MeshQuantization.h"
+#include "MeshRenderables.h"
+#include "SkinEncoding.h"
+#include "accessors.h"
+
+using GLTF::Constants::WebGL;
+
+namespace {
+const size_t jointsPerElement = array_size<JointIndices>::size;
+
+template <typename T>
+std::vector<byte> quantizedBytes(const std::vector<uint16_t> &values) {
+    std::vector<T> components(values.begin(), values.end());
+    const auto bytes = reinterpret_span<byte>(span(components));
+    return std::vector<byte>(bytes.begin(), bytes.end());
+}
+
+bool isHeavier(const VertexJointAssignment &left, const VertexJointAssignment &right) {
+    // Ties are broken by joint index, to keep the order deterministic
+    return left.jointWeight > right.jointWeight ||
+           (left.jointWeight == right.jointWeight && left.jointIndex < right.jointIndex);
+}
+} // namespace
+
+float selectJointAssignments(std::vector<VertexJointAssignment> &assignments, const size_t maxCount) {
+    if (maxCount == 0 || assignments.size() <= maxCount) {
+        std::sort(assignments.begin(), assignments.end(), isHeavier);
+        return 0;
+    }
+
+    double totalWeight = 0;
+    for (auto &assignment : assignments) {
+        totalWeight += assignment.jointWeight;
+    }
+
+    const auto kept = assignments.begin() + maxCount;
+    std::nth_element(assignments.begin(), kept, assignments.end(), isHeavier);
+    std::sort(assignments.begin(), kept, isHeavier);
+
+    double keptWeight = 0;
+    for (auto it = assignments.begin(); it != kept; ++it) {
+        keptWeight += it->jointWeight;
+    }
+
+    if (totalWeight <= 0 || keptWeight <= 0) {
+        assignments.erase(kept, assignments.end());
+        return 0;
+    }
+
+    // Dropped weights become zero, the kept ones grow by the same factor
+    double maxError = 0;
+    for (auto it = kept; it != assignments.end(); ++it) {
+        maxError = std::max(maxError, std::abs(it->jointWeight) / totalWeight);
+    }
+
+    const auto scale = totalWeight / keptWeight;
+    for (auto it = assignments.begin(); it != kept; ++it) {
+        maxError = std::max(maxError, std::abs(it->jointWeight / keptWeight - it->jointWeight / totalWeight));
+        it->jointWeight = static_cast<float>(it->jointWeight * scale);
+    }
+
+    assignments.erase(kept, assignments.end());
+    return static_cast<float>(maxError);
+}
+
+JointWeightSets JointWeightSets::fromAssignments(const VertexJointAssignmentTable &assignmentsTable,
+                                                 const size_t setCount) {
+    const auto pointCount = assignmentsTable.size();
+
+    JointWeightSets sets;
+    sets.weights.assign(setCount, JointWeightsVector(pointCount, JointWeights{}));
+    sets.joints.assign(setCount, JointIndicesVector(pointCount, JointIndices{}));
+
+    for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex) {
+        const auto &assignments = assignmentsTable[pointIndex];
+        const auto assignmentCount = std::min(size_t(assignments.size()), setCount * jointsPerElement);
+
+        float weightSum = 0;
+        for (size_t index = 0; index < assignmentCount; ++index) {
+            weightSum += assignments[index].jointWeight;
+        }
+
+        const auto normalize = weightSum > 0 ? 1 / weightSum : 0.0f;
+
+        for (size_t index = 0; index < assignmentCount; ++index) {
+            const auto setIndex = index / jointsPerElement;
+            const auto componentIndex = index % jointsPerElement;
+            sets.joints[setIndex][pointIndex][componentIndex] = JointIndex(assignments[index].jointIndex);
+            sets.weights[setIndex][pointIndex][componentIndex] = assignments[index].jointWeight * normalize;
+        }
+    }
+
+    return sets;
+}
+
+JointPalette JointPalette::fromVertices(const size_t jointCount,
+                                        const VertexElementsPerSetIndexTable &vertices) {
+    const auto &jointSets = vertices.at(Semantic::JOINTS);
+    const auto &weightSets = vertices.at(Semantic::WEIGHTS);
+    const auto setCount = std::min(jointSets.size(), weightSets.size());
+
+    std::vector<bool> isUsed(jointCount);
+
+    for (size_t setIndex = 0; setIndex < setCount; ++setIndex) {
+        const auto joints = jointSets.at(setIndex).shorts();
+        const auto weights = weightSets.at(setIndex).floats();
+        const auto count = std::min(joints.size(), weights.size());
+
+        for (ptrdiff_t index = 0; index < count; ++index) {
+            const auto joint = joints[index];
+            if (weights[index] > 0 && joint < jointCount) {
+                isUsed[joint] = true;
+            }
+        }
+    }
+
+    JointPalette palette;
+    palette.paletteIndices.resize(jointCount, 0);
+
+    for (size_t joint = 0; joint < jointCount; ++joint) {
+        if (isUsed[joint]) {
+            palette.paletteIndices[joint] = static_cast<JointIndex>(palette.skinJoints.size());
+            palette.skinJoints.push_back(static_cast<JointIndex>(joint));
+        }
+    }
+
+    return palette;
+}
+
+std::unique_ptr<GLTF::Accessor> jointIndicesAccessor(const std::string &name,
+                                                     const gsl::span<const JointIndex> skinJointIndices,
+                                                     const JointPalette &palette) {
+    const auto remap = [&palette](const JointIndex joint) {
+        return joint < palette.paletteIndices.size() ? palette.paletteIndices[joint] : JointIndex(0);
+    };
+
+    const auto type = glAccessorType(jointsPerElement);
+
+    if (palette.fitsBytes()) {
+        std::vector<uint8_t> joints(skinJointIndices.size());
+        std::transform(skinJointIndices.begin(), skinJointIndices.end(), joints.begin(),
+                       [&remap](const JointIndex joint) { return static_cast<uint8_t>(remap(joint)); });
+        return contiguousAccessor(name, type, WebGL::UNSIGNED_BYTE, WebGL::ARRAY_BUFFER, span(joints),
+                                  jointsPerElement);
+    }
+
+    std::vector<uint16_t> joints(skinJointIndices.size());
+    std::transform(skinJointIndices.begin(), skinJointIndices.end(), joints.begin(), remap);
+    return contiguousAccessor(name, type, WebGL::UNSIGNED_SHORT, WebGL::ARRAY_BUFFER, span(joints),
+                              jointsPerElement);
+}
+
+QuantizedJointWeights QuantizedJointWeights::fromVertexBuffer(const VertexBuffer &vertexBuffer,
+                                                              const double maxError) {
+    QuantizedJointWeights result;
+
+    // Rounding to the largest remainder can move a weight by a whole step.
+    uint16_t maxValue;
+    if (1.0 / std::numeric_limits<uint8_t>::max() <= maxError) {
+        result.m_componentType = WebGL::UNSIGNED_BYTE;
+        maxValue = std::numeric_limits<uint8_t>::max();
+    } else if (1.0 / std::numeric_limits<uint16_t>::max() <= maxError) {
+        result.m_componentType = WebGL::UNSIGNED_SHORT;
+        maxValue = std::numeric_limits<uint16_t>::max();
+    } else {
+        return result;
+    }
+
+    std::vector<gsl::span<const float>> weightSets;
+    for (auto setIndex = 0;; ++setIndex) {
+        const auto it = vertexBuffer.componentsMap.find(VertexSlot(ShapeIndex::main(), Semantic::WEIGHTS, setIndex));
+        if (it == vertexBuffer.componentsMap.end())
+            break;
+        weightSets.emplace_back(reinterpret_span<float>(it->second));
+    }
+
+    const auto setCount = weightSets.size();
+    const auto vertexCount = vertexBuffer.vertexCount;
+    const auto weightsPerVertex = setCount * jointsPerElement;
+
+    for (auto &weights : weightSets) {
+        if (size_t(weights.size()) != vertexCount * jointsPerElement)
+            return result;
+    }
+
+    std::vector<std::vector<uint16_t>> quantizedSets(setCount, std::vector<uint16_t>(vertexCount * jointsPerElement));
+
+    std::vector<double> remainders(weightsPerVertex);
+    std::vector<size_t> order(weightsPerVertex);
+
+    for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+        const auto offset = vertexIndex * jointsPerElement;
+
+        double weightSum = 0;
+        long quantizedSum = 0;
+
+        for (size_t setIndex = 0; setIndex < setCount; ++setIndex) {
+            for (size_t component = 0; component < jointsPerElement; ++component) {
+                const auto weight = std::clamp(double(weightSets[setIndex][offset + component]), 0.0, 1.0);
+                const auto scaled = weight * maxValue;
+                const auto truncated = std::floor(scaled);
+
+                quantizedSets[setIndex][offset + component] = static_cast<uint16_t>(truncated);
+                remainders[setIndex * jointsPerElement + component] = scaled - truncated;
+
+                weightSum += weight;
+                quantizedSum += static_cast<long>(truncated);
+            }
+        }
+
+        // Give the missing steps to the weights that lost the most.
+        const auto targetSum = std::min<long>(maxValue, std::lround(weightSum * maxValue));
+        const auto missingSteps = std::clamp<long>(targetSum - quantizedSum, 0, long(weightsPerVertex));
+
+        if (missingSteps > 0) {
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(),
+                             [&remainders](const size_t a, const size_t b) { return remainders[a] > remainders[b]; });
+
+            for (long step = 0; step < missingSteps; ++step) {
+                const auto index = order[step];
+                ++quantizedSets[index / jointsPerElement][offset + index % jointsPerElement];
+            }
+        }
+    }
+
+    result.m_sets.reserve(setCount);
+    for (auto &values : quantizedSets) {
+        result.m_sets.emplace_back(result.m_componentType == WebGL::UNSIGNED_BYTE ? quantizedBytes<uint8_t>(values)
+                                                                                  : quantizedBytes<uint16_t>(values));
+    }
+
+    return result;
+}
+
+std::unique_ptr<GLTF::Accessor> QuantizedJointWeights::accessor(const std::string &name, const int setIndex) const {
+    auto &bytes = m_sets.at(setIndex);
+    const auto componentSize = m_componentType == WebGL::UNSIGNED_BYTE ? sizeof(uint8_t) : sizeof(uint16_t);
+    const auto count = int(bytes.size() / (componentSize * jointsPerElement));
+
+    auto accessor = std::make_unique<NormalizedAccessor>(glAccessorType(jointsPerElement), m_componentType,
+                                                         const_cast<byte *>(bytes.data()), count,
+                                                         WebGL::ARRAY_BUFFER);
+    accessor->name = name;
+    return accessor;
+}
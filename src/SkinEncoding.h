@@ -0,0 +1,115 @@
+#pragma once
+
+#include "MeshTables.h"
+
+struct VertexBuffer;
+
+class VertexJointAssignment {
+  public:
+    int jointIndex;
+    float jointWeight;
+
+    VertexJointAssignment(const int jointIndex, const float jointWeight)
+        : jointIndex(jointIndex), jointWeight(jointWeight) {}
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const VertexJointAssignment &obj) {
+        return os << "[" << obj.jointIndex << ", " << std::setprecision(3)
+                  << obj.jointWeight << "]";
+    }
+
+    DEFAULT_COPY_MOVE_ASSIGN_CTOR_DTOR(VertexJointAssignment);
+};
+
+// Per vertex, the joint assignments
+typedef std::vector<gsl::span<const VertexJointAssignment>>
+    VertexJointAssignmentTable;
+
+/**
+ * Sorts the joint assignments of a vertex from heavy to light. When a vertex
+ * has more than maxCount assignments (0 = no limit), only the heaviest ones
+ * are kept, selected without sorting the others, and scaled back to the
+ * total weight. Returns the largest change of any normalized weight.
+ */
+float selectJointAssignments(std::vector<VertexJointAssignment> &assignments,
+                             size_t maxCount);
+
+/**
+ * The joints of a skin that weigh any vertex, in the order of the skin.
+ * Maya skin clusters often list influences that don't move a single
+ * vertex, like helper or leaf joints. These are left out of the glTF
+ * skin, and the JOINTS attributes index the palette instead.
+ */
+struct JointPalette {
+    /** The skin joint index of each palette entry */
+    std::vector<JointIndex> skinJoints;
+
+    /** The palette index of each skin joint, 0 for unused joints */
+    std::vector<JointIndex> paletteIndices;
+
+    bool isEmpty() const { return skinJoints.empty(); }
+
+    /** Can the palette indices be stored as UNSIGNED_BYTE? */
+    bool fitsBytes() const {
+        return skinJoints.size() <= std::numeric_limits<uint8_t>::max() + 1;
+    }
+
+    /** The joints with a non-zero weight in the JOINTS and WEIGHTS sets of
+     * the vertices. Empty when no vertex is weighted */
+    static JointPalette fromVertices(size_t jointCount,
+                                     const VertexElementsPerSetIndexTable &vertices);
+};
+
+/**
+ * The JOINTS and WEIGHTS sets of the vertices, 4 joints and weights per
+ * vertex each, the weights of a vertex normalized over all its sets.
+ */
+struct JointWeightSets {
+    std::vector<JointWeightsVector> weights;
+    std::vector<JointIndicesVector> joints;
+
+    /** Packs the assignments of each vertex, sorted from heavy to light,
+     * into setCount sets. Vertices with fewer assignments get zero
+     * weights, assignments beyond the sets are dropped */
+    static JointWeightSets fromAssignments(const VertexJointAssignmentTable &assignmentsTable,
+                                           size_t setCount);
+};
+
+/**
+ * Creates the accessor of a JOINTS set of skin joint indices, remapped to
+ * the palette. Uses UNSIGNED_BYTE components when the palette fits.
+ */
+std::unique_ptr<GLTF::Accessor>
+jointIndicesAccessor(const std::string &name,
+                     gsl::span<const JointIndex> skinJointIndices,
+                     const JointPalette &palette);
+
+/**
+ * The WEIGHTS sets of a vertex buffer as normalized UNSIGNED_BYTE or
+ * UNSIGNED_SHORT components. The weights of all sets of a vertex are
+ * rounded together with the largest remainder method, so these still
+ * sum to one exactly, as glTF requires.
+ */
+class QuantizedJointWeights {
+  public:
+    QuantizedJointWeights() = default;
+
+    /** Empty when neither component type is within maxError */
+    static QuantizedJointWeights fromVertexBuffer(const VertexBuffer &vertexBuffer,
+                                                  double maxError);
+
+    bool isEmpty() const { return m_sets.empty(); }
+
+    std::unique_ptr<GLTF::Accessor> accessor(const std::string &name,
+                                             int setIndex) const;
+
+    DEFAULT_COPY_MOVE_ASSIGN_DTOR(QuantizedJointWeights);
+
+  private:
+    GLTF::Constants::WebGL m_componentType =
+        GLTF::Constants::WebGL::UNSIGNED_SHORT;
+
+    // Per set the quantized components, as bytes when m_componentType
+    // is UNSIGNED_BYTE.
+    std::vector<std::vector<byte>> m_sets;
+};
@@ -0,0 +1,161 @@
+#include "coreExternals.h"
+
+#include "SparseAccessor.h"
+#include "accessors.h"
+
+using GLTF::Constants::WebGL;
+
+namespace {
+const char *glAccessorTypeName(const GLTF::Accessor::Type type) {
+    switch (type) {
+    case GLTF::Accessor::Type::SCALAR:
+        return "SCALAR";
+    case GLTF::Accessor::Type::VEC2:
+        return "VEC2";
+    case GLTF::Accessor::Type::VEC3:
+        return "VEC3";
+    case GLTF::Accessor::Type::VEC4:
+        return "VEC4";
+    case GLTF::Accessor::Type::MAT2:
+        return "MAT2";
+    case GLTF::Accessor::Type::MAT3:
+        return "MAT3";
+    case GLTF::Accessor::Type::MAT4:
+        return "MAT4";
+    default:
+        assert(false);
+        return "UNKNOWN";
+    }
+}
+
+template <typename T>
+std::unique_ptr<GLTF::Accessor> sparseIndicesAccessor(const std::string &name, const WebGL componentType,
+                                                      const gsl::span<const Index> vertices) {
+    std::vector<T> indices(vertices.begin(), vertices.end());
+    return contiguousAccessor(name, GLTF::Accessor::Type::SCALAR, componentType, static_cast<WebGL>(-1),
+                              span(indices), 1);
+}
+} // namespace
+
+SparseAccessor::SparseAccessor(const Type type, const WebGL componentType, const int count,
+                               std::unique_ptr<GLTF::Accessor> indices, std::unique_ptr<GLTF::Accessor> values,
+                               std::vector<float> minValues, std::vector<float> maxValues)
+    : GLTF::Accessor(type, componentType), m_indices(std::move(indices)), m_values(std::move(values)),
+      m_minValues(std::move(minValues)), m_maxValues(std::move(maxValues)) {
+    this->count = count;
+}
+
+SparseAccessor::~SparseAccessor() = default;
+
+void SparseAccessor::writeJSON(void *writer, GLTF::Options *options) {
+    auto *jsonWriter = static_cast<rapidjson::Writer<rapidjson::StringBuffer> *>(writer);
+
+    const auto writeFloats = [jsonWriter](const char *key, const std::vector<float> &values) {
+        jsonWriter->Key(key);
+        jsonWriter->StartArray();
+        for (auto value : values) {
+            jsonWriter->Double(value);
+        }
+        jsonWriter->EndArray();
+    };
+
+    jsonWriter->Key("componentType");
+    jsonWriter->Int(static_cast<int>(componentType));
+    jsonWriter->Key("count");
+    jsonWriter->Int(count);
+    writeFloats("max", m_maxValues);
+    writeFloats("min", m_minValues);
+    jsonWriter->Key("type");
+    jsonWriter->String(glAccessorTypeName(type));
+
+    jsonWriter->Key("sparse");
+    jsonWriter->StartObject();
+    jsonWriter->Key("count");
+    jsonWriter->Int(m_indices->count);
+
+    jsonWriter->Key("indices");
+    jsonWriter->StartObject();
+    jsonWriter->Key("bufferView");
+    jsonWriter->Int(m_indices->bufferView->id);
+    jsonWriter->Key("byteOffset");
+    jsonWriter->Int(m_indices->byteOffset);
+    jsonWriter->Key("componentType");
+    jsonWriter->Int(static_cast<int>(m_indices->componentType));
+    jsonWriter->EndObject();
+
+    jsonWriter->Key("values");
+    jsonWriter->StartObject();
+    jsonWriter->Key("bufferView");
+    jsonWriter->Int(m_values->bufferView->id);
+    jsonWriter->Key("byteOffset");
+    jsonWriter->Int(m_values->byteOffset);
+    jsonWriter->EndObject();
+
+    jsonWriter->EndObject();
+
+    GLTF::Object::writeJSON(writer, options);
+}
+
+std::unique_ptr<GLTF::Accessor> sparseElementAccessor(const std::string &name, const Semantic::Kind semantic,
+                                                      const ShapeIndex &shapeIndex, const size_t vertexCount,
+                                                      const gsl::span<const Index> nonZeroVertices,
+                                                      const gsl::span<const byte> nonZeroBytes,
+                                                      const double maxDensity, const float valueScale) {
+    if (Component::type(semantic) != Component::FLOAT)
+        return nullptr;
+
+    const size_t dim = dimension(semantic, shapeIndex);
+
+    // A sparse accessor needs at least one element, store a zero one if needed.
+    static const Index firstVertex[] = {0};
+    static const float zeroComponents[4] = {0, 0, 0, 0};
+    const auto vertices = nonZeroVertices.empty() ? gsl::span<const Index>(firstVertex) : nonZeroVertices;
+    const auto components = nonZeroVertices.empty() ? gsl::span<const float>(zeroComponents).subspan(0, dim)
+                                                     : reinterpret_span<float>(nonZeroBytes);
+    const auto sparseCount = size_t(vertices.size());
+    assert(size_t(components.size()) == sparseCount * dim);
+
+    if (vertexCount == 0 || sparseCount > maxDensity * vertexCount)
+        return nullptr;
+
+    const auto indexComponentType =
+        vertexCount <= std::numeric_limits<uint16_t>::max() ? WebGL::UNSIGNED_SHORT : WebGL::UNSIGNED_INT;
+    const auto indexByteSize = indexComponentType == WebGL::UNSIGNED_SHORT ? 2 : 4;
+
+    // Sparse elements also store their index, plus up to 3 bytes of alignment padding.
+    const auto denseByteLength = vertexCount * dim * sizeof(float);
+    const auto sparseByteLength = sparseCount * (dim * sizeof(float) + indexByteSize) + 3;
+
+    if (sparseByteLength >= denseByteLength)
+        return nullptr;
+
+    std::vector<float> values;
+    values.reserve(sparseCount * dim);
+
+    // Elements that are not stored are zero, which must be within the bounds too.
+    std::vector<float> minValues(dim, sparseCount < vertexCount ? 0.0f : std::numeric_limits<float>::max());
+    std::vector<float> maxValues(dim, sparseCount < vertexCount ? 0.0f : std::numeric_limits<float>::lowest());
+
+    for (size_t element = 0; element < sparseCount; ++element) {
+        for (size_t axis = 0; axis < dim; ++axis) {
+            const auto value = components[element * dim + axis] * valueScale;
+            values.push_back(value);
+            minValues[axis] = std::min(minValues[axis], value);
+            maxValues[axis] = std::max(maxValues[axis], value);
+        }
+    }
+
+    const auto sparseName = [&name](const char *suffix) { return name.empty() ? name : name + suffix; };
+
+    auto indices = indexComponentType == WebGL::UNSIGNED_SHORT
+                       ? sparseIndicesAccessor<uint16_t>(sparseName("/sparse/indices"), indexComponentType, vertices)
+                       : sparseIndicesAccessor<uint32_t>(sparseName("/sparse/indices"), indexComponentType, vertices);
+
+    auto valuesAccessor = contiguousChannelAccessor(sparseName("/sparse/values"), span(values), dim);
+
+    auto accessor = std::make_unique<SparseAccessor>(glAccessorType(dim), WebGL::FLOAT, int(vertexCount),
+                                                     std::move(indices), std::move(valuesAccessor),
+                                                     std::move(minValues), std::move(maxValues));
+    accessor->name = name;
+    return accessor;
+}
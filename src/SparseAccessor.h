@@ -0,0 +1,45 @@
+#pragma once
+
+#include "sceneTypes.h"
+
+/**
+ * A glTF sparse accessor without a base buffer view: all elements are zero,
+ * except the ones at the sparse indices. The AccessorPacker packs the
+ * indices and values of all sparse accessors in a single buffer view
+ * without a target, and assigns that view to the accessor, so the asset
+ * writes it.
+ */
+class SparseAccessor : public GLTF::Accessor {
+  public:
+    SparseAccessor(Type type, GLTF::Constants::WebGL componentType, int count,
+                   std::unique_ptr<GLTF::Accessor> indices, std::unique_ptr<GLTF::Accessor> values,
+                   std::vector<float> minValues, std::vector<float> maxValues);
+
+    ~SparseAccessor();
+
+    GLTF::Accessor *indices() const { return m_indices.get(); }
+    GLTF::Accessor *values() const { return m_values.get(); }
+
+    void writeJSON(void *writer, GLTF::Options *options) override;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(SparseAccessor);
+
+    std::unique_ptr<GLTF::Accessor> m_indices;
+    std::unique_ptr<GLTF::Accessor> m_values;
+    std::vector<float> m_minValues;
+    std::vector<float> m_maxValues;
+};
+
+/**
+ * Creates a sparse accessor for the float elements of a blend-shape slot
+ * of vertexCount vertices, of which only the given vertices are non-zero,
+ * with the given bytes. The values are multiplied by valueScale.
+ * Returns nullptr when more than maxDensity of the vertices are non-zero,
+ * or when a dense accessor would be smaller.
+ */
+std::unique_ptr<GLTF::Accessor> sparseElementAccessor(const std::string &name, Semantic::Kind semantic,
+                                                      const ShapeIndex &shapeIndex, size_t vertexCount,
+                                                      gsl::span<const Index> nonZeroVertices,
+                                                      gsl::span<const byte> nonZeroBytes, double maxDensity,
+                                                      float valueScale = 1);
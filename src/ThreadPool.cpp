@@ -0,0 +1,70 @@
+#include "coreExternals.h"
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(const size_t workerCount) {
+    m_workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        m_workers.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::workerCountFor(const int threadCount) {
+    if (threadCount == 1)
+        return 0;
+
+    if (threadCount > 1)
+        return threadCount;
+
+    const auto hardwareCount = std::thread::hardware_concurrency();
+    return hardwareCount > 1 ? hardwareCount : 0;
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task) {
+    std::packaged_task<void()> packagedTask(std::move(task));
+    auto future = packagedTask.get_future();
+
+    if (m_workers.empty()) {
+        packagedTask();
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace_back(std::move(packagedTask));
+        }
+        m_condition.notify_one();
+    }
+
+    return future;
+}
+
+void ThreadPool::work() {
+    for (;;) {
+        std::packaged_task<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_isStopping || !m_tasks.empty(); });
+
+            if (m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
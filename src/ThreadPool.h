@@ -0,0 +1,40 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * A fixed set of worker threads that run queued tasks in FIFO order.
+ * Used to run the Maya-free export stages of multiple meshes concurrently,
+ * while the main thread keeps extracting data from Maya.
+ * A pool without workers runs each task immediately on the calling thread,
+ * so a serial export follows exactly the same code path.
+ */
+class ThreadPool {
+  public:
+    /** Creates the given number of worker threads; 0 means serial */
+    explicit ThreadPool(size_t workerCount);
+
+    /** Waits for the queued tasks to finish, and joins the workers */
+    ~ThreadPool();
+
+    /** The number of worker threads to use for the given thread count
+     * argument: 0 means one per hardware thread, 1 means serial. */
+    static size_t workerCountFor(int threadCount);
+
+    size_t workerCount() const { return m_workers.size(); }
+
+    /** Queues the task. Exceptions thrown by the task are rethrown by
+     * the get() method of the returned future. */
+    std::future<void> submit(std::function<void()> task);
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(ThreadPool);
+
+    void work();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::packaged_task<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_isStopping = false;
+};
@@ -8,21 +8,22 @@ const double epsilon = 1e-4f;
 
 // How much the axes deviate from being orthogonal
 double getAxesNonOrthogonality(const MMatrix &m) {
-    // Maya uses row matrices.
-    MVector vx(m[0][0], m[0][1], m[0][2]);
-    MVector vy(m[1][0], m[1][1], m[1][2]);
-    MVector vz(m[2][0], m[2][1], m[2][2]);
+    return axesNonOrthogonality(toAffineMatrix(m, 1));
+}
 
-    vx.normalize();
-    vy.normalize();
-    vz.normalize();
+AffineMatrix toAffineMatrix(const MMatrix &m, const double scaleFactor) {
+    AffineMatrix result;
+    for (auto row = 0; row < 4; ++row) {
+        for (auto column = 0; column < 4; ++column) {
+            result.m[row][column] = m.matrix[row][column];
+        }
+    }
 
-    double e = 0;
-    e = std::max(e, fabs(vx * vy));
-    e = std::max(e, fabs(vy * vz));
-    e = std::max(e, fabs(vz * vx));
+    for (auto column = 0; column < 3; ++column) {
+        result.m[3][column] *= scaleFactor;
+    }
 
-    return e;
+    return result;
 }
 
 void getTranslation(const MTransformationMatrix &m, float *result,
@@ -70,29 +71,6 @@ GLTF::Node::TransformMatrix toGLTF(const MMatrix &matrix) {
         m[0][2], m[1][2], m[2][2], m[3][2], m[0][3], m[1][3], m[2][3], m[3][3]);
 }
 
-MMatrix getObjectSpaceMatrix(const MDagPath &dagPath,
-                             const MDagPath &parentPath) {
-    MStatus status;
-
-    MFnDagNode fnDagNode(dagPath, &status);
-    THROW_ON_FAILURE(status);
-
-    const auto childWorldMatrix = dagPath.inclusiveMatrix(&status);
-    THROW_ON_FAILURE(status);
-
-    const auto parentPathLength = parentPath.length(&status);
-    THROW_ON_FAILURE(status);
-
-    if (parentPathLength == 0)
-        return childWorldMatrix;
-
-    const auto parentWorldMatrixInverse =
-        parentPath.inclusiveMatrixInverse(&status);
-    THROW_ON_FAILURE(status);
-
-    return childWorldMatrix * parentWorldMatrixInverse;
-}
-
 void makeIdentity(GLTF::Node::TransformTRS &trs) {
     trs.translation[0] = 0;
     trs.translation[1] = 0;
@@ -108,19 +86,184 @@ void makeIdentity(GLTF::Node::TransformTRS &trs) {
     trs.rotation[3] = 1;
 }
 
+DecomposedTRS decomposeTransform(const AffineMatrix &matrix) {
+    auto result = decomposeTRS(matrix);
+
+    if (!result.isDecomposed) {
+        // The translation is already scaled
+        const MTransformationMatrix mayaMatrix(MMatrix(matrix.m));
+        getTranslation(mayaMatrix, result.translation.data(), 1);
+        getRotation(mayaMatrix, result.rotation.data());
+        getScaling(mayaMatrix, result.scale.data());
+        result.isDecomposed = true;
+    }
+
+    return result;
+}
+
+void decomposeTransforms(ThreadPool &pool,
+                         const gsl::span<const AffineMatrix> matrices,
+                         const gsl::span<DecomposedTRS> results) {
+    decomposeTRS(pool, matrices, results);
+
+    for (ptrdiff_t index = 0; index < results.size(); ++index) {
+        if (!results[index].isDecomposed) {
+            results[index] = decomposeTransform(matrices[index]);
+        }
+    }
+}
+
+void assignTRS(GLTF::Node::TransformTRS &trs, const DecomposedTRS &decomposed) {
+    std::copy(decomposed.translation.begin(), decomposed.translation.end(),
+              trs.translation);
+    std::copy(decomposed.rotation.begin(), decomposed.rotation.end(),
+              trs.rotation);
+    std::copy(decomposed.scale.begin(), decomposed.scale.end(), trs.scale);
+}
+
+NodeTransformCache::Entry &
+NodeTransformCache::entry(const ExportableNode *node) {
+    // The references stay valid while the map grows.
+    auto &entry = m_table[node];
+
+    if (entry.generation != m_generation) {
+        entry.generation = m_generation;
+        entry.sample.state.isInitialized = 0;
+        entry.isDecomposed = false;
+        entry.hasLocalMatrix = false;
+        entry.hasWorldMatrix = false;
+    }
+
+    return entry;
+}
+
+bool NodeTransformCache::isDagLocalNode(const ExportableNode *node,
+                                        Entry &nodeEntry) {
+    if (nodeEntry.isDagLocal < 0) {
+        // When the parent node is the DAG parent, and the node inherits its
+        // transform, the transformation of the Maya node is the local matrix.
+        MStatus status;
+
+        auto dagParentPath = node->dagPath;
+        THROW_ON_FAILURE(dagParentPath.pop());
+
+        const auto isDagParent =
+            node->parentNode ? node->parentNode->dagPath == dagParentPath
+                             : dagParentPath.length() == 0;
+
+        MFnDagNode fnDagNode(node->dagPath, &status);
+        THROW_ON_FAILURE(status);
+
+        nodeEntry.isDagLocal = isDagParent && fnDagNode.inheritsTransform();
+    }
+
+    return nodeEntry.isDagLocal > 0;
+}
+
+const MMatrix &NodeTransformCache::localMatrix(const ExportableNode *node) {
+    MStatus status;
+
+    auto &nodeEntry = entry(node);
+    if (nodeEntry.hasLocalMatrix)
+        return nodeEntry.localMatrix;
+
+    if (isDagLocalNode(node, nodeEntry)) {
+        MFnDagNode fnDagNode(node->dagPath, &status);
+        THROW_ON_FAILURE(status);
+
+        nodeEntry.localMatrix = fnDagNode.transformationMatrix(&status);
+        THROW_ON_FAILURE(status);
+    } else if (node->parentNode) {
+        // A logical parent, or a node that doesn't inherit the transform of
+        // its DAG parent, still needs the inverse of the parent world matrix.
+        nodeEntry.localMatrix =
+            worldMatrix(node) * worldMatrix(node->parentNode).inverse();
+    } else {
+        nodeEntry.localMatrix = worldMatrix(node);
+    }
+
+    nodeEntry.hasLocalMatrix = true;
+    return nodeEntry.localMatrix;
+}
+
+const MMatrix &NodeTransformCache::worldMatrix(const ExportableNode *node) {
+    MStatus status;
+
+    auto &nodeEntry = entry(node);
+    if (nodeEntry.hasWorldMatrix)
+        return nodeEntry.worldMatrix;
+
+    if (!isDagLocalNode(node, nodeEntry)) {
+        nodeEntry.worldMatrix = node->dagPath.inclusiveMatrix(&status);
+        THROW_ON_FAILURE(status);
+    } else if (node->parentNode) {
+        // Maya uses row matrices, so the parent matrix comes last.
+        nodeEntry.worldMatrix =
+            localMatrix(node) * worldMatrix(node->parentNode);
+    } else {
+        nodeEntry.worldMatrix = localMatrix(node);
+    }
+
+    nodeEntry.hasWorldMatrix = true;
+    return nodeEntry.worldMatrix;
+}
+
 const NodeTransformState &
 NodeTransformCache::getTransform(const ExportableNode *node,
                                  const double scaleFactor) {
-    auto &state = m_table[node];
+    auto &nodeEntry = entry(node);
+
+    if (nodeEntry.isDecomposed)
+        return nodeEntry.state;
+
+    auto &sample = getSample(node, scaleFactor);
+    const auto decomposed = decomposeTransform(sample.matrix);
+
+    nodeEntry.state = sample.state;
+    nodeEntry.state.maxNonOrthogonality = decomposed.nonOrthogonality;
+    assignTRS(nodeEntry.state.localTransforms[sample.decomposedIndex],
+              decomposed);
+
+    nodeEntry.isDecomposed = true;
+    return nodeEntry.state;
+}
+
+Float3 NodeTransformCache::primaryScale(const ExportableNode *node,
+                                        const double scaleFactor) {
+    auto &nodeEntry = entry(node);
+    auto &sample = getSample(node, scaleFactor);
+
+    // The primary transform is not the sampled one, or is already known
+    if (sample.decomposedIndex != 0 || nodeEntry.isDecomposed) {
+        const auto &trs = nodeEntry.isDecomposed ? nodeEntry.state.primaryTRS()
+                                                 : sample.state.primaryTRS();
+        return {trs.scale[0], trs.scale[1], trs.scale[2]};
+    }
+
+    // Only the scale, the rotation is decomposed later with the samples
+    Float3 scale;
+    if (decomposeScale(sample.matrix, scale))
+        return scale;
+
+    const auto &trs = getTransform(node, scaleFactor).primaryTRS();
+    return {trs.scale[0], trs.scale[1], trs.scale[2]};
+}
+
+const NodeTransformSample &
+NodeTransformCache::getSample(const ExportableNode *node,
+                              const double scaleFactor) {
+    auto &sample = entry(node).sample;
+    auto &state = sample.state;
 
     if (state.isInitialized > 0)
-        return state;
+        return sample;
 
     if (state.isInitialized < 0)
         throw std::runtime_error(
             "Ouch! Infinite loop detected in NodeTransformCache");
 
     state.isInitialized = -1;
+    state.maxNonOrthogonality = 0;
 
     auto &trs0 = state.localTransforms[0];
     makeIdentity(trs0);
@@ -128,37 +271,26 @@ NodeTransformCache::getTransform(const ExportableNode *node,
     auto &trs1 = state.localTransforms[1];
     makeIdentity(trs1);
 
+    sample.decomposedIndex = 0;
+
     if (node == nullptr) {
         // World
         state.requiresExtraNode = false;
-        state.maxNonOrthogonality = 0;
+        sample.matrix = toAffineMatrix(MMatrix::identity, scaleFactor);
     } else {
         state.requiresExtraNode = node->transformKind != TransformKind::Simple;
 
-        const auto localMatrix =
-            getObjectSpaceMatrix(node->dagPath, node->parentDagPath());
+        const auto localMatrix = this->localMatrix(node);
 
         switch (node->transformKind) {
         case TransformKind::Simple: {
-            state.maxNonOrthogonality = getAxesNonOrthogonality(localMatrix);
-
-            // TODO: We're not using the GLTF code here yet, we got
-            // non-normalized rotations...
-            MTransformationMatrix mayaLocalMatrix(localMatrix);
-
-            auto &trs = state.localTransforms[0];
-
-            getTranslation(mayaLocalMatrix, trs.translation, scaleFactor);
-            getRotation(mayaLocalMatrix, trs.rotation);
-            getScaling(mayaLocalMatrix, trs.scale);
+            // The translation, rotation and scale of the first transform
+            sample.matrix = toAffineMatrix(localMatrix, scaleFactor);
         } break;
 
         case TransformKind::ComplexJoint: {
-            auto &parentTransform = getTransform(node->parentNode, scaleFactor);
-            auto &parentPrimaryTRS = parentTransform.primaryTRS();
-            double parentScale[3] = {parentPrimaryTRS.scale[0],
-                                     parentPrimaryTRS.scale[1],
-                                     parentPrimaryTRS.scale[2]};
+            const auto parentScale =
+                primaryScale(node->parentNode, scaleFactor);
 
             // The local matrix = scale * rotation * inverse-parent-scale *
             // translation Extract and clear the translation, undo  the inverse
@@ -175,11 +307,11 @@ NodeTransformCache::getTransform(const ExportableNode *node,
                 roundToFloat(t[2] * scaleFactor, posPrecision);
 
             trs1.scale[0] =
-                roundToFloat(1.0f / parentPrimaryTRS.scale[0], sclPrecision);
+                roundToFloat(1.0f / parentScale[0], sclPrecision);
             trs1.scale[1] =
-                roundToFloat(1.0f / parentPrimaryTRS.scale[1], sclPrecision);
+                roundToFloat(1.0f / parentScale[1], sclPrecision);
             trs1.scale[2] =
-                roundToFloat(1.0f / parentPrimaryTRS.scale[2], sclPrecision);
+                roundToFloat(1.0f / parentScale[2], sclPrecision);
 
             // Clear translation
             t[0] = t[1] = t[2] = 0;
@@ -192,11 +324,8 @@ NodeTransformCache::getTransform(const ExportableNode *node,
 
             m = m * ps;
 
-            state.maxNonOrthogonality = getAxesNonOrthogonality(m);
-
-            const MTransformationMatrix mayaLocalMatrix(m);
-            getRotation(mayaLocalMatrix, trs0.rotation);
-            getScaling(mayaLocalMatrix, trs0.scale);
+            // The rotation and scale of the first transform
+            sample.matrix = toAffineMatrix(m, scaleFactor);
         } break;
 
         case TransformKind::ComplexTransform: {
@@ -215,8 +344,6 @@ NodeTransformCache::getTransform(const ExportableNode *node,
             // => combinedMatrix = pivotMatrix * localMatrix
             const auto combinedMatrix = pivotMatrix * localMatrix;
 
-            state.maxNonOrthogonality = getAxesNonOrthogonality(combinedMatrix);
-
             // Inverse pivot translation node
             trs0.translation[0] =
                 roundToFloat(-pivotOffset.x * scaleFactor, posPrecision);
@@ -225,14 +352,9 @@ NodeTransformCache::getTransform(const ExportableNode *node,
             trs0.translation[2] =
                 roundToFloat(-pivotOffset.z * scaleFactor, posPrecision);
 
-            // TODO: We're not using the GLTF code here yet, we got
-            // non-normalized rotations...
-            const MTransformationMatrix mayaMatrix(combinedMatrix);
-
             // trs1: scale, rotation and translation + pivot-offset combined
-            getTranslation(mayaMatrix, trs1.translation, scaleFactor);
-            getRotation(mayaMatrix, trs1.rotation);
-            getScaling(mayaMatrix, trs1.scale);
+            sample.matrix = toAffineMatrix(combinedMatrix, scaleFactor);
+            sample.decomposedIndex = 1;
         } break;
 
         default:
@@ -242,5 +364,5 @@ NodeTransformCache::getTransform(const ExportableNode *node,
 
     state.isInitialized = 1;
 
-    return state;
+    return sample;
 }
@@ -1,12 +1,24 @@
 #pragma once
 
-const double MAX_NON_ORTHOGONALITY = 1e-4f;
+#include "TransformDecomposition.h"
 
 // How much the axes deviate from being orthogonal
 double getAxesNonOrthogonality(const MMatrix &m);
 
 void makeIdentity(GLTF::Node::TransformTRS &trs);
 
+/** The matrix as plain doubles, with the translation multiplied by the
+ * scale factor */
+AffineMatrix toAffineMatrix(const MMatrix &m, double scaleFactor);
+
+/** Decomposes the matrix, using Maya when the matrix is mirrored,
+ * degenerate or skewed. Must run on the main thread. */
+DecomposedTRS decomposeTransform(const AffineMatrix &matrix);
+
+/** Decomposes the matrices in bulk on the pool, and the few that need
+ * Maya afterwards on the calling thread */
+void decomposeTransforms(ThreadPool &pool, gsl::span<const AffineMatrix> matrices, gsl::span<DecomposedTRS> results);
+
 class ExportableNode;
 
 /*
@@ -89,6 +101,27 @@ class NodeTransformState {
     int isInitialized = 0;
 };
 
+/**
+ * The transform state of a node before its matrix is decomposed. The state
+ * holds all other values; the decomposition of the matrix becomes the local
+ * transform at decomposedIndex. Animation sampling only records these, and
+ * decomposes the matrices of all samples at once.
+ */
+class NodeTransformSample {
+  public:
+    NodeTransformState state;
+    AffineMatrix matrix;
+    size_t decomposedIndex = 0;
+
+    DEFAULT_COPY_MOVE_ASSIGN_CTOR_DTOR(NodeTransformSample);
+};
+
+/**
+ * The transforms of the nodes at the current Maya time. The local matrix
+ * of each node is fetched from Maya once; world matrices are only needed
+ * for nodes whose glTF parent is not their DAG parent, and are composed
+ * top-down through the parent nodes.
+ */
 class NodeTransformCache {
   public:
     NodeTransformCache() = default;
@@ -97,8 +130,45 @@ class NodeTransformCache {
     const NodeTransformState &getTransform(const ExportableNode *node,
                                            double scaleFactor);
 
+    /** The transform without decomposing the matrix of the node itself */
+    const NodeTransformSample &getSample(const ExportableNode *node,
+                                         double scaleFactor);
+
+    /** Forgets the transforms, after the Maya time changed. The table is
+     * kept, so sampling the next time doesn't allocate. */
+    void clear() { ++m_generation; }
+
   private:
     DISALLOW_COPY_MOVE_ASSIGN(NodeTransformCache);
 
-    std::unordered_map<const ExportableNode *, NodeTransformState> m_table;
+    struct Entry {
+        // The transforms are valid when this equals the cache generation
+        int generation = 0;
+
+        NodeTransformSample sample;
+
+        bool isDecomposed = false;
+        NodeTransformState state;
+
+        bool hasLocalMatrix = false;
+        MMatrix localMatrix;
+
+        bool hasWorldMatrix = false;
+        MMatrix worldMatrix;
+
+        // Is the local matrix the transformation of the Maya node itself?
+        // Doesn't change over time, so is kept across generations.
+        int isDagLocal = -1;
+    };
+
+    std::unordered_map<const ExportableNode *, Entry> m_table;
+    int m_generation = 1;
+
+    Entry &entry(const ExportableNode *node);
+    bool isDagLocalNode(const ExportableNode *node, Entry &nodeEntry);
+    const MMatrix &localMatrix(const ExportableNode *node);
+    const MMatrix &worldMatrix(const ExportableNode *node);
+
+    /** The scale of the primary transform, without decomposing the rotation */
+    Float3 primaryScale(const ExportableNode *node, double scaleFactor);
 };
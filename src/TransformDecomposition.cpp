@@ -0,0 +1,196 @@
+#include "coreExternals.h"
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "TransformDecomposition.h"
+
+namespace {
+// The matrices decomposed by a single pool task
+const size_t chunkMatrixCount = 4096;
+
+// Axes shorter than this are degenerate
+const double minAxisLength = 1e-12;
+
+struct Axis {
+    double x, y, z;
+
+    double dot(const Axis &other) const { return x * other.x + y * other.y + z * other.z; }
+    double length() const { return std::sqrt(dot(*this)); }
+};
+
+Axis axis(const AffineMatrix &matrix, const int row) { return {matrix.m[row][0], matrix.m[row][1], matrix.m[row][2]}; }
+
+Axis scaled(const Axis &a, const double factor) { return {a.x * factor, a.y * factor, a.z * factor}; }
+
+Axis subtracted(const Axis &a, const Axis &b, const double factor) {
+    return {a.x - b.x * factor, a.y - b.y * factor, a.z - b.z * factor};
+}
+
+Axis normalized(const Axis &a) {
+    const auto length = a.length();
+    return length > 0 ? scaled(a, 1 / length) : a;
+}
+
+double determinant(const Axis &x, const Axis &y, const Axis &z) {
+    return x.x * (y.y * z.z - y.z * z.y) - x.y * (y.x * z.z - y.z * z.x) + x.z * (y.x * z.y - y.y * z.x);
+}
+
+/** Splits the axes into orthonormal rotation rows and scales, removing the
+ * shear in the order Maya does, x then y then z, so the scale and rotation
+ * match MTransformationMatrix. False when Maya is needed. */
+bool orthonormalize(const AffineMatrix &matrix, const double nonOrthogonality, Axis (&rows)[3], double (&scales)[3]) {
+    const auto rx = axis(matrix, 0);
+    const auto ry = axis(matrix, 1);
+    const auto rz = axis(matrix, 2);
+
+    if (nonOrthogonality > MAX_NON_ORTHOGONALITY || determinant(rx, ry, rz) <= 0)
+        return false;
+
+    scales[0] = rx.length();
+    if (scales[0] < minAxisLength)
+        return false;
+
+    rows[0] = scaled(rx, 1 / scales[0]);
+
+    const auto uy = subtracted(ry, rows[0], rows[0].dot(ry));
+    scales[1] = uy.length();
+    if (scales[1] < minAxisLength)
+        return false;
+
+    rows[1] = scaled(uy, 1 / scales[1]);
+
+    const auto vz = subtracted(rz, rows[0], rows[0].dot(rz));
+    const auto uz = subtracted(vz, rows[1], rows[1].dot(vz));
+    scales[2] = uz.length();
+    if (scales[2] < minAxisLength)
+        return false;
+
+    rows[2] = scaled(uz, 1 / scales[2]);
+    return true;
+}
+
+void roundScales(const double (&scales)[3], Float3 &result) {
+    for (auto i = 0; i < 3; ++i) {
+        result[i] = roundToFloat(scales[i], sclPrecision);
+    }
+}
+} // namespace
+
+double axesNonOrthogonality(const AffineMatrix &matrix) {
+    const auto vx = normalized(axis(matrix, 0));
+    const auto vy = normalized(axis(matrix, 1));
+    const auto vz = normalized(axis(matrix, 2));
+
+    double e = 0;
+    e = std::max(e, std::abs(vx.dot(vy)));
+    e = std::max(e, std::abs(vy.dot(vz)));
+    e = std::max(e, std::abs(vz.dot(vx)));
+    return e;
+}
+
+DecomposedTRS decomposeTRS(const AffineMatrix &matrix) {
+    DecomposedTRS result;
+    result.nonOrthogonality = axesNonOrthogonality(matrix);
+
+    Axis rows[3];
+    double scales[3];
+    if (!orthonormalize(matrix, result.nonOrthogonality, rows, scales))
+        return result;
+
+    const auto &nx = rows[0];
+    const auto &ny = rows[1];
+    const auto &nz = rows[2];
+
+    // The quaternion of the rotation rows, taking the square root of the
+    // largest diagonal term for precision.
+    double q[4];
+    const auto trace = nx.x + ny.y + nz.z;
+
+    if (trace > 0) {
+        const auto s = std::sqrt(trace + 1) * 2;
+        q[0] = (ny.z - nz.y) / s;
+        q[1] = (nz.x - nx.z) / s;
+        q[2] = (nx.y - ny.x) / s;
+        q[3] = s / 4;
+    } else if (nx.x > ny.y && nx.x > nz.z) {
+        const auto s = std::sqrt(1 + nx.x - ny.y - nz.z) * 2;
+        q[0] = s / 4;
+        q[1] = (nx.y + ny.x) / s;
+        q[2] = (nz.x + nx.z) / s;
+        q[3] = (ny.z - nz.y) / s;
+    } else if (ny.y > nz.z) {
+        const auto s = std::sqrt(1 + ny.y - nx.x - nz.z) * 2;
+        q[0] = (nx.y + ny.x) / s;
+        q[1] = s / 4;
+        q[2] = (ny.z + nz.y) / s;
+        q[3] = (nz.x - nx.z) / s;
+    } else {
+        const auto s = std::sqrt(1 + nz.z - nx.x - ny.y) * 2;
+        q[0] = (nz.x + nx.z) / s;
+        q[1] = (ny.z + nz.y) / s;
+        q[2] = s / 4;
+        q[3] = (nx.y - ny.x) / s;
+    }
+
+    const double sign = q[3] < 0 ? -1 : 1;
+
+    double qLength = 0;
+    for (auto &c : q) {
+        c = roundTo(c * sign, dirPrecision);
+        qLength += c * c;
+    }
+
+    qLength = std::sqrt(qLength);
+
+    for (auto i = 0; i < 4; ++i) {
+        result.rotation[i] = static_cast<float>(q[i] / qLength);
+    }
+
+    for (auto i = 0; i < 3; ++i) {
+        result.translation[i] = roundToFloat(matrix.m[3][i], posPrecision);
+    }
+
+    roundScales(scales, result.scale);
+
+    result.isDecomposed = true;
+    return result;
+}
+
+bool decomposeScale(const AffineMatrix &matrix, Float3 &scale) {
+    Axis rows[3];
+    double scales[3];
+    if (!orthonormalize(matrix, axesNonOrthogonality(matrix), rows, scales))
+        return false;
+
+    roundScales(scales, scale);
+    return true;
+}
+
+void decomposeTRS(ThreadPool &pool, const gsl::span<const AffineMatrix> matrices, const gsl::span<DecomposedTRS> results) {
+    assert(matrices.size() == results.size());
+
+    const size_t matrixCount = matrices.size();
+
+    std::vector<std::future<void>> pendingChunks;
+    pendingChunks.reserve((matrixCount + chunkMatrixCount - 1) / chunkMatrixCount);
+
+    for (size_t offset = 0; offset < matrixCount; offset += chunkMatrixCount) {
+        const auto end = std::min(matrixCount, offset + chunkMatrixCount);
+
+        pendingChunks.emplace_back(pool.submit([matrices, results, offset, end]() {
+            PROFILE_SCOPE("clip.decomposeChunk");
+            for (auto index = offset; index < end; ++index) {
+                results[index] = decomposeTRS(matrices[index]);
+            }
+        }));
+    }
+
+    // The chunks write to the results, so wait for all before rethrowing
+    for (auto &pending : pendingChunks) {
+        pending.wait();
+    }
+
+    for (auto &pending : pendingChunks) {
+        pending.get();
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "BasicTypes.h"
+
+class ThreadPool;
+
+/** Larger deviations of orthogonal axes are reported as skewing */
+const double MAX_NON_ORTHOGONALITY = 1e-4f;
+
+/**
+ * A Maya matrix as plain doubles, so it can be decomposed without Maya:
+ * row-major and for row vectors, so the last row holds the translation.
+ */
+struct AffineMatrix {
+    double m[4][4];
+};
+
+/** The glTF translation, rotation and scale of an affine matrix */
+struct DecomposedTRS {
+    Float3 translation = {0, 0, 0};
+    Float4 rotation = {0, 0, 0, 1};
+    Float3 scale = {1, 1, 1};
+
+    // How much the axes deviate from being orthogonal
+    double nonOrthogonality = 0;
+
+    // False when the matrix is mirrored, degenerate or skewed beyond
+    // MAX_NON_ORTHOGONALITY, these need the decomposition of Maya.
+    bool isDecomposed = false;
+};
+
+/** How much the axes deviate from being orthogonal, the largest absolute
+ * cosine between two axes */
+double axesNonOrthogonality(const AffineMatrix &matrix);
+
+/**
+ * Decomposes the matrix into translation, rotation and scale, like
+ * MTransformationMatrix does for a matrix without shear, and rounds
+ * these like the exporter. The rotation has a non-negative w.
+ */
+DecomposedTRS decomposeTRS(const AffineMatrix &matrix);
+
+/** Only the scale of decomposeTRS, without the rotation. False when the
+ * matrix is not decomposed */
+bool decomposeScale(const AffineMatrix &matrix, Float3 &scale);
+
+/** Decomposes the matrices in chunks on the pool, and waits for these */
+void decomposeTRS(ThreadPool &pool, gsl::span<const AffineMatrix> matrices, gsl::span<DecomposedTRS> results);
@@ -0,0 +1,334 @@
+#include "coreExternals.h"
+
+#include "VertexCacheOptimizer.h"
+
+namespace {
+/** Simulates a FIFO post-transform cache, returning the misses of each triangle */
+class FifoCache {
+  public:
+    explicit FifoCache(const size_t vertexCount) : m_timestamps(vertexCount, 0) {}
+
+    void reset() { m_time += vertexCacheSimulationSize + 1; }
+
+    int transform(const Index *triangle) {
+        int misses = 0;
+        for (int corner = 0; corner < 3; ++corner) {
+            auto &timestamp = m_timestamps[triangle[corner]];
+            if (m_time - timestamp >= vertexCacheSimulationSize || timestamp == 0) {
+                timestamp = ++m_time;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+  private:
+    std::vector<size_t> m_timestamps;
+    size_t m_time = vertexCacheSimulationSize + 1;
+};
+
+// The scoring constants of Forsyth's article.
+const int forsythCacheSize = 32;
+const float cacheDecayPower = 1.5f;
+const float lastTriangleScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+
+float vertexScore(const int cachePosition, const int liveTriangleCount) {
+    if (liveTriangleCount == 0)
+        return -1;
+
+    float score = 0;
+
+    if (cachePosition >= 0) {
+        // The vertices of the last triangle get a fixed score, so the
+        // order of emitting its neighbours doesn't depend on its winding.
+        score = cachePosition < 3 ? lastTriangleScore
+                                  : std::pow(1.0f - float(cachePosition - 3) / (forsythCacheSize - 3),
+                                             cacheDecayPower);
+    }
+
+    // Favour vertices with few remaining triangles, to avoid leaving
+    // isolated triangles that later need their vertices transformed again.
+    score += valenceBoostScale * std::pow(float(liveTriangleCount), -valenceBoostPower);
+    return score;
+}
+} // namespace
+
+VertexCacheStatistics &VertexCacheStatistics::operator+=(const VertexCacheStatistics &other) {
+    triangleCount += other.triangleCount;
+    vertexCount += other.vertexCount;
+    cacheMissCount += other.cacheMissCount;
+    return *this;
+}
+
+VertexCacheStatistics analyzeVertexCache(const gsl::span<const Index> indices, const size_t vertexCount) {
+    VertexCacheStatistics statistics;
+    statistics.triangleCount = size_t(indices.size()) / 3;
+    statistics.vertexCount = vertexCount;
+
+    FifoCache cache(vertexCount);
+    for (size_t triangle = 0; triangle < statistics.triangleCount; ++triangle) {
+        statistics.cacheMissCount += cache.transform(&indices[triangle * 3]);
+    }
+
+    return statistics;
+}
+
+void optimizeVertexCache(const gsl::span<Index> indices, const size_t vertexCount) {
+    const auto triangleCount = size_t(indices.size()) / 3;
+    if (triangleCount <= 1)
+        return;
+
+    // The triangles adjacent to each vertex, as offsets into one array.
+    std::vector<int> liveTriangleCounts(vertexCount, 0);
+    for (auto index : indices) {
+        ++liveTriangleCounts[index];
+    }
+
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangleCounts[vertex];
+    }
+
+    std::vector<size_t> adjacentTriangles(indices.size());
+    {
+        auto fillOffsets = adjacencyOffsets;
+        for (size_t corner = 0; corner < size_t(indices.size()); ++corner) {
+            adjacentTriangles[fillOffsets[indices[corner]]++] = corner / 3;
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+        vertexScores[vertex] = vertexScore(-1, liveTriangleCounts[vertex]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        const auto *corners = &indices[triangle * 3];
+        triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+    }
+
+    std::vector<bool> isEmitted(triangleCount, false);
+    IndexVector emittedIndices;
+    emittedIndices.reserve(indices.size());
+
+    // Holds up to 3 vertices more than the cache, that drop out after each triangle.
+    std::vector<Index> cache;
+    std::vector<Index> nextCache;
+    cache.reserve(forsythCacheSize + 3);
+    nextCache.reserve(forsythCacheSize + 3);
+
+    size_t nextUnemittedTriangle = 0;
+    auto bestTriangle = std::numeric_limits<size_t>::max();
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        if (bestTriangle == std::numeric_limits<size_t>::max()) {
+            // No triangle touches the cache, continue with the next one in the original order.
+            while (isEmitted[nextUnemittedTriangle]) {
+                ++nextUnemittedTriangle;
+            }
+            bestTriangle = nextUnemittedTriangle;
+        }
+
+        const auto *corners = &indices[bestTriangle * 3];
+        isEmitted[bestTriangle] = true;
+
+        nextCache.clear();
+        for (int corner = 0; corner < 3; ++corner) {
+            const auto vertex = corners[corner];
+            emittedIndices.push_back(vertex);
+            --liveTriangleCounts[vertex];
+            nextCache.push_back(vertex);
+        }
+
+        for (auto vertex : cache) {
+            if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+                nextCache.push_back(vertex);
+            }
+        }
+
+        // Update the scores of the vertices that moved in or dropped out of the cache.
+        for (size_t position = 0; position < nextCache.size(); ++position) {
+            const auto vertex = nextCache[position];
+            cachePositions[vertex] = position < forsythCacheSize ? int(position) : -1;
+
+            const auto score = vertexScore(cachePositions[vertex], liveTriangleCounts[vertex]);
+            const auto delta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            for (auto offset = adjacencyOffsets[vertex]; offset < adjacencyOffsets[vertex + 1]; ++offset) {
+                triangleScores[adjacentTriangles[offset]] += delta;
+            }
+        }
+
+        if (nextCache.size() > forsythCacheSize) {
+            nextCache.resize(forsythCacheSize);
+        }
+        std::swap(cache, nextCache);
+
+        // The next triangle is the best one that uses a cached vertex.
+        bestTriangle = std::numeric_limits<size_t>::max();
+        auto bestScore = -1.0f;
+
+        for (auto vertex : cache) {
+            for (auto offset = adjacencyOffsets[vertex]; offset < adjacencyOffsets[vertex + 1]; ++offset) {
+                const auto triangle = adjacentTriangles[offset];
+                if (!isEmitted[triangle] && triangleScores[triangle] > bestScore) {
+                    bestScore = triangleScores[triangle];
+                    bestTriangle = triangle;
+                }
+            }
+        }
+    }
+
+    std::copy(emittedIndices.begin(), emittedIndices.end(), indices.begin());
+}
+
+void optimizeOverdraw(const gsl::span<Index> indices, const gsl::span<const Position> positions,
+                      const double threshold) {
+    const auto triangleCount = size_t(indices.size()) / 3;
+    if (triangleCount <= 1)
+        return;
+
+    const auto vertexCount = size_t(positions.size());
+
+    // Hard boundaries: triangles that miss all their vertices don't benefit
+    // from the cache state of the preceding triangles.
+    std::vector<int> triangleMisses(triangleCount);
+    std::vector<size_t> hardBoundaries;
+    {
+        FifoCache cache(vertexCount);
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+            triangleMisses[triangle] = cache.transform(&indices[triangle * 3]);
+            if (triangle == 0 || triangleMisses[triangle] == 3) {
+                hardBoundaries.push_back(triangle);
+            }
+        }
+        hardBoundaries.push_back(triangleCount);
+    }
+
+    // Soft boundaries: split a cluster as soon as its cache miss ratio
+    // from a cold cache drops to the threshold times that of the whole cluster.
+    std::vector<size_t> boundaries;
+    {
+        FifoCache cache(vertexCount);
+        for (size_t cluster = 0; cluster + 1 < hardBoundaries.size(); ++cluster) {
+            const auto clusterStart = hardBoundaries[cluster];
+            const auto clusterEnd = hardBoundaries[cluster + 1];
+
+            const auto clusterMisses =
+                std::accumulate(&triangleMisses[clusterStart], &triangleMisses[clusterStart] + (clusterEnd - clusterStart), 0);
+            const auto maxRatio = threshold * clusterMisses / double(clusterEnd - clusterStart);
+
+            auto start = clusterStart;
+            auto misses = 0;
+            boundaries.push_back(start);
+            cache.reset();
+
+            for (auto triangle = clusterStart; triangle + 1 < clusterEnd; ++triangle) {
+                misses += cache.transform(&indices[triangle * 3]);
+                if (misses <= maxRatio * double(triangle + 1 - start)) {
+                    start = triangle + 1;
+                    misses = 0;
+                    boundaries.push_back(start);
+                    cache.reset();
+                }
+            }
+        }
+        boundaries.push_back(triangleCount);
+    }
+
+    const auto clusterCount = boundaries.size() - 1;
+
+    // The area weighted centroid and normal of each cluster, and of the mesh.
+    typedef std::array<double, 3> Vector;
+    std::vector<Vector> clusterCentroids(clusterCount, Vector{0, 0, 0});
+    std::vector<Vector> clusterNormals(clusterCount, Vector{0, 0, 0});
+    std::vector<double> clusterAreas(clusterCount, 0);
+    Vector meshCentroid{0, 0, 0};
+    double meshArea = 0;
+
+    for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+        for (auto triangle = boundaries[cluster]; triangle < boundaries[cluster + 1]; ++triangle) {
+            const auto &p0 = positions[indices[triangle * 3 + 0]];
+            const auto &p1 = positions[indices[triangle * 3 + 1]];
+            const auto &p2 = positions[indices[triangle * 3 + 2]];
+
+            const Vector e1{double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2]};
+            const Vector e2{double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2]};
+            const Vector normal{e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                                e1[0] * e2[1] - e1[1] * e2[0]};
+            const auto area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            for (int axis = 0; axis < 3; ++axis) {
+                const auto center = (double(p0[axis]) + p1[axis] + p2[axis]) / 3;
+                clusterCentroids[cluster][axis] += center * area;
+                clusterNormals[cluster][axis] += normal[axis];
+                meshCentroid[axis] += center * area;
+            }
+
+            clusterAreas[cluster] += area;
+            meshArea += area;
+        }
+    }
+
+    if (meshArea <= 0)
+        return;
+
+    for (auto &component : meshCentroid) {
+        component /= meshArea;
+    }
+
+    // Clusters that face outwards most occlude the others, so draw them first.
+    std::vector<double> sortKeys(clusterCount, 0);
+    for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+        const auto &normal = clusterNormals[cluster];
+        const auto length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length > 0 && clusterAreas[cluster] > 0) {
+            double key = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                key += (clusterCentroids[cluster][axis] / clusterAreas[cluster] - meshCentroid[axis]) * normal[axis];
+            }
+            sortKeys[cluster] = key / length;
+        }
+    }
+
+    std::vector<size_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+                     [&sortKeys](const size_t a, const size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    IndexVector sortedIndices;
+    sortedIndices.reserve(indices.size());
+    for (auto cluster : clusterOrder) {
+        sortedIndices.insert(sortedIndices.end(), &indices[boundaries[cluster] * 3],
+                             &indices[boundaries[cluster] * 3] + (boundaries[cluster + 1] - boundaries[cluster]) * 3);
+    }
+
+    std::copy(sortedIndices.begin(), sortedIndices.end(), indices.begin());
+}
+
+IndexVector optimizeVertexFetch(const gsl::span<Index> indices, const size_t vertexCount) {
+    IndexVector newVertexIndices(vertexCount, -1);
+    Index nextVertexIndex = 0;
+
+    for (auto &index : indices) {
+        auto &newIndex = newVertexIndices[index];
+        if (newIndex < 0) {
+            newIndex = nextVertexIndex++;
+        }
+        index = newIndex;
+    }
+
+    // Unreferenced vertices keep their relative order, after all others.
+    for (auto &newIndex : newVertexIndices) {
+        if (newIndex < 0) {
+            newIndex = nextVertexIndex++;
+        }
+    }
+
+    return newVertexIndices;
+}
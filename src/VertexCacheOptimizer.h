@@ -0,0 +1,47 @@
+#pragma once
+
+#include "sceneTypes.h"
+
+/** The post-transform vertex cache efficiency of a triangle list, as
+ * simulated with a FIFO cache of vertexCacheSimulationSize entries */
+struct VertexCacheStatistics {
+    size_t triangleCount = 0;
+    size_t vertexCount = 0;
+    size_t cacheMissCount = 0;
+
+    /** Average cache miss ratio: transformed vertices per triangle, 0.5 at best */
+    double acmr() const { return triangleCount ? double(cacheMissCount) / triangleCount : 0; }
+
+    /** Average transform to vertex ratio: 1 at best */
+    double atvr() const { return vertexCount ? double(cacheMissCount) / vertexCount : 0; }
+
+    VertexCacheStatistics &operator+=(const VertexCacheStatistics &other);
+};
+
+const size_t vertexCacheSimulationSize = 16;
+
+VertexCacheStatistics analyzeVertexCache(gsl::span<const Index> indices, size_t vertexCount);
+
+/**
+ * Reorders the triangles of a triangle list for the post-transform vertex
+ * cache, using Tom Forsyth's linear-speed vertex cache optimisation.
+ */
+void optimizeVertexCache(gsl::span<Index> indices, size_t vertexCount);
+
+/**
+ * Reorders clusters of the cache optimized triangles, so that triangles
+ * facing away from the mesh center are drawn first, reducing overdraw
+ * from all view directions (Sander, Nehab and Barczak, "Fast triangle
+ * reordering for vertex locality and reduced overdraw"). Clusters are
+ * split where the cache miss ratio stays within threshold times the
+ * ratio of the unsplit order, so a threshold of 1 keeps the cache
+ * efficiency, and larger thresholds trade it for less overdraw.
+ */
+void optimizeOverdraw(gsl::span<Index> indices, gsl::span<const Position> positions, double threshold);
+
+/**
+ * Renumbers the vertices in the order the indices first reference them,
+ * so vertex fetches are sequential. Returns the new index of each old
+ * vertex, to permute the vertex data with.
+ */
+IndexVector optimizeVertexFetch(gsl::span<Index> indices, size_t vertexCount);
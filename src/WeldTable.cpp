@@ -0,0 +1,143 @@
+#include "coreExternals.h"
+
+#include "MeshTables.h"
+#include "WeldTable.h"
+
+namespace {
+const uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+
+inline uint64_t mix(const uint64_t hash, const uint64_t word) {
+    const auto h = (hash ^ word) * multiplier;
+    return h ^ (h >> 29);
+}
+
+inline size_t slotCountFor(const size_t count) {
+    // Keep the load factor below 1/2
+    size_t slotCount = 16;
+    while (slotCount < count * 2) {
+        slotCount <<= 1;
+    }
+    return slotCount;
+}
+} // namespace
+
+uint64_t hashWeldKey(const byte *data, const size_t length) {
+    uint64_t hash = length * multiplier;
+
+    size_t offset = 0;
+
+    // Hash 4 independent lanes, so the multiplications can overlap.
+    if (length >= 4 * sizeof(uint64_t)) {
+        uint64_t lanes[4] = {hash, hash + 1, hash + 2, hash + 3};
+        for (; offset + 4 * sizeof(uint64_t) <= length;
+             offset += 4 * sizeof(uint64_t)) {
+            uint64_t words[4];
+            std::memcpy(words, data + offset, sizeof(words));
+            lanes[0] = mix(lanes[0], words[0]);
+            lanes[1] = mix(lanes[1], words[1]);
+            lanes[2] = mix(lanes[2], words[2]);
+            lanes[3] = mix(lanes[3], words[3]);
+        }
+        hash = mix(mix(mix(lanes[0], lanes[1]), lanes[2]), lanes[3]);
+    }
+
+    for (; offset + sizeof(uint64_t) <= length; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + offset, sizeof(word));
+        hash = mix(hash, word);
+    }
+
+    if (offset < length) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + offset, length - offset);
+        hash = mix(hash, word);
+    }
+
+    hash ^= hash >> 32;
+    hash *= multiplier;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+WeldTable::WeldTable(const size_t expectedCount) {
+    m_hashes.reserve(expectedCount);
+    rehash(slotCountFor(expectedCount));
+}
+
+WeldTable::~WeldTable() = default;
+
+Index WeldTable::find(const gsl::span<const byte> &key) const {
+    const size_t length = key.size();
+
+    if (m_hashes.empty() || length != m_keyLength)
+        return NoIndex;
+
+    const auto hash = hashWeldKey(key.data(), length);
+
+    for (auto slot = hash & m_mask;; slot = (slot + 1) & m_mask) {
+        const auto index = m_slots[slot];
+        if (index == NoIndex)
+            return NoIndex;
+
+        if (m_hashes[index] == hash &&
+            std::memcmp(m_keys.data() + index * length, key.data(), length) == 0)
+            return index;
+    }
+}
+
+Index WeldTable::findOrInsert(const gsl::span<const byte> &key,
+                              bool &isNew) {
+    const size_t length = key.size();
+
+    if (m_hashes.empty()) {
+        m_keyLength = length;
+        m_keys.reserve(m_hashes.capacity() * length);
+    } else if (length != m_keyLength) {
+        throw std::runtime_error("All weld keys must have the same length");
+    }
+
+    const auto hash = hashWeldKey(key.data(), length);
+
+    auto slot = hash & m_mask;
+
+    for (;; slot = (slot + 1) & m_mask) {
+        const auto index = m_slots[slot];
+        if (index == NoIndex)
+            break;
+
+        if (m_hashes[index] == hash &&
+            std::memcmp(m_keys.data() + index * length, key.data(), length) == 0) {
+            isNew = false;
+            return index;
+        }
+    }
+
+    const auto index = static_cast<Index>(m_hashes.size());
+    m_hashes.push_back(hash);
+    m_keys.insert(m_keys.end(), key.begin(), key.end());
+    m_slots[slot] = index;
+
+    if (m_hashes.size() * 2 > m_slots.size()) {
+        rehash(m_slots.size() * 2);
+    }
+
+    isNew = true;
+    return index;
+}
+
+gsl::span<const byte> WeldTable::keyAt(const Index index) const {
+    return gsl::make_span(m_keys.data() + index * m_keyLength, m_keyLength);
+}
+
+void WeldTable::rehash(const size_t slotCount) {
+    m_slots.assign(slotCount, NoIndex);
+    m_mask = slotCount - 1;
+
+    for (size_t index = 0; index < m_hashes.size(); ++index) {
+        auto slot = m_hashes[index] & m_mask;
+        while (m_slots[slot] != NoIndex) {
+            slot = (slot + 1) & m_mask;
+        }
+        m_slots[slot] = static_cast<Index>(index);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "macros.h"
+#include "sceneTypes.h"
+
+/** A fast word-wise hash of a byte key, used by the weld table */
+uint64_t hashWeldKey(const byte *data, size_t length);
+
+/**
+ * Maps vertex keys (the concatenated component bytes of a vertex) to
+ * consecutive vertex indices, used for welding identical vertices.
+ * Unlike an std::unordered_map of byte vectors, the keys are stored
+ * inline in a single arena, and lookups use open addressing with linear
+ * probing, so inserting a key does not allocate.
+ * All keys in one table must have the same length, which is the case
+ * for the vertices of a vertex buffer, since these share a layout.
+ */
+class WeldTable {
+  public:
+    explicit WeldTable(size_t expectedCount = 0);
+    ~WeldTable();
+
+    /** The number of unique keys */
+    size_t size() const { return m_hashes.size(); }
+
+    /** Finds the index of the key, or NoIndex when not present */
+    Index find(const gsl::span<const byte> &key) const;
+
+    /** Finds the index of the key, adding it when not present. */
+    Index findOrInsert(const gsl::span<const byte> &key, bool &isNew);
+
+    /** The key that was inserted with the given index */
+    gsl::span<const byte> keyAt(Index index) const;
+
+    DEFAULT_COPY_MOVE_ASSIGN(WeldTable);
+
+  private:
+    size_t m_keyLength = 0;
+    size_t m_mask = 0;
+
+    std::vector<byte> m_keys;
+    std::vector<uint64_t> m_hashes;
+
+    // Power-of-two sized slots, holding NoIndex or an index into m_hashes
+    std::vector<Index> m_slots;
+
+    void rehash(size_t slotCount);
+};
@@ -0,0 +1 @@
+#include "coreExternals.h"
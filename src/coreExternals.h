@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#define LINUX
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4267)
+#endif
+
+#include "Base64.h"
+#include <GLTFAccessor.h>
+#include <GLTFAsset.h>
+#include <GLTFBuffer.h>
+#include <GLTFBufferView.h>
+#include <GLTFMesh.h>
+#include <GLTFPrimitive.h>
+#include <GLTFScene.h>
+#include <GLTFTargetNames.h>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996)
+#pragma warning(default : 4267)
+#endif
+#include "rapidjson/document.h"
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <gsl/span>
+
+#include <coveo/enumerable.h>
+#include <coveo/linq.h>
+
+// Maya's MIOStream.h brings these into the global namespace;
+// the core library must compile without Maya, so we do it ourselves.
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ios;
+using std::ostream;
@@ -5,23 +5,37 @@
 #include "OutputStreamsPatch.h"
 #include "version.h"
 #include <maya/MFnPlugin.h>
+#include <maya/MSceneMessage.h>
 
 #if _DEBUG
 static OutputStreamsPatch<char> patch;
 #endif
 
+static MCallbackId exitingCallbackId = 0;
+
+// Flush the files of asynchronous exports before Maya quits
+static void onMayaExiting(void *) { Exporter::finishOutput(); }
+
 MStatus initializePlugin(MObject obj) {
     MStatus status;
     MFnPlugin plugin(obj, "IIM Maya to glTF 2.0 exporter", version, "Any");
     status = plugin.registerCommand("maya2glTF", Exporter::createInstance,
                                     SyntaxFactory::createSyntax);
     CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    exitingCallbackId = MSceneMessage::addCallback(
+        MSceneMessage::kMayaExiting, onMayaExiting, nullptr, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
     return status;
 }
 
 MStatus uninitializePlugin(MObject obj) {
     MStatus status;
     MFnPlugin plugin(obj);
+
+    MMessage::removeCallback(exitingCallbackId);
+    Exporter::finishOutput();
+
     status = plugin.deregisterCommand("maya2glTF");
     CHECK_MSTATUS_AND_RETURN_IT(status);
     return status;
@@ -1,4 +1,4 @@
-#include "externals.h"
+#include "coreExternals.h"
 
 #include "sceneTypes.h"
 
@@ -0,0 +1,698 @@
+#include "coreExternals.h"
+
+#include "AccessorPacker.h"
+#include "BufferHash.h"
+#include "CoreArguments.h"
+#include "ExportablePrimitive.h"
+#include "GlbWriter.h"
+#include "IndentableStream.h"
+#include "MeshQuantization.h"
+#include "MeshRenderables.h"
+#include "SkinEncoding.h"
+#include "SyntheticClip.h"
+#include "SyntheticMesh.h"
+#include "ThreadPool.h"
+#include "TransformDecomposition.h"
+
+/**
+ * Times the hot paths of the export one at a time on a synthetic scene,
+ * serially, and reports the median and fastest run of each. The results
+ * can be written as CSV, and compared against the CSV of an earlier run,
+ * failing when a benchmark got slower than the threshold allows.
+ */
+
+namespace {
+// Changes of less than this are noise, whatever the threshold.
+const double noiseMilliseconds = 0.05;
+
+const char *csvHeader = "benchmark,median_ms,min_ms";
+
+struct BenchmarkOptions {
+    SyntheticMeshOptions mesh;
+    int frameCount = 300;
+    int stepSampleCount = 0;
+    int repeatCount = 5;
+    double threshold = 10;
+    std::string filter;
+    std::string resultsPath;
+    std::string baselinePath;
+
+    BenchmarkOptions() {
+        mesh.triangleCount = 2 * 128 * 128;
+        mesh.targetCount = 4;
+        mesh.jointCount = 64;
+        mesh.influenceCount = 4;
+        mesh.mikkTSpace = true;
+    }
+
+    /** The parameters that change the work, a baseline must match these */
+    std::string parameters() const {
+        std::ostringstream ss;
+        ss << "triangles=" << mesh.triangleCount
+           << " targets=" << mesh.targetCount << " joints=" << mesh.jointCount
+           << " influences=" << mesh.influenceCount
+           << " frames=" << frameCount << " step=" << stepSampleCount;
+        return ss.str();
+    }
+};
+
+const char *usage =
+    "ExportBenchmark [options]\n"
+    "  -triangles <n>   approximate triangle count of the mesh\n"
+    "  -targets <n>     number of blend-shape targets\n"
+    "  -joints <n>      number of animated and skinned joints\n"
+    "  -influences <n>  joints that weigh each vertex, 0 for no skin\n"
+    "  -frames <n>      number of animation frames\n"
+    "  -step <n>        step detection super-samples per frame\n"
+    "  -repeat <n>      timed runs per benchmark\n"
+    "  -filter <text>   only time the benchmarks whose name contains text\n"
+    "  -results <path>  write the results as CSV\n"
+    "  -baseline <path> compare against the CSV results of an earlier run\n"
+    "  -threshold <p>   fail when a benchmark is p percent slower than the\n"
+    "                   baseline, 10 by default\n";
+
+void parse(int argc, char **argv, BenchmarkOptions &options) {
+    for (auto i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for " + flag);
+        }
+
+        const std::string value = argv[++i];
+
+        if (flag == "-filter") {
+            options.filter = value;
+        } else if (flag == "-results") {
+            options.resultsPath = value;
+        } else if (flag == "-baseline") {
+            options.baselinePath = value;
+        } else if (flag == "-threshold") {
+            options.threshold = std::stod(value);
+        } else if (flag == "-triangles") {
+            options.mesh.triangleCount = std::stoul(value);
+        } else if (flag == "-targets") {
+            options.mesh.targetCount = std::stoi(value);
+        } else if (flag == "-joints") {
+            options.mesh.jointCount = std::stoi(value);
+        } else if (flag == "-influences") {
+            options.mesh.influenceCount = std::stoi(value);
+        } else if (flag == "-frames") {
+            options.frameCount = std::stoi(value);
+        } else if (flag == "-step") {
+            options.stepSampleCount = std::stoi(value);
+        } else if (flag == "-repeat") {
+            options.repeatCount = std::max(1, std::stoi(value));
+        } else {
+            throw std::runtime_error("Unknown flag " + flag);
+        }
+    }
+}
+
+struct BenchmarkResult {
+    std::string name;
+    double medianMilliseconds;
+    double minMilliseconds;
+};
+
+typedef std::vector<BenchmarkResult> BenchmarkResults;
+
+/** Runs each benchmark repeatCount times, timing only its action */
+class BenchmarkRunner {
+  public:
+    BenchmarkRunner(const int repeatCount, std::string filter)
+        : m_repeatCount(repeatCount), m_filter(std::move(filter)) {}
+
+    /** The untimed setup prepares the state of each run of the action.
+     * Benchmarks left out by the filter still run once, untimed, since
+     * later benchmarks can depend on their results. */
+    template <typename Setup, typename Action>
+    void run(const std::string &name, Setup &&setup, Action &&action) {
+        if (name.find(m_filter) == std::string::npos) {
+            setup();
+            action();
+            return;
+        }
+
+        std::vector<double> durations;
+        durations.reserve(m_repeatCount);
+
+        for (auto run = 0; run < m_repeatCount; ++run) {
+            setup();
+            const auto start = std::chrono::steady_clock::now();
+            action();
+            const auto end = std::chrono::steady_clock::now();
+            durations.push_back(
+                std::chrono::duration<double, std::milli>(end - start)
+                    .count());
+        }
+
+        std::sort(durations.begin(), durations.end());
+        m_results.push_back(
+            {name, durations[(durations.size() - 1) / 2], durations.front()});
+    }
+
+    template <typename Action>
+    void run(const std::string &name, Action &&action) {
+        run(name, []() {}, std::forward<Action>(action));
+    }
+
+    const BenchmarkResults &results() const { return m_results; }
+
+  private:
+    const int m_repeatCount;
+    const std::string m_filter;
+    BenchmarkResults m_results;
+};
+
+/**
+ * The joint assignments of each point, like MeshSkeleton gathers these
+ * from a skin cluster: the given number of joints, in no particular
+ * order, with random unnormalized weights.
+ */
+std::vector<std::vector<VertexJointAssignment>>
+randomJointAssignments(const size_t pointCount, const int jointCount,
+                       const int influenceCount) {
+    // A fixed xorshift generator, the standard distributions differ
+    // between compilers, and so would the baselines.
+    uint32_t state = 0x9E3779B9;
+    const auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    std::vector<std::vector<VertexJointAssignment>> table(pointCount);
+    for (auto &assignments : table) {
+        assignments.reserve(influenceCount);
+        for (auto index = 0; index < influenceCount; ++index) {
+            const auto joint = int(next() % uint32_t(jointCount));
+            const auto weight = 0.01f + (next() % 1000) / 1000.0f;
+            assignments.emplace_back(joint, weight);
+        }
+    }
+
+    return table;
+}
+
+/**
+ * Sorts the assignments of each point, like MeshSkeleton does, and packs
+ * these into JOINTS and WEIGHTS sets, like MeshVertices does.
+ */
+JointWeightSets packJointWeightSets(
+    std::vector<std::vector<VertexJointAssignment>> &assignments) {
+    const auto elementSize = array_size<JointIndices>::size;
+
+    VertexJointAssignmentTable table;
+    table.reserve(assignments.size());
+
+    size_t maxAssignmentCount = 0;
+    for (auto &vertexAssignments : assignments) {
+        selectJointAssignments(vertexAssignments, 0);
+        maxAssignmentCount =
+            std::max(maxAssignmentCount, vertexAssignments.size());
+        table.emplace_back(span(vertexAssignments));
+    }
+
+    const auto setCount = (maxAssignmentCount + elementSize - 1) / elementSize;
+    return JointWeightSets::fromAssignments(table, setCount);
+}
+
+/** The TRS samples of all joints, for all frames and super-samples */
+struct JointSamples {
+    std::vector<std::array<float, 3>> translations;
+    std::vector<std::array<float, 4>> rotations;
+    std::vector<std::array<float, 3>> scales;
+
+    JointSamples(const size_t jointCount, const size_t sampleCount) {
+        const auto count = jointCount * sampleCount;
+        translations.reserve(count);
+        rotations.reserve(count);
+        scales.reserve(count);
+
+        for (size_t index = 0; index < count; ++index) {
+            const auto t = index * 0.01;
+            const auto angle = 0.5 * std::sin(2 * t);
+            const auto s = static_cast<float>(1 + 0.1 * std::sin(t));
+
+            translations.push_back(
+                {static_cast<float>(std::sin(3 * t)), 0, 0});
+            // Flip every other rotation, so the hemisphere check has work
+            const auto sign = index % 2 ? -1.0f : 1.0f;
+            rotations.push_back({0, sign * static_cast<float>(std::sin(angle)),
+                                 0, sign * static_cast<float>(std::cos(angle))});
+            scales.push_back({s, s, s});
+        }
+    }
+};
+
+/** The local matrices of the joint samples, as sampled from Maya */
+std::vector<AffineMatrix> sampledMatrices(const JointSamples &samples) {
+    std::vector<AffineMatrix> matrices(samples.rotations.size());
+
+    for (size_t index = 0; index < matrices.size(); ++index) {
+        const auto &t = samples.translations[index];
+        const auto &q = samples.rotations[index];
+        const auto &s = samples.scales[index];
+
+        // The float quaternion is not exactly unit length, which would
+        // leak into the scale.
+        const auto qLength =
+            std::sqrt(double(q[0]) * q[0] + double(q[1]) * q[1] +
+                      double(q[2]) * q[2] + double(q[3]) * q[3]);
+        const double x = q[0] / qLength, y = q[1] / qLength,
+                     z = q[2] / qLength, w = q[3] / qLength;
+
+        // Scale then rotate, for row vectors
+        const double rotation[3][3] = {
+            {1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y)},
+            {2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x)},
+            {2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y)}};
+
+        auto &m = matrices[index].m;
+        for (auto row = 0; row < 3; ++row) {
+            for (auto column = 0; column < 3; ++column) {
+                m[row][column] = s[row] * rotation[row][column];
+            }
+            m[row][3] = 0;
+            m[3][row] = t[row];
+        }
+        m[3][3] = 1;
+    }
+
+    return matrices;
+}
+
+/** Throws when a value is off by more than the rounding of the exporter */
+void verifyComponent(const char *name, const size_t index,
+                     const double actual, const double expected,
+                     const double precision) {
+    const auto tolerance = 1 / precision +
+                           std::numeric_limits<float>::epsilon() *
+                               std::max(1.0, std::abs(expected));
+
+    if (std::abs(actual - expected) > tolerance) {
+        std::ostringstream ss;
+        ss << "Decomposed " << name << " of sample " << index << " is "
+           << actual << ", expected " << expected;
+        throw std::runtime_error(ss.str());
+    }
+}
+
+/** Checks that decomposing the sampled matrices gives back the samples */
+void verifyDecomposition(const JointSamples &samples,
+                         const std::vector<DecomposedTRS> &decomposed) {
+    for (size_t index = 0; index < decomposed.size(); ++index) {
+        const auto &trs = decomposed[index];
+        if (!trs.isDecomposed)
+            throw std::runtime_error("Sample " + std::to_string(index) +
+                                     " was not decomposed");
+
+        const auto &q = samples.rotations[index];
+        const auto qLength =
+            std::sqrt(double(q[0]) * q[0] + double(q[1]) * q[1] +
+                      double(q[2]) * q[2] + double(q[3]) * q[3]);
+
+        // The decomposed rotation has a non-negative w
+        const auto qScale = (q[3] < 0 ? -1 : 1) / qLength;
+
+        for (auto i = 0; i < 3; ++i) {
+            verifyComponent("translation", index, trs.translation[i],
+                            samples.translations[index][i], posPrecision);
+            verifyComponent("scale", index, trs.scale[i],
+                            samples.scales[index][i], sclPrecision);
+        }
+
+        for (auto i = 0; i < 4; ++i) {
+            verifyComponent("rotation", index, trs.rotation[i],
+                            q[i] * qScale, dirPrecision);
+        }
+    }
+}
+
+void writeResults(const std::string &path, const std::string &parameters,
+                  const BenchmarkResults &results) {
+    std::ofstream out(path, ios::out | ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Couldn't write to '" + path + "'");
+    }
+
+    out << "# " << parameters << "\n" << csvHeader << "\n";
+    out << std::fixed << std::setprecision(4);
+    for (auto &result : results) {
+        out << result.name << "," << result.medianMilliseconds << ","
+            << result.minMilliseconds << "\n";
+    }
+
+    if (!out) {
+        throw std::runtime_error("Failed to write '" + path + "'");
+    }
+}
+
+BenchmarkResults readResults(const std::string &path,
+                             const std::string &parameters) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Couldn't read '" + path + "'");
+    }
+
+    std::string line;
+    if (!std::getline(in, line) || line != "# " + parameters) {
+        throw std::runtime_error("The baseline '" + path +
+                                 "' was not run with " + parameters);
+    }
+
+    if (!std::getline(in, line) || line != csvHeader) {
+        throw std::runtime_error("The baseline '" + path +
+                                 "' is not an ExportBenchmark CSV file");
+    }
+
+    BenchmarkResults results;
+    while (std::getline(in, line)) {
+        if (line.empty())
+            continue;
+
+        std::istringstream fields(line);
+        BenchmarkResult result;
+        std::string median;
+        std::string min;
+        if (!std::getline(fields, result.name, ',') ||
+            !std::getline(fields, median, ',') ||
+            !std::getline(fields, min, ',')) {
+            throw std::runtime_error("Invalid line in '" + path +
+                                     "': " + line);
+        }
+
+        result.medianMilliseconds = std::stod(median);
+        result.minMilliseconds = std::stod(min);
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+/** Prints the results, compared to the baseline when not empty, and
+ * returns the number of regressions */
+int report(const BenchmarkResults &results, const BenchmarkResults &baseline,
+           const double threshold) {
+    int regressionCount = 0;
+
+    cout << prefix << std::left << std::setw(18) << "benchmark" << std::right
+         << std::setw(12) << "median ms" << std::setw(12) << "min ms";
+    if (!baseline.empty()) {
+        cout << std::setw(12) << "baseline" << std::setw(10) << "change";
+    }
+    cout << endl;
+
+    for (auto &result : results) {
+        cout << prefix << std::left << std::setw(18) << result.name
+             << std::right << std::fixed << std::setprecision(3)
+             << std::setw(12) << result.medianMilliseconds << std::setw(12)
+             << result.minMilliseconds;
+
+        const auto it = std::find_if(
+            baseline.begin(), baseline.end(),
+            [&result](auto &base) { return base.name == result.name; });
+
+        if (it != baseline.end()) {
+            const auto before = it->medianMilliseconds;
+            const auto after = result.medianMilliseconds;
+            const auto change =
+                before > 0 ? (after - before) * 100 / before : 0;
+
+            cout << std::setw(12) << before << std::setw(9)
+                 << std::setprecision(1) << std::showpos << change
+                 << std::noshowpos << "%";
+
+            if (change > threshold && after - before > noiseMilliseconds) {
+                cout << "  REGRESSION";
+                ++regressionCount;
+            }
+        } else if (!baseline.empty()) {
+            cout << std::setw(12) << "-";
+        }
+
+        cout << endl;
+    }
+
+    return regressionCount;
+}
+
+BenchmarkResults runBenchmarks(const BenchmarkOptions &options) {
+    CoreArguments args;
+    args.meshPrimitiveAttributes.set();
+    args.blendPrimitiveAttributes.set(Semantic::POSITION);
+    args.blendPrimitiveAttributes.set(Semantic::NORMAL);
+    args.blendPrimitiveAttributes.set(Semantic::TANGENT);
+    args.mikkelsenTangentAngularThreshold = 180;
+    args.detectStepAnimations = options.stepSampleCount;
+
+    BenchmarkRunner runner(options.repeatCount, options.filter);
+
+    // Serial, so the timings don't depend on the machine's core count.
+    ThreadPool serialPool(0);
+
+    SyntheticMesh mesh("mesh", options.mesh);
+
+    const auto contexts = mesh.mikkTSpaceContexts();
+    runner.run("mesh.tangents", [&]() {
+        computeTangents(serialPool, contexts,
+                        args.mikkelsenTangentAngularThreshold);
+    });
+
+    mesh.releaseTargetVertices(args.blendShapeTolerance);
+    const auto geometry = mesh.geometry();
+
+    std::unique_ptr<MeshRenderables> renderables;
+    runner.run(
+        "mesh.weld", [&]() { renderables.reset(); },
+        [&]() {
+            renderables = std::make_unique<MeshRenderables>(geometry, args);
+        });
+
+    if (options.mesh.influenceCount > 0 && options.mesh.jointCount > 0) {
+        const auto pointCount =
+            geometry.mainVertices->at(Semantic::POSITION).at(0).floats().size() /
+            3;
+        const auto sourceAssignments =
+            randomJointAssignments(size_t(pointCount), options.mesh.jointCount,
+                                   options.mesh.influenceCount);
+
+        std::vector<std::vector<VertexJointAssignment>> assignments;
+        JointWeightSets sets;
+
+        runner.run(
+            "skin.packSets", [&]() { assignments = sourceAssignments; },
+            [&]() { sets = packJointWeightSets(assignments); });
+
+        runner.run("skin.quantize", [&]() {
+            for (auto &&pair : renderables->table()) {
+                for (auto &part : pair.second) {
+                    QuantizedJointWeights::fromVertexBuffer(
+                        part, args.jointWeightQuantizationError);
+                }
+            }
+        });
+    }
+
+    SyntheticSkeleton skeleton(options.mesh.jointCount);
+    const size_t stepSampleCount = args.getStepDetectSampleCount();
+
+    if (options.mesh.jointCount > 0 && options.frameCount > 0) {
+        ExportableFrames frames(args.makeName("clip/anim/frames"),
+                                options.frameCount, 30.0);
+        const JointSamples samples(skeleton.glJoints.size(),
+                                   options.frameCount * stepSampleCount);
+
+        std::vector<std::unique_ptr<PropAnimation>> props;
+        std::unique_ptr<SampleStore> store;
+
+        runner.run(
+            "anim.append",
+            [&]() {
+                props.clear();
+                store = std::make_unique<SampleStore>();
+                for (auto &glJoint : skeleton.glJoints) {
+                    props.emplace_back(std::make_unique<PropAnimation>(
+                        frames, *store, *glJoint,
+                        GLTF::Animation::Path::TRANSLATION, 3, stepSampleCount,
+                        false));
+                    props.emplace_back(std::make_unique<PropAnimation>(
+                        frames, *store, *glJoint,
+                        GLTF::Animation::Path::ROTATION, 4, stepSampleCount,
+                        false));
+                    props.emplace_back(std::make_unique<PropAnimation>(
+                        frames, *store, *glJoint,
+                        GLTF::Animation::Path::SCALE, 3, stepSampleCount,
+                        false));
+                }
+                store->allocate();
+            },
+            [&]() {
+                size_t sampleIndex = 0;
+                for (auto frame = 0; frame < options.frameCount; ++frame) {
+                    for (size_t superSample = 0; superSample < stepSampleCount;
+                         ++superSample) {
+                        for (size_t joint = 0; joint * 3 < props.size();
+                             ++joint, ++sampleIndex) {
+                            props[joint * 3]->append(
+                                gsl::span<const float, 3>(
+                                    samples.translations[sampleIndex]),
+                                superSample);
+                            props[joint * 3 + 1]->appendQuaternion(
+                                gsl::span<const float, 4>(
+                                    samples.rotations[sampleIndex]),
+                                int(superSample));
+                            props[joint * 3 + 2]->append(
+                                gsl::span<const float, 3>(
+                                    samples.scales[sampleIndex]),
+                                superSample);
+                        }
+                    }
+                }
+            });
+
+        const auto matrices = sampledMatrices(samples);
+        std::vector<DecomposedTRS> decomposed(matrices.size());
+
+        runner.run("anim.decompose", [&]() {
+            decomposeTRS(serialPool, span(matrices), gsl::make_span(decomposed));
+        });
+
+        verifyDecomposition(samples, decomposed);
+
+        std::unique_ptr<SyntheticClip> clip;
+
+        runner.run(
+            "anim.finish",
+            [&]() {
+                clip.reset();
+                clip = std::make_unique<SyntheticClip>(
+                    "clip", skeleton, options.frameCount, 30.0, args);
+                clip->sample();
+            },
+            [&]() { clip->finish(); });
+    }
+
+    GLTF::Asset glAsset;
+    GLTF::Scene glScene;
+    GLTF::Material glMaterial;
+    GLTF::Mesh glMesh;
+    GLTF::Node glNode;
+
+    glAsset.scenes.push_back(&glScene);
+    glAsset.scene = 0;
+    glMesh.weights.resize(options.mesh.targetCount, 0);
+    glNode.mesh = &glMesh;
+    glScene.nodes.push_back(&glNode);
+
+    std::vector<std::unique_ptr<ExportablePrimitive>> primitives;
+    std::vector<GLTF::Accessor *> accessors;
+    std::unique_ptr<AccessorPacker> packer;
+    GLTF::Buffer *buffer = nullptr;
+
+    // Packing assigns the accessors to the views of the packer, so each
+    // run packs the accessors of new primitives.
+    runner.run(
+        "asset.pack",
+        [&]() {
+            buffer = nullptr;
+            packer.reset();
+            accessors.clear();
+            glMesh.primitives.clear();
+            primitives.clear();
+
+            const PositionQuantization positionQuantization;
+            for (auto &&pair : renderables->table()) {
+                for (auto &part : pair.second) {
+                    primitives.emplace_back(
+                        std::make_unique<ExportablePrimitive>(
+                            "primitive", part, args, &glMaterial, false,
+                            positionQuantization, nullptr));
+                    primitives.back()->getAllAccessors(accessors);
+                    glMesh.primitives.push_back(
+                        &primitives.back()->glPrimitive);
+                }
+            }
+
+            packer = std::make_unique<AccessorPacker>(false);
+        },
+        [&]() { buffer = packer->packAccessors(accessors, "data"); });
+
+    const auto *data = buffer ? buffer->data : nullptr;
+    const size_t byteLength = buffer ? buffer->byteLength : 0;
+
+    GLTF::Options glOptions;
+    glOptions.embeddedBuffers = true;
+    glOptions.binary = true;
+    glOptions.name = "benchmark";
+
+    rapidjson::StringBuffer jsonStringBuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(jsonStringBuffer);
+    jsonWriter.StartObject();
+    glAsset.writeJSON(&jsonWriter, &glOptions);
+    jsonWriter.EndObject();
+    const std::string json = jsonStringBuffer.GetString();
+
+    runner.run("glb.write", [&]() {
+        std::ostringstream stream;
+        writeGLB(stream, json, data, byteLength);
+    });
+
+    runner.run("hash.sha256", [&]() {
+        BufferHash(serialPool, data, byteLength, BufferHash::SHA256).hex();
+    });
+
+    runner.run("hash.fast128", [&]() {
+        BufferHash(serialPool, data, byteLength, BufferHash::FAST128).hex();
+    });
+
+    return runner.results();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    BenchmarkOptions options;
+
+    try {
+        parse(argc, argv, options);
+    } catch (const std::exception &ex) {
+        cerr << ex.what() << endl << usage;
+        return 1;
+    }
+
+    try {
+        const auto parameters = options.parameters();
+
+        // Read the baseline first, so a mismatch fails before the runs.
+        BenchmarkResults baseline;
+        if (!options.baselinePath.empty()) {
+            baseline = readResults(options.baselinePath, parameters);
+        }
+
+        cout << prefix << "Running " << parameters << ", "
+             << options.repeatCount << " run(s) per benchmark" << endl;
+
+        const auto results = runBenchmarks(options);
+
+        if (!options.resultsPath.empty()) {
+            writeResults(options.resultsPath, parameters, results);
+        }
+
+        const auto regressionCount =
+            report(results, baseline, options.threshold);
+
+        if (regressionCount > 0) {
+            cerr << prefix << regressionCount
+                 << " benchmark(s) regressed more than " << options.threshold
+                 << "% from the baseline" << endl;
+            return 3;
+        }
+    } catch (const std::exception &ex) {
+        cerr << prefix << "Benchmark failed: " << ex.what() << endl;
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include "coreExternals.h"
+
+#include "IndentableStream.h"
+#include "SyntheticClip.h"
+
+namespace {
+void makeRestPose(GLTF::Node::TransformTRS &trs, const int jointIndex) {
+    trs.translation[0] = static_cast<float>(jointIndex);
+    trs.translation[1] = 0;
+    trs.translation[2] = 0;
+    trs.rotation[0] = 0;
+    trs.rotation[1] = 0;
+    trs.rotation[2] = 0;
+    trs.rotation[3] = 1;
+    trs.scale[0] = 1;
+    trs.scale[1] = 1;
+    trs.scale[2] = 1;
+}
+
+// PropAnimation::append deduces the extent of a span of const floats.
+template <std::ptrdiff_t N>
+gsl::span<const float, N> constSpan(const float (&values)[N]) {
+    return gsl::make_span(values);
+}
+} // namespace
+
+SyntheticSkeleton::SyntheticSkeleton(const int jointCount) {
+    glRoot.name = "root";
+
+    glJoints.reserve(jointCount);
+    restPoses.reserve(jointCount);
+
+    for (auto jointIndex = 0; jointIndex < jointCount; ++jointIndex) {
+        auto restPose = std::make_unique<GLTF::Node::TransformTRS>();
+        makeRestPose(*restPose, jointIndex);
+
+        auto glJoint = std::make_unique<GLTF::Node>();
+        glJoint->name = "joint" + std::to_string(jointIndex);
+        glJoint->transform = restPose.get();
+
+        glRoot.children.push_back(glJoint.get());
+        glJoints.emplace_back(std::move(glJoint));
+        restPoses.emplace_back(std::move(restPose));
+    }
+}
+
+SyntheticSkeleton::~SyntheticSkeleton() = default;
+
+SyntheticClip::SyntheticClip(const std::string &name,
+                             const SyntheticSkeleton &skeleton,
+                             const int frameCount,
+                             const double framesPerSecond,
+                             const CoreArguments &args)
+    : m_skeleton(skeleton), m_args(args), m_framesPerSecond(framesPerSecond),
+      m_phase(std::hash<std::string>()(name) % 1000 / 1000.0),
+      m_frames(args.makeName(name + "/anim/frames"), frameCount,
+               framesPerSecond) {
+    glAnimation.name = name;
+
+    const size_t stepDetectSampleCount = args.getStepDetectSampleCount();
+
+    m_props.resize(skeleton.glJoints.size());
+
+    for (size_t jointIndex = 0; jointIndex < m_props.size(); ++jointIndex) {
+        auto &node = *skeleton.glJoints[jointIndex];
+        auto &props = m_props[jointIndex];
+        props.positions = std::make_unique<PropAnimation>(
+            m_frames, m_samples, node, GLTF::Animation::Path::TRANSLATION, 3,
+            stepDetectSampleCount, false);
+        props.rotations = std::make_unique<PropAnimation>(
+            m_frames, m_samples, node, GLTF::Animation::Path::ROTATION, 4,
+            stepDetectSampleCount, false);
+        props.scales = std::make_unique<PropAnimation>(
+            m_frames, m_samples, node, GLTF::Animation::Path::SCALE, 3,
+            stepDetectSampleCount, false);
+    }
+
+    m_samples.allocate();
+}
+
+SyntheticClip::~SyntheticClip() = default;
+
+void SyntheticClip::sample() {
+    const size_t stepDetectSampleCount = m_args.getStepDetectSampleCount();
+    const auto superSampleFrameRate = stepDetectSampleCount * m_framesPerSecond;
+    const size_t frameCount = m_frames.count;
+
+    for (size_t relativeFrameIndex = 0; relativeFrameIndex < frameCount;
+         ++relativeFrameIndex) {
+        for (size_t superSampleIndex = 0;
+             superSampleIndex < stepDetectSampleCount; ++superSampleIndex) {
+            const double relativeFrameTime =
+                (relativeFrameIndex * stepDetectSampleCount +
+                 superSampleIndex) /
+                superSampleFrameRate;
+
+            for (size_t jointIndex = 0; jointIndex < m_props.size();
+                 ++jointIndex) {
+                auto &props = m_props[jointIndex];
+                auto &rest = *m_skeleton.restPoses[jointIndex];
+
+                const auto t = relativeFrameTime + m_phase + jointIndex * 0.1;
+                const auto angle = 0.5 * std::sin(2 * t);
+
+                float translation[3] = {
+                    rest.translation[0],
+                    rest.translation[1] +
+                        static_cast<float>(0.25 * std::sin(3 * t)),
+                    rest.translation[2]};
+
+                float rotation[4] = {0, static_cast<float>(std::sin(angle)), 0,
+                                     static_cast<float>(std::cos(angle))};
+
+                float scale[3] = {rest.scale[0], rest.scale[1], rest.scale[2]};
+
+                if (jointIndex % 3 == 2) {
+                    std::copy_n(rest.rotation, 4, rotation);
+                }
+
+                if (jointIndex % 4 == 3) {
+                    const auto s = static_cast<float>(1 + 0.1 * std::sin(t));
+                    scale[0] = scale[1] = scale[2] = s;
+                }
+
+                props.positions->append(constSpan(translation),
+                                        superSampleIndex);
+                props.rotations->appendQuaternion(gsl::make_span(rotation),
+                                                  superSampleIndex);
+                props.scales->append(constSpan(scale), superSampleIndex);
+            }
+        }
+    }
+}
+
+void SyntheticClip::finish() {
+    for (size_t jointIndex = 0; jointIndex < m_props.size(); ++jointIndex) {
+        auto &props = m_props[jointIndex];
+        auto &rest = *m_skeleton.restPoses[jointIndex];
+
+        finish(jointIndex, "T", props.positions,
+               m_args.constantTranslationThreshold,
+               gsl::make_span(rest.translation));
+        finish(jointIndex, "R", props.rotations,
+               m_args.constantRotationThreshold,
+               gsl::make_span(rest.rotation));
+        finish(jointIndex, "S", props.scales, m_args.constantScalingThreshold,
+               gsl::make_span(rest.scale));
+    }
+}
+
+void SyntheticClip::finish(const size_t jointIndex, const char *propName,
+                           std::unique_ptr<PropAnimation> &animatedProp,
+                           const double constantThreshold,
+                           const gsl::span<const float> &baseValues) {
+    const auto isConstant =
+        animatedProp->isConstant(baseValues, constantThreshold);
+
+    if (isConstant && !m_args.forceAnimationSampling &&
+        !m_args.forceAnimationChannels) {
+        animatedProp.reset();
+        return;
+    }
+
+    const auto useSingleKey = isConstant && !m_args.forceAnimationSampling;
+    auto interpolation = "LINEAR";
+
+    std::vector<bool> heldFrames;
+
+    if (!useSingleKey && m_args.getStepDetectSampleCount() > 1) {
+        heldFrames = animatedProp->heldFrames(constantThreshold);
+        if (std::all_of(heldFrames.begin(), heldFrames.end(),
+                        [](bool isHeld) { return isHeld; })) {
+            interpolation = "STEP";
+        }
+    }
+
+    const auto &node = *m_skeleton.glJoints[jointIndex];
+    animatedProp->finish(
+        m_args.makeName(node.name + "/anim/" + glAnimation.name + "/" +
+                        propName),
+        useSingleKey, interpolation,
+        m_args.getKeyframeTolerance(animatedProp->glTarget.path), heldFrames);
+    glAnimation.channels.push_back(&animatedProp->glChannel);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreArguments.h"
+#include "ExportableFrames.h"
+#include "PropAnimation.h"
+
+/** A flat hierarchy of joints, each with a rest pose */
+class SyntheticSkeleton {
+  public:
+    explicit SyntheticSkeleton(int jointCount);
+    ~SyntheticSkeleton();
+
+    GLTF::Node glRoot;
+    std::vector<std::unique_ptr<GLTF::Node>> glJoints;
+    std::vector<std::unique_ptr<GLTF::Node::TransformTRS>> restPoses;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(SyntheticSkeleton);
+};
+
+/**
+ * Samples procedural TRS curves for every joint of a skeleton, and turns
+ * these into glTF channels the same way NodeAnimation does: constant
+ * channels are dropped, and step detection is done when enabled.
+ * Every third joint only translates, the scale of every fourth joint
+ * animates, so both constant and animated channels are produced.
+ */
+class SyntheticClip {
+  public:
+    SyntheticClip(const std::string &name, const SyntheticSkeleton &skeleton,
+                  int frameCount, double framesPerSecond,
+                  const CoreArguments &args);
+    ~SyntheticClip();
+
+    GLTF::Animation glAnimation;
+
+    /** Samples all joints at all frames (and step-detection super-samples) */
+    void sample();
+
+    /** Creates the glTF channels and accessors of the animated props */
+    void finish();
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(SyntheticClip);
+
+    struct JointProps {
+        std::unique_ptr<PropAnimation> positions;
+        std::unique_ptr<PropAnimation> rotations;
+        std::unique_ptr<PropAnimation> scales;
+    };
+
+    const SyntheticSkeleton &m_skeleton;
+    const CoreArguments &m_args;
+    const double m_framesPerSecond;
+    const double m_phase;
+
+    ExportableFrames m_frames;
+    SampleStore m_samples;
+    std::vector<JointProps> m_props;
+
+    void finish(size_t jointIndex, const char *propName,
+                std::unique_ptr<PropAnimation> &animatedProp,
+                double constantThreshold,
+                const gsl::span<const float> &baseValues);
+};
@@ -0,0 +1,353 @@
+#include "coreExternals.h"
+
+#include "SkinEncoding.h"
+#include "SyntheticMesh.h"
+
+SyntheticMesh::SyntheticMesh(std::string name,
+                             const SyntheticMeshOptions &options)
+    : name(std::move(name)) {
+    const auto quadsPerSide = std::max(
+        1, static_cast<int>(std::ceil(std::sqrt(options.triangleCount / 2.0))));
+    const auto pointsPerSide = quadsPerSide + 1;
+    const auto pointCount = pointsPerSide * pointsPerSide;
+    const auto shaderCount = std::max(1, options.shaderCount);
+
+    m_primitiveCount = quadsPerSide * quadsPerSide * 2;
+
+    // Two triangles per quad, all elements are shared per point.
+    IndexVector cornerIndices;
+    cornerIndices.reserve(m_primitiveCount * 3);
+    m_primitiveToShaderIndexMap.reserve(m_primitiveCount);
+
+    for (auto row = 0; row < quadsPerSide; ++row) {
+        const auto shaderIndex = row * shaderCount / quadsPerSide;
+
+        for (auto col = 0; col < quadsPerSide; ++col) {
+            const auto p00 = row * pointsPerSide + col;
+            const auto p01 = p00 + 1;
+            const auto p10 = p00 + pointsPerSide;
+            const auto p11 = p10 + 1;
+
+            cornerIndices.insert(cornerIndices.end(), {p00, p10, p11});
+            cornerIndices.insert(cornerIndices.end(), {p00, p11, p01});
+
+            m_primitiveToShaderIndexMap.push_back(shaderIndex);
+            m_primitiveToShaderIndexMap.push_back(shaderIndex);
+        }
+    }
+
+    m_indices.at(Semantic::POSITION).push_back(cornerIndices);
+    m_indices.at(Semantic::NORMAL).push_back(cornerIndices);
+    if (!options.mikkTSpace) {
+        m_indices.at(Semantic::TANGENT).push_back(cornerIndices);
+    }
+
+    for (auto setIndex = 0; setIndex < options.uvSetCount; ++setIndex) {
+        m_indices.at(Semantic::TEXCOORD).push_back(cornerIndices);
+    }
+
+    for (auto setIndex = 0; setIndex < options.colorSetCount; ++setIndex) {
+        m_indices.at(Semantic::COLOR).push_back(cornerIndices);
+    }
+
+    m_shapeVertices.resize(1 + std::max(0, options.targetCount));
+    m_shapeComponents.resize(m_shapeVertices.size());
+
+    const auto step = 1.0f / quadsPerSide;
+
+    FloatVector positions;
+    FloatVector normals;
+    FloatVector tangents;
+    positions.reserve(pointCount * 3);
+    normals.reserve(pointCount * 3);
+    tangents.reserve(pointCount * 4);
+
+    for (auto row = 0; row < pointsPerSide; ++row) {
+        for (auto col = 0; col < pointsPerSide; ++col) {
+            positions.insert(positions.end(), {col * step, 0, row * step});
+            normals.insert(normals.end(), {0, 1, 0});
+            tangents.insert(tangents.end(), {1, 0, 0, 1});
+        }
+    }
+
+    addComponents(0, Semantic::POSITION, std::move(positions));
+    addComponents(0, Semantic::NORMAL, std::move(normals));
+    if (!options.mikkTSpace) {
+        addComponents(0, Semantic::TANGENT, std::move(tangents));
+    }
+
+    for (auto setIndex = 0; setIndex < options.uvSetCount; ++setIndex) {
+        FloatVector uvs;
+        uvs.reserve(pointCount * 2);
+
+        const auto scale = 1.0f + setIndex;
+        for (auto row = 0; row < pointsPerSide; ++row) {
+            for (auto col = 0; col < pointsPerSide; ++col) {
+                uvs.insert(uvs.end(), {col * step * scale, row * step * scale});
+            }
+        }
+
+        addComponents(0, Semantic::TEXCOORD, std::move(uvs));
+    }
+
+    for (auto setIndex = 0; setIndex < options.colorSetCount; ++setIndex) {
+        FloatVector colors;
+        colors.reserve(pointCount * 4);
+
+        for (auto row = 0; row < pointsPerSide; ++row) {
+            for (auto col = 0; col < pointsPerSide; ++col) {
+                colors.insert(colors.end(), {col * step, row * step,
+                                             setIndex * 0.25f, 1});
+            }
+        }
+
+        addComponents(0, Semantic::COLOR, std::move(colors));
+    }
+
+    // Each target ripples a square patch of the grid with a different
+    // frequency, the rest of the grid is not moved.
+    const auto extent = std::clamp(options.targetExtent, 0.0f, 1.0f);
+
+    for (auto targetIndex = 0; targetIndex < options.targetCount;
+         ++targetIndex) {
+        const auto shapeIndex = targetIndex + 1;
+        const auto frequency = 3.14159265f * (targetIndex + 1);
+        const auto patchX =
+            std::fmod(targetIndex * 0.618034f, 1.0f) * (1 - extent);
+        const auto patchZ =
+            std::fmod(targetIndex * 0.381966f, 1.0f) * (1 - extent);
+
+        FloatVector targetPositions;
+        FloatVector targetNormals;
+        FloatVector targetTangents;
+        targetPositions.reserve(pointCount * 3);
+        targetNormals.reserve(pointCount * 3);
+        targetTangents.reserve(pointCount * 3);
+
+        for (auto row = 0; row < pointsPerSide; ++row) {
+            for (auto col = 0; col < pointsPerSide; ++col) {
+                const auto x = col * step;
+                const auto z = row * step;
+                const auto isMoved = x >= patchX && x <= patchX + extent &&
+                                     z >= patchZ && z <= patchZ + extent;
+                const auto y = isMoved ? 0.1f * std::sin(frequency * x) *
+                                             std::cos(frequency * z)
+                                       : 0.0f;
+                const auto dx = isMoved ? 0.1f * frequency *
+                                              std::cos(frequency * x) *
+                                              std::cos(frequency * z)
+                                        : 0.0f;
+                const auto length = std::sqrt(1 + dx * dx);
+
+                targetPositions.insert(targetPositions.end(), {x, y, z});
+                targetNormals.insert(targetNormals.end(),
+                                     {-dx / length, 1 / length, 0});
+                targetTangents.insert(targetTangents.end(),
+                                      {1 / length, dx / length, 0});
+            }
+        }
+
+        addComponents(shapeIndex, Semantic::POSITION,
+                      std::move(targetPositions));
+        addComponents(shapeIndex, Semantic::NORMAL, std::move(targetNormals));
+        if (!options.mikkTSpace) {
+            addComponents(shapeIndex, Semantic::TANGENT,
+                          std::move(targetTangents));
+        }
+    }
+
+    if (options.mikkTSpace) {
+        addMikkTSpaceTangents(options.uvSetCount);
+    }
+
+    if (options.jointCount > 0 && options.influenceCount > 0) {
+        addSkin(pointsPerSide, options.jointCount, options.influenceCount,
+                options.maxInfluenceCount);
+    }
+}
+
+SyntheticMesh::~SyntheticMesh() = default;
+
+MeshGeometry SyntheticMesh::geometry() const {
+    MeshGeometry geometry;
+    geometry.name = name;
+    geometry.instanceNumber = 0;
+    geometry.perPrimitiveVertexCount = 3;
+    geometry.primitiveCount = m_primitiveCount;
+    geometry.indices = &m_indices;
+    geometry.primitiveToShaderIndexMap = &m_primitiveToShaderIndexMap;
+
+    geometry.mainVertices = &m_shapeVertices.at(0);
+
+    for (auto &deltas : m_targetDeltas) {
+        geometry.targetDeltas.emplace_back(&deltas);
+    }
+
+    return geometry;
+}
+
+void SyntheticMesh::releaseTargetVertices(const double tolerance) {
+    const auto shapeCount = m_shapeVertices.size();
+
+    for (size_t shapeIndex = 1 + m_targetDeltas.size();
+         shapeIndex < shapeCount; ++shapeIndex) {
+        m_targetDeltas.emplace_back(sparseTargetDeltas(
+            m_shapeVertices.at(0), m_shapeVertices.at(shapeIndex),
+            ShapeIndex::shape(shapeIndex), tolerance));
+        m_shapeVertices.at(shapeIndex) = VertexElementsPerSetIndexTable();
+        m_shapeComponents.at(shapeIndex).clear();
+    }
+
+    // The tangents of the targets are released too.
+    m_mikkTSpaceContexts.erase(
+        std::remove_if(m_mikkTSpaceContexts.begin(),
+                       m_mikkTSpaceContexts.end(),
+                       [](const std::unique_ptr<MikkTSpaceContext> &context) {
+                           return context->shapeIndex.isBlendShapeIndex();
+                       }),
+        m_mikkTSpaceContexts.end());
+}
+
+std::vector<MikkTSpaceContext *> SyntheticMesh::mikkTSpaceContexts() const {
+    std::vector<MikkTSpaceContext *> contexts;
+    for (auto &context : m_mikkTSpaceContexts) {
+        contexts.emplace_back(context.get());
+    }
+    return contexts;
+}
+
+void SyntheticMesh::addMikkTSpaceTangents(const int uvSetCount) {
+    // MikkTSpace outputs a tangent per face-vertex.
+    const auto cornerCount = m_primitiveCount * 3;
+
+    for (auto setIndex = 0; setIndex < uvSetCount; ++setIndex) {
+        auto &tangentIndices = m_indices.at(Semantic::TANGENT);
+        tangentIndices.push_back(m_indices.at(Semantic::POSITION).at(0));
+        MikkTSpaceContext::reindexTangents(gsl::make_span(tangentIndices.back()));
+    }
+
+    for (size_t shapeIndex = 0; shapeIndex < m_shapeVertices.size();
+         ++shapeIndex) {
+        const auto shape = ShapeIndex::shape(shapeIndex);
+        const auto &vertices = m_shapeVertices.at(shapeIndex);
+
+        for (auto setIndex = 0; setIndex < uvSetCount; ++setIndex) {
+            addComponents(shapeIndex, Semantic::TANGENT,
+                          FloatVector(cornerCount *
+                                      dimension(Semantic::TANGENT, shape)));
+
+            // The targets share the texture coordinates of the main shape.
+            const MikkTSpaceIndices indices{
+                span(m_indices.at(Semantic::POSITION).at(0)),
+                span(m_indices.at(Semantic::NORMAL).at(0)),
+                span(m_indices.at(Semantic::TEXCOORD).at(setIndex)),
+                span(m_indices.at(Semantic::TANGENT).at(setIndex))};
+
+            const MikkTSpaceVectors vectors{
+                reinterpret_span<Position>(
+                    vertices.at(Semantic::POSITION).at(0).floats()),
+                reinterpret_span<Normal>(
+                    vertices.at(Semantic::NORMAL).at(0).floats()),
+                reinterpret_span<TexCoord>(m_shapeVertices.at(0)
+                                               .at(Semantic::TEXCOORD)
+                                               .at(setIndex)
+                                               .floats()),
+                gsl::make_span(m_shapeComponents.at(shapeIndex).back())};
+
+            m_mikkTSpaceContexts.emplace_back(
+                std::make_unique<MikkTSpaceContext>(
+                    m_primitiveCount, indices, vectors, shape, setIndex));
+        }
+    }
+}
+
+void SyntheticMesh::addSkin(const int pointsPerSide, const int jointCount,
+                            const int influenceCount,
+                            const int maxInfluenceCount) {
+    const auto elementSize = int(array_size<JointIndices>::size);
+    const auto jointsPerSide =
+        static_cast<int>(std::ceil(std::sqrt(double(jointCount))));
+    const auto jointStep = 2.0f / jointsPerSide;
+    const auto pointStep = 1.0f / std::max(1, pointsPerSide - 1);
+    const auto influences = std::min(influenceCount, jointCount);
+    const auto keptInfluences =
+        maxInfluenceCount > 0 ? std::min(influences, maxInfluenceCount)
+                              : influences;
+    const auto setCount = (keptInfluences + elementSize - 1) / elementSize;
+    const auto pointCount = pointsPerSide * pointsPerSide;
+
+    std::vector<FloatVector> weightSets(setCount,
+                                        FloatVector(pointCount * elementSize));
+    std::vector<std::vector<JointIndex>> jointSets(
+        setCount, std::vector<JointIndex>(pointCount * elementSize));
+
+    std::vector<std::pair<float, int>> nearest(jointCount);
+    std::vector<VertexJointAssignment> assignments;
+    assignments.reserve(influences);
+
+    for (auto row = 0; row < pointsPerSide; ++row) {
+        for (auto col = 0; col < pointsPerSide; ++col) {
+            const auto x = col * pointStep;
+            const auto z = row * pointStep;
+
+            for (auto joint = 0; joint < jointCount; ++joint) {
+                const auto jx = -0.5f + (joint % jointsPerSide + 0.5f) * jointStep;
+                const auto jz = -0.5f + (joint / jointsPerSide + 0.5f) * jointStep;
+                const auto distance2 = (x - jx) * (x - jx) + (z - jz) * (z - jz);
+                nearest[joint] = {distance2, joint};
+            }
+
+            // The nearest joints weigh the vertex, heavier when nearer
+            std::nth_element(nearest.begin(), nearest.begin() + influences - 1,
+                             nearest.end());
+
+            assignments.clear();
+            for (auto index = 0; index < influences; ++index) {
+                assignments.emplace_back(nearest[index].second,
+                                         1 / (nearest[index].first + 1e-4f));
+            }
+
+            m_maxJointWeightError = std::max(
+                m_maxJointWeightError,
+                selectJointAssignments(assignments, maxInfluenceCount));
+
+            float weightSum = 0;
+            for (auto &assignment : assignments) {
+                weightSum += assignment.jointWeight;
+            }
+
+            const auto point = row * pointsPerSide + col;
+            for (auto index = 0; index < int(assignments.size()); ++index) {
+                const auto offset = point * elementSize + index % elementSize;
+                weightSets[index / elementSize][offset] =
+                    assignments[index].jointWeight / weightSum;
+                jointSets[index / elementSize][offset] =
+                    static_cast<JointIndex>(assignments[index].jointIndex);
+            }
+        }
+    }
+
+    auto &mainVertices = m_shapeVertices.at(0);
+    const auto &cornerIndices = m_indices.at(Semantic::POSITION).at(0);
+
+    for (auto setIndex = 0; setIndex < setCount; ++setIndex) {
+        m_indices.at(Semantic::WEIGHTS).push_back(cornerIndices);
+        m_indices.at(Semantic::JOINTS).push_back(cornerIndices);
+
+        addComponents(0, Semantic::WEIGHTS, std::move(weightSets[setIndex]));
+
+        m_jointComponents.emplace_back(std::move(jointSets[setIndex]));
+        mainVertices.at(Semantic::JOINTS)
+            .emplace_back(span(m_jointComponents.back()));
+    }
+}
+
+void SyntheticMesh::addComponents(const size_t shapeIndex,
+                                  const Semantic::Kind semantic,
+                                  FloatVector &&components) {
+    auto &shapeComponents = m_shapeComponents.at(shapeIndex);
+    shapeComponents.emplace_back(std::move(components));
+    m_shapeVertices.at(shapeIndex)
+        .at(semantic)
+        .emplace_back(span(shapeComponents.back()));
+}
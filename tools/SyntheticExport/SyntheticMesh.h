@@ -0,0 +1,91 @@
+#pragma once
+
+#include "MeshTables.h"
+#include "MikkTSpaceContext.h"
+
+struct SyntheticMeshOptions {
+    /** The approximate number of triangles, rounded up to a square grid */
+    size_t triangleCount = 2 * 64 * 64;
+
+    int uvSetCount = 1;
+    int colorSetCount = 0;
+
+    /** The number of blend-shape targets */
+    int targetCount = 0;
+
+    /** The fraction of the grid side each target moves, like the local
+     * targets of a facial rig, 1 to move the whole grid */
+    float targetExtent = 1;
+
+    /** The number of joints on a square grid around the mesh, twice its
+     * size, so the outer joints weigh no vertex, like helper joints */
+    int jointCount = 0;
+
+    /** The number of nearest joints that weigh each vertex, 0 for no skin */
+    int influenceCount = 0;
+
+    /** Like -maxJointInfluences, keep at most this many weights, 0 for all */
+    int maxInfluenceCount = 0;
+
+    /** The number of shaders, assigned to consecutive bands of triangles */
+    int shaderCount = 1;
+
+    /** Generate a MikkTSpace tangent set per UV set, like the
+     * -mikkelsenTangentSpace export flag does */
+    bool mikkTSpace = false;
+};
+
+/**
+ * A grid mesh with the same table layout as the one MeshIndices and
+ * MeshVertices extract from Maya: per-corner indices into per-point
+ * positions, normals, tangents, texture coordinates and colors,
+ * plus optional blend-shape targets that ripple the grid, and optional
+ * skin weights.
+ */
+class SyntheticMesh {
+  public:
+    SyntheticMesh(std::string name, const SyntheticMeshOptions &options);
+    ~SyntheticMesh();
+
+    const std::string name;
+
+    int primitiveCount() const { return m_primitiveCount; }
+
+    /** The largest weight change from capping the influences */
+    float maxJointWeightError() const { return m_maxJointWeightError; }
+
+    /** Requires releaseTargetVertices when there are targets */
+    MeshGeometry geometry() const;
+
+    /** The MikkTSpace tangent sets of all shapes, empty unless requested */
+    std::vector<MikkTSpaceContext *> mikkTSpaceContexts() const;
+
+    /** Replaces the vertices of the targets by their sparse deltas, like
+     * the exporter does once their tangents are computed */
+    void releaseTargetVertices(double tolerance);
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(SyntheticMesh);
+
+    int m_primitiveCount = 0;
+    float m_maxJointWeightError = 0;
+
+    VertexElementIndicesPerSetIndexTable m_indices;
+    IndexVector m_primitiveToShaderIndexMap;
+
+    // Per shape a deque, so the vertex tables can reference the components.
+    std::vector<std::deque<FloatVector>> m_shapeComponents;
+    std::vector<VertexElementsPerSetIndexTable> m_shapeVertices;
+    std::vector<SparseVertexElementsPerSetIndexTable> m_targetDeltas;
+    std::deque<std::vector<JointIndex>> m_jointComponents;
+
+    MikkTSpaceContexts m_mikkTSpaceContexts;
+
+    void addComponents(size_t shapeIndex, Semantic::Kind semantic,
+                       FloatVector &&components);
+
+    void addMikkTSpaceTangents(int uvSetCount);
+
+    void addSkin(int pointsPerSide, int jointCount, int influenceCount,
+                 int maxInfluenceCount);
+};
@@ -0,0 +1,682 @@
+#include "coreExternals.h"
+
+#include "AccessorPacker.h"
+#include "BufferHash.h"
+#include "CoreArguments.h"
+#include "ExportablePrimitive.h"
+#include "GlbWriter.h"
+#include "IndentableStream.h"
+#include "MeshCache.h"
+#include "MeshQuantization.h"
+#include "MeshRenderables.h"
+#include "Profiler.h"
+#include "SyntheticClip.h"
+#include "SyntheticMesh.h"
+#include "SkinEncoding.h"
+#include "SparseAccessor.h"
+#include "ThreadPool.h"
+
+/**
+ * Runs the Maya-free export stages on synthetic scenes, and prints how long
+ * each stage took. Used to profile the exporter on machines without Maya.
+ */
+
+namespace {
+struct DriverOptions {
+    SyntheticMeshOptions mesh;
+    int meshCount = 1;
+    int jointCount = 0;
+    int frameCount = 0;
+    int clipCount = 1;
+    int repeatCount = 1;
+    bool verifyTangents = false;
+    bool streamGlb = false;
+    std::string outputPath;
+    std::string tracePath;
+};
+
+const char *usage =
+    "SyntheticExport [options]\n"
+    "  -triangles <n>  approximate triangle count per mesh\n"
+    "  -uvsets <n>     number of texture coordinate sets\n"
+    "  -colorsets <n>  number of color sets\n"
+    "  -targets <n>    number of blend-shape targets\n"
+    "  -targetExtent <f> fraction of the grid side moved by each target\n"
+    "  -shaders <n>    number of shaders per mesh\n"
+    "  -meshes <n>     number of meshes\n"
+    "  -joints <n>     number of animated joints\n"
+    "  -influences <n> skin the meshes to the joints, n joints per vertex\n"
+    "  -compactSkins   remap the skin joints, and quantize the skin weights\n"
+    "  -wqe <e>        skin weight quantization error\n"
+    "  -mji <n>        keep at most n joint weights per vertex\n"
+    "  -frames <n>     number of frames per clip\n"
+    "  -clips <n>      number of animation clips\n"
+    "  -step <n>       step detection super-samples per frame\n"
+    "  -reduce <e>     keyframe reduction tolerance per component\n"
+    "  -reduceAngle <d> keyframe reduction tolerance of rotations, in degrees\n"
+    "  -i32            force 32-bit indices\n"
+    "  -split          split primitives to keep 16-bit indices\n"
+    "  -wbi            weld by element indices only\n"
+    "  -ovc            optimize the vertex cache and fetch order\n"
+    "  -ood <t>        also optimize overdraw, with ACMR threshold t\n"
+    "  -mikk           generate MikkTSpace tangents per shape and UV set\n"
+    "  -verify         check the parallel tangents against a serial run\n"
+    "  -stream         stream the GLB binary chunk from the accessors\n"
+    "  -hash           hash the packed buffer with SHA-256\n"
+    "  -fastHash       hash the packed buffer with the fast 128-bit hash\n"
+    "  -cacheSha256    key the mesh cache with SHA-256\n"
+    "  -quantize       store KHR_mesh_quantization vertex attributes\n"
+    "  -bst <t>        blend-shape delta tolerance\n"
+    "  -sparse <d>     sparse morph targets up to density d\n"
+    "  -threads <n>    worker threads, 0 = hardware threads, 1 = serial\n"
+    "  -cache <folder> reuse the welded meshes of an existing cache folder\n"
+    "  -repeat <n>     run the whole export n times\n"
+    "  -output <path>  write the last export as a GLB file\n"
+    "  -trace <path>   write a Chrome trace of the export stages\n";
+
+/** Accumulates the wall-clock time spent per stage */
+class StageTimer {
+  public:
+    template <typename F> void time(const std::string &stage, F &&action) {
+        const auto start = std::chrono::steady_clock::now();
+        action();
+        const auto end = std::chrono::steady_clock::now();
+
+        if (m_durations.find(stage) == m_durations.end()) {
+            m_stages.push_back(stage);
+        }
+
+        m_durations[stage] +=
+            std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    void report(const int repeatCount) const {
+        double total = 0;
+        for (auto &stage : m_stages) {
+            const auto milliseconds = m_durations.at(stage) / repeatCount;
+            total += milliseconds;
+            cout << prefix << std::left << std::setw(12) << stage << std::right
+                 << std::fixed << std::setprecision(2) << std::setw(10)
+                 << milliseconds << " ms" << endl;
+        }
+        cout << prefix << std::left << std::setw(12) << "total" << std::right
+             << std::fixed << std::setprecision(2) << std::setw(10) << total
+             << " ms" << endl;
+    }
+
+  private:
+    std::vector<std::string> m_stages;
+    std::map<std::string, double> m_durations;
+};
+
+void parse(int argc, char **argv, DriverOptions &options,
+           CoreArguments &args) {
+    for (auto i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+
+        if (flag == "-i32") {
+            args.force32bitIndices = true;
+            continue;
+        }
+
+        if (flag == "-wbi") {
+            args.weldByIndices = true;
+            continue;
+        }
+
+        if (flag == "-split") {
+            args.splitLargePrimitives = true;
+            continue;
+        }
+
+        if (flag == "-ovc") {
+            args.optimizeVertexCache = true;
+            continue;
+        }
+
+        if (flag == "-mikk") {
+            options.mesh.mikkTSpace = true;
+            args.mikkelsenTangentAngularThreshold = 180;
+            continue;
+        }
+
+        if (flag == "-verify") {
+            options.verifyTangents = true;
+            continue;
+        }
+
+        if (flag == "-stream") {
+            options.streamGlb = true;
+            continue;
+        }
+
+        if (flag == "-hash") {
+            args.hashBufferURIs = true;
+            continue;
+        }
+
+        if (flag == "-fastHash") {
+            args.hashBufferURIs = true;
+            args.fastBufferHash = true;
+            continue;
+        }
+
+        if (flag == "-cacheSha256") {
+            args.sha256MeshCacheKeys = true;
+            continue;
+        }
+
+        if (flag == "-quantize") {
+            args.quantizeMeshes = true;
+            continue;
+        }
+
+        if (flag == "-compactSkins") {
+            args.compactSkins = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for " + flag);
+        }
+
+        const std::string value = argv[++i];
+
+        if (flag == "-output") {
+            options.outputPath = value;
+            continue;
+        }
+
+        if (flag == "-trace") {
+            options.tracePath = value;
+            continue;
+        }
+
+        if (flag == "-cache") {
+            args.meshCacheFolder = value;
+            continue;
+        }
+
+        if (flag == "-reduce") {
+            args.keyframeReductionTolerance = std::stod(value);
+            continue;
+        }
+
+        if (flag == "-reduceAngle") {
+            args.keyframeReductionAngle = std::stod(value);
+            continue;
+        }
+
+        if (flag == "-targetExtent") {
+            options.mesh.targetExtent = std::stof(value);
+            continue;
+        }
+
+        if (flag == "-bst") {
+            args.blendShapeTolerance = std::stod(value);
+            continue;
+        }
+
+        if (flag == "-wqe") {
+            args.jointWeightQuantizationError = std::stod(value);
+            continue;
+        }
+
+        if (flag == "-sparse") {
+            args.sparseTargetDensity = std::stod(value);
+            continue;
+        }
+
+        if (flag == "-ood") {
+            args.optimizeVertexCache = true;
+            args.overdrawThreshold = std::stod(value);
+            continue;
+        }
+
+        const auto number = std::stoi(value);
+
+        if (flag == "-triangles") {
+            options.mesh.triangleCount = number;
+        } else if (flag == "-uvsets") {
+            options.mesh.uvSetCount = number;
+        } else if (flag == "-colorsets") {
+            options.mesh.colorSetCount = number;
+        } else if (flag == "-targets") {
+            options.mesh.targetCount = number;
+        } else if (flag == "-shaders") {
+            options.mesh.shaderCount = number;
+        } else if (flag == "-meshes") {
+            options.meshCount = number;
+        } else if (flag == "-joints") {
+            options.jointCount = number;
+            options.mesh.jointCount = number;
+        } else if (flag == "-influences") {
+            options.mesh.influenceCount = number;
+        } else if (flag == "-mji") {
+            args.maxJointInfluences = number;
+            options.mesh.maxInfluenceCount = number;
+        } else if (flag == "-frames") {
+            options.frameCount = number;
+        } else if (flag == "-clips") {
+            options.clipCount = number;
+        } else if (flag == "-threads") {
+            args.threadCount = number;
+        } else if (flag == "-step") {
+            args.detectStepAnimations = number;
+        } else if (flag == "-repeat") {
+            options.repeatCount = std::max(1, number);
+        } else {
+            throw std::runtime_error("Unknown flag " + flag);
+        }
+    }
+}
+
+/** Runs the action for each index on the pool, and waits for all of them */
+template <typename F>
+void parallelFor(ThreadPool &pool, const size_t count, F &&action) {
+    std::vector<std::future<void>> pending;
+    pending.reserve(count);
+
+    for (size_t index = 0; index < count; ++index) {
+        pending.emplace_back(pool.submit([&action, index]() { action(index); }));
+    }
+
+    for (auto &future : pending) {
+        future.get();
+    }
+}
+
+/** Checks that the packed data of the accessor starts at a multiple of
+ * its component size, as glTF requires */
+void verifyAlignment(const GLTF::Accessor *accessor) {
+    if (auto sparseAccessor = dynamic_cast<const SparseAccessor *>(accessor)) {
+        verifyAlignment(sparseAccessor->indices());
+        verifyAlignment(sparseAccessor->values());
+        return;
+    }
+
+    if (accessor->bufferView == nullptr)
+        return;
+
+    const auto byteOffset =
+        size_t(accessor->bufferView->byteOffset) + accessor->byteOffset;
+    const auto componentByteLength =
+        size_t(GLTF::Accessor::getComponentByteLength(accessor->componentType));
+
+    if (byteOffset % componentByteLength != 0) {
+        throw std::runtime_error("Accessor '" + accessor->name +
+                                 "' starts at byte " +
+                                 std::to_string(byteOffset) +
+                                 ", not a multiple of its component size");
+    }
+}
+
+/** Recomputes the tangents serially, and checks these are identical */
+void verifyTangents(const std::vector<MikkTSpaceContext *> &contexts,
+                    const CoreArguments &args) {
+    std::vector<FloatVector> parallelTangents;
+    for (auto *context : contexts) {
+        const auto &tangents = context->vectors.tangentComponents;
+        parallelTangents.emplace_back(tangents.begin(), tangents.end());
+    }
+
+    ThreadPool serialPool(0);
+    computeTangents(serialPool, contexts, args.mikkelsenTangentAngularThreshold);
+
+    for (size_t index = 0; index < contexts.size(); ++index) {
+        const auto &tangents = contexts[index]->vectors.tangentComponents;
+        const auto &expected = parallelTangents[index];
+
+        if (size_t(tangents.size()) != expected.size() ||
+            memcmp(tangents.data(), expected.data(),
+                   expected.size() * sizeof(float)) != 0) {
+            throw std::runtime_error(
+                "Parallel tangents of shape " +
+                std::to_string(contexts[index]->shapeIndex.arrayIndex()) +
+                " set " + std::to_string(contexts[index]->setIndex) +
+                " differ from the serial ones");
+        }
+    }
+
+    cout << prefix << "Parallel tangents of " << contexts.size()
+         << " shape/set pair(s) are identical to the serial ones" << endl;
+}
+
+size_t exportOnce(const DriverOptions &options, const CoreArguments &args,
+                  ThreadPool &pool, const MeshCache *meshCache,
+                  StageTimer &timer, const bool save) {
+    GLTF::Asset glAsset;
+    GLTF::Scene glScene;
+    GLTF::Material glMaterial;
+
+    glAsset.scenes.push_back(&glScene);
+    glAsset.scene = 0;
+
+    std::vector<std::unique_ptr<SyntheticMesh>> meshes;
+    std::vector<std::unique_ptr<MeshRenderables>> renderables;
+    std::vector<std::vector<std::unique_ptr<ExportablePrimitive>>>
+        meshPrimitives;
+    std::vector<std::unique_ptr<GLTF::Mesh>> glMeshes;
+    std::vector<std::unique_ptr<GLTF::Node>> glNodes;
+    std::vector<std::unique_ptr<GLTF::Node::TransformTRS>> glTransforms;
+    std::vector<PositionQuantization> positionQuantizations(
+        options.meshCount);
+
+    timer.time("build", [&]() {
+        for (auto meshIndex = 0; meshIndex < options.meshCount; ++meshIndex) {
+            meshes.emplace_back(std::make_unique<SyntheticMesh>(
+                "mesh" + std::to_string(meshIndex), options.mesh));
+        }
+    });
+
+    if (args.maxJointInfluences > 0 && options.mesh.influenceCount > 0) {
+        float maxWeightError = 0;
+        for (auto &mesh : meshes) {
+            maxWeightError =
+                std::max(maxWeightError, mesh->maxJointWeightError());
+        }
+        cout << prefix << "Kept " << args.maxJointInfluences
+             << " joint weights per vertex, max weight error "
+             << std::setprecision(4) << maxWeightError << endl;
+    }
+
+    renderables.resize(meshes.size());
+    meshPrimitives.resize(meshes.size());
+
+    if (options.mesh.mikkTSpace) {
+        std::vector<MikkTSpaceContext *> contexts;
+        for (auto &mesh : meshes) {
+            for (auto *context : mesh->mikkTSpaceContexts()) {
+                contexts.emplace_back(context);
+            }
+        }
+
+        timer.time("tangents", [&]() {
+            computeTangents(pool, contexts,
+                            args.mikkelsenTangentAngularThreshold);
+        });
+
+        if (options.verifyTangents) {
+            verifyTangents(contexts, args);
+        }
+    }
+
+    timer.time("deltas", [&]() {
+        parallelFor(pool, meshes.size(), [&](const size_t meshIndex) {
+            meshes[meshIndex]->releaseTargetVertices(args.blendShapeTolerance);
+        });
+    });
+
+    std::atomic<size_t> cacheHitCount(0);
+
+    timer.time("weld", [&]() {
+        parallelFor(pool, meshes.size(), [&](const size_t meshIndex) {
+            const auto geometry = meshes[meshIndex]->geometry();
+
+            if (meshCache) {
+                const auto key = MeshCache::key(geometry, args);
+                renderables[meshIndex] = meshCache->load(key);
+
+                if (renderables[meshIndex]) {
+                    ++cacheHitCount;
+                    return;
+                }
+
+                renderables[meshIndex] =
+                    std::make_unique<MeshRenderables>(geometry, args);
+                meshCache->store(key, *renderables[meshIndex]);
+                return;
+            }
+
+            renderables[meshIndex] =
+                std::make_unique<MeshRenderables>(geometry, args);
+        });
+    });
+
+    if (meshCache) {
+        cout << prefix << "Loaded " << cacheHitCount << " of "
+             << meshes.size() << " mesh(es) from the mesh cache" << endl;
+    }
+
+    if (args.optimizeVertexCache) {
+        VertexCacheOptimization optimization;
+        for (auto &meshRenderables : renderables) {
+            optimization.before +=
+                meshRenderables->vertexCacheOptimization().before;
+            optimization.after +=
+                meshRenderables->vertexCacheOptimization().after;
+        }
+        cout << prefix << "Vertex cache " << optimization << endl;
+    }
+
+    timer.time("primitives", [&]() {
+        parallelFor(pool, meshes.size(), [&](const size_t meshIndex) {
+            const auto &name = meshes[meshIndex]->name;
+            const auto geometry = meshes[meshIndex]->geometry();
+
+            auto &positionQuantization = positionQuantizations[meshIndex];
+            if (args.quantizeMeshes) {
+                const auto &mainPositions =
+                    geometry.mainVertices->at(Semantic::POSITION).at(0);
+                positionQuantization = PositionQuantization::fromPositions(
+                    reinterpret_span<Position>(mainPositions.floats()),
+                    args.positionQuantizationError);
+            }
+
+            JointPalette jointPalette;
+            if (args.compactSkins) {
+                jointPalette = JointPalette::fromVertices(
+                    options.jointCount, *geometry.mainVertices);
+            }
+
+            size_t vertexBufferIndex = 0;
+            for (auto &&pair : renderables[meshIndex]->table()) {
+                const auto &parts = pair.second;
+                for (size_t partIndex = 0; partIndex < parts.size();
+                     ++partIndex) {
+                    auto primitiveName =
+                        name + "#" + std::to_string(vertexBufferIndex);
+                    if (parts.size() > 1) {
+                        primitiveName +=
+                            "/part#" + std::to_string(partIndex);
+                    }
+                    meshPrimitives[meshIndex].emplace_back(
+                        std::make_unique<ExportablePrimitive>(
+                            primitiveName, parts[partIndex], args,
+                            &glMaterial, false, positionQuantization,
+                            jointPalette.isEmpty() ? nullptr
+                                                   : &jointPalette));
+                }
+                ++vertexBufferIndex;
+            }
+        });
+
+        for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+            auto glMesh = std::make_unique<GLTF::Mesh>();
+            glMesh->name = meshes[meshIndex]->name;
+            glMesh->weights.resize(options.mesh.targetCount, 0);
+
+            for (auto &primitive : meshPrimitives[meshIndex]) {
+                glMesh->primitives.push_back(&primitive->glPrimitive);
+            }
+
+            auto glNode = std::make_unique<GLTF::Node>();
+            glNode->name = glMesh->name;
+            glNode->mesh = glMesh.get();
+            glScene.nodes.push_back(glNode.get());
+
+            const auto &q = positionQuantizations[meshIndex];
+            if (q.isEnabled()) {
+                auto glTransform = std::make_unique<GLTF::Node::TransformTRS>();
+                std::copy(q.offset.begin(), q.offset.end(),
+                          glTransform->translation);
+                std::fill_n(glTransform->rotation, 3, 0.0f);
+                glTransform->rotation[3] = 1;
+                std::fill_n(glTransform->scale, 3, q.scale);
+                glNode->transform = glTransform.get();
+                glTransforms.emplace_back(std::move(glTransform));
+            }
+
+            for (auto &primitive : meshPrimitives[meshIndex]) {
+                if (primitive->hasQuantizedAttributes) {
+                    glAsset.extensionsUsed.insert("KHR_mesh_quantization");
+                    glAsset.extensionsRequired.insert("KHR_mesh_quantization");
+                }
+            }
+
+            glMeshes.emplace_back(std::move(glMesh));
+            glNodes.emplace_back(std::move(glNode));
+        }
+    });
+
+    SyntheticSkeleton skeleton(options.jointCount);
+    std::vector<std::unique_ptr<SyntheticClip>> clips;
+
+    if (options.jointCount > 0 && options.frameCount > 0) {
+        glScene.nodes.push_back(&skeleton.glRoot);
+
+        for (auto clipIndex = 0; clipIndex < options.clipCount; ++clipIndex) {
+            clips.emplace_back(std::make_unique<SyntheticClip>(
+                "clip" + std::to_string(clipIndex), skeleton,
+                options.frameCount, 30.0, args));
+        }
+
+        timer.time("sample", [&]() {
+            for (auto &clip : clips) {
+                clip->sample();
+            }
+        });
+
+        timer.time("channels", [&]() {
+            for (auto &clip : clips) {
+                clip->finish();
+                glAsset.animations.push_back(&clip->glAnimation);
+            }
+        });
+    }
+
+    AccessorPacker packer(options.streamGlb);
+    GLTF::Buffer *buffer = nullptr;
+
+    timer.time("pack", [&]() {
+        buffer = packer.packAccessors(glAsset.getAllAccessors(), "data");
+    });
+
+    for (auto *accessor : glAsset.getAllAccessors()) {
+        verifyAlignment(accessor);
+    }
+
+    if (args.hashBufferURIs && buffer && !packer.isStreaming()) {
+        std::string hash;
+
+        timer.time("hash", [&]() {
+            BufferHash bufferHash(pool, buffer->data, buffer->byteLength,
+                                  args.fastBufferHash ? BufferHash::FAST128
+                                                      : BufferHash::SHA256);
+            hash = bufferHash.hex();
+        });
+
+        cout << prefix << "Buffer hash " << hash << endl;
+    }
+
+    std::string json;
+
+    timer.time("json", [&]() {
+        GLTF::Options glOptions;
+        glOptions.embeddedBuffers = true;
+        glOptions.binary = true;
+        glOptions.name = "synthetic";
+
+        rapidjson::StringBuffer jsonStringBuffer;
+        rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(
+            jsonStringBuffer);
+        jsonWriter.StartObject();
+        glAsset.writeJSON(&jsonWriter, &glOptions);
+        jsonWriter.EndObject();
+        json = jsonStringBuffer.GetString();
+    });
+
+    const auto bufferLength = buffer ? buffer->byteLength : 0;
+
+    const auto writeData = [&](std::ostream &out) {
+        packer.writeBuffer(out, buffer);
+    };
+
+    timer.time("glb", [&]() {
+        if (save) {
+            std::ofstream file(options.outputPath, ios::out | ios::binary);
+            if (!file) {
+                throw std::runtime_error("Couldn't write to '" +
+                                         options.outputPath + "'");
+            }
+            writeGLB(file, json, bufferLength, writeData);
+        } else {
+            std::ostringstream stream;
+            writeGLB(stream, json, bufferLength, writeData);
+        }
+    });
+
+    return json.size() + bufferLength;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    DriverOptions options;
+    CoreArguments args;
+    args.meshPrimitiveAttributes.set();
+    args.blendPrimitiveAttributes.set(Semantic::POSITION);
+    args.blendPrimitiveAttributes.set(Semantic::NORMAL);
+    args.blendPrimitiveAttributes.set(Semantic::TANGENT);
+
+    try {
+        parse(argc, argv, options, args);
+    } catch (const std::exception &ex) {
+        cerr << ex.what() << endl << usage;
+        return 1;
+    }
+
+    try {
+        ThreadPool pool(ThreadPool::workerCountFor(args.threadCount));
+        StageTimer timer;
+
+        std::unique_ptr<MeshCache> meshCache;
+        if (!args.meshCacheFolder.empty()) {
+            meshCache = std::make_unique<MeshCache>(args.meshCacheFolder);
+        }
+
+        size_t byteLength = 0;
+
+        if (!options.tracePath.empty()) {
+            Profiler::start();
+        }
+
+        for (auto run = 0; run < options.repeatCount; ++run) {
+            const auto isLast = run == options.repeatCount - 1;
+            byteLength = exportOnce(options, args, pool, meshCache.get(),
+                                    timer,
+                                    isLast && !options.outputPath.empty());
+        }
+
+        cout << prefix << "Exported " << options.meshCount << " mesh(es) of "
+             << options.mesh.triangleCount << " triangles, "
+             << options.clipCount << " clip(s) of " << options.jointCount
+             << " joints x " << options.frameCount << " frames; GLB size "
+             << byteLength << " bytes, average over " << options.repeatCount
+             << " run(s) on " << std::max<size_t>(1, pool.workerCount())
+             << " thread(s):" << endl;
+
+        timer.report(options.repeatCount);
+
+        if (Profiler::isEnabled()) {
+            Profiler::stop();
+            Profiler::writeTrace(options.tracePath);
+            cout << prefix << "Wrote trace to '" << options.tracePath << "':" << endl;
+            Profiler::printSummary(cout);
+        }
+    } catch (const std::exception &ex) {
+        cerr << prefix << "Export failed: " << ex.what() << endl;
+        return 2;
+    }
+
+    return 0;
+}
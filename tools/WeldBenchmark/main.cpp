@@ -0,0 +1,143 @@
+#include "coreExternals.h"
+
+#include "IndentableStream.h"
+#include "MeshTables.h"
+#include "WeldTable.h"
+
+/**
+ * Compares the weld table against the std::unordered_map of byte vectors
+ * that MeshRenderables used before, on the keys of a synthetic mesh.
+ * The corners are those of a triangulated grid, so like in a real mesh,
+ * most vertices are shared by 6 corners of neighbouring triangles.
+ */
+
+namespace {
+typedef std::vector<byte> VertexKey;
+
+/** The byte-wise hasher that was used by VertexToIndexMapping */
+struct ByteHasher {
+    std::size_t operator()(const VertexKey &elems) const {
+        size_t seed = 0x26DFB62C;
+        for (auto &elem : elems) {
+            seed ^= (seed << 6) + (seed >> 2) + 0x3C2E6B88 +
+                    static_cast<size_t>(elem);
+        }
+        return seed;
+    }
+};
+
+typedef std::unordered_map<VertexKey, Index, ByteHasher> VertexToIndexMapping;
+
+template <typename F> double milliseconds(F &&action) {
+    const auto start = std::chrono::steady_clock::now();
+    action();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    size_t vertexCount = 1000000;
+    size_t targetCount = 0;
+    int repeatCount = 3;
+
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string flag = argv[i];
+        const auto value = std::stoul(argv[i + 1]);
+        if (flag == "-vertices") {
+            vertexCount = value;
+        } else if (flag == "-targets") {
+            targetCount = value;
+        } else if (flag == "-repeat") {
+            repeatCount = std::max(1, static_cast<int>(value));
+        } else {
+            cerr << "WeldBenchmark [-vertices <n>] [-targets <n>] [-repeat <n>]"
+                 << endl;
+            return 1;
+        }
+    }
+
+    // POSITION, NORMAL, TEXCOORD and TANGENT of the main shape, and
+    // POSITION, NORMAL and TANGENT per blend-shape target.
+    const size_t floatsPerKey = 3 + 3 + 2 + 4 + targetCount * 9;
+    const size_t keyLength = floatsPerKey * sizeof(float);
+    const size_t quadsPerSide = static_cast<size_t>(
+        std::max(1.0, std::ceil(std::sqrt(double(vertexCount))) - 1));
+    const size_t pointsPerSide = quadsPerSide + 1;
+    vertexCount = pointsPerSide * pointsPerSide;
+
+    std::vector<float> components(vertexCount * floatsPerKey);
+    for (size_t i = 0; i < components.size(); ++i) {
+        components[i] = static_cast<float>(i % 7919) * 0.001f;
+    }
+
+    IndexVector corners;
+    corners.reserve(quadsPerSide * quadsPerSide * 6);
+    for (size_t row = 0; row < quadsPerSide; ++row) {
+        for (size_t col = 0; col < quadsPerSide; ++col) {
+            const auto p00 = static_cast<Index>(row * pointsPerSide + col);
+            const auto p01 = p00 + 1;
+            const auto p10 = p00 + static_cast<Index>(pointsPerSide);
+            const auto p11 = p10 + 1;
+            corners.insert(corners.end(), {p00, p10, p11, p00, p11, p01});
+        }
+    }
+
+    const size_t cornerCount = corners.size();
+
+    const auto componentBytes = reinterpret_span<byte>(components);
+
+    IndexVector mapIndices(cornerCount);
+    IndexVector tableIndices(cornerCount);
+
+    double mapTime = 0;
+    double tableTime = 0;
+
+    for (auto run = 0; run < repeatCount; ++run) {
+        mapTime += milliseconds([&]() {
+            VertexToIndexMapping mapping;
+            VertexKey key;
+            for (size_t i = 0; i < cornerCount; ++i) {
+                const auto keyBytes =
+                    componentBytes.subspan(corners[i] * keyLength, keyLength);
+                key.assign(keyBytes.begin(), keyBytes.end());
+                const auto it = mapping.find(key);
+                if (it == mapping.end()) {
+                    const auto index = static_cast<Index>(mapping.size());
+                    mapping[key] = index;
+                    mapIndices[i] = index;
+                } else {
+                    mapIndices[i] = it->second;
+                }
+            }
+        });
+
+        tableTime += milliseconds([&]() {
+            WeldTable table;
+            bool isNew;
+            for (size_t i = 0; i < cornerCount; ++i) {
+                const auto keyBytes =
+                    componentBytes.subspan(corners[i] * keyLength, keyLength);
+                tableIndices[i] = table.findOrInsert(keyBytes, isNew);
+            }
+        });
+    }
+
+    if (mapIndices != tableIndices) {
+        cerr << prefix << "ERROR: the weld table assigned different indices!"
+             << endl;
+        return 2;
+    }
+
+    mapTime /= repeatCount;
+    tableTime /= repeatCount;
+
+    cout << prefix << cornerCount << " corners, " << vertexCount
+         << " vertices, " << keyLength << " bytes per key" << endl;
+    cout << prefix << std::fixed << std::setprecision(2)
+         << "unordered_map: " << mapTime << " ms" << endl;
+    cout << prefix << "weld table:    " << tableTime << " ms ("
+         << mapTime / tableTime << "x)" << endl;
+
+    return 0;
+}